@@ -0,0 +1,47 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace crequests {
+    namespace bench {
+
+        using steady_clock_t = std::chrono::steady_clock;
+
+        /*
+          Measures wall time of the given function in seconds.
+         */
+        template <class FunctionT>
+        double measure(FunctionT&& fn) {
+            const auto start = steady_clock_t::now();
+            fn();
+            const auto finish = steady_clock_t::now();
+            return std::chrono::duration<double>(finish - start).count();
+        }
+
+        inline size_t arg(int argc, char** argv, int index, size_t fallback) {
+            if (argc > index)
+                return std::strtoul(argv[index], nullptr, 0);
+            return fallback;
+        }
+
+        inline void report(const std::string& name,
+                           const size_t operations,
+                           const double seconds)
+        {
+            std::cout << std::left << std::setw(40) << name
+                      << std::right << std::setw(12) << std::fixed
+                      << std::setprecision(0) << operations / seconds
+                      << " ops/s"
+                      << std::setw(12) << std::setprecision(3) << seconds
+                      << " s" << std::endl;
+        }
+
+    } /* namespace bench */
+} /* namespace crequests */
+
+#endif /* BENCH_H */
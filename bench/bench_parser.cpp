@@ -0,0 +1,152 @@
+#include "bench.h"
+#include "parser.h"
+#include "types.h"
+
+#include <cstring>
+
+namespace {
+
+    using namespace crequests;
+
+    const char* CORPUS[] = {
+        "HTTP/1.1 200 OK\r\n"
+        "Connection: close\r\n"
+        "Accept: */*\r\n"
+        "Accept-Encoding: gzip, deflate\r\n\r\n",
+
+        "HTTP/1.1 200 OK\r\n"
+        "Connection: close\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "Accept: */*\r\n"
+        "Accept-Encoding: gzip, deflate\r\n\r\n"
+        "2\r\n"
+        "qq\r\n",
+
+        "HTTP/1.1 200 OK\r\n"
+        "Connection: close\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "Accept: */*\r\n"
+        "Accept-Encoding: gzip, deflate\r\n\r\n"
+        "2\r\n"
+        "qq\r\n"
+        "3\r\n"
+        "jjj\r\n"
+        "0\r\n\r\n",
+    };
+
+    /*
+      Accumulates what a connection would keep of a response,
+      so the callbacks can not be optimized away.
+     */
+    struct sink_t {
+        size_t status {0};
+        size_t header_bytes {0};
+        size_t body_bytes {0};
+        size_t chunks {0};
+        size_t messages {0};
+    };
+
+    struct handler_t : public parser_handler_t {
+        explicit handler_t(sink_t& sink_) : sink(sink_) {}
+
+        void on_status(const char*,
+                       const size_t,
+                       const unsigned short,
+                       const unsigned short,
+                       const unsigned int code) {
+            sink.status += code;
+        }
+
+        void on_header_field(const char*, const size_t length) {
+            sink.header_bytes += length;
+        }
+
+        void on_header_value(const char*, const size_t length) {
+            sink.header_bytes += length;
+        }
+
+        void on_body(const char*, const size_t length) {
+            sink.body_bytes += length;
+        }
+
+        void on_chunk_header(const size_t) {
+            sink.chunks++;
+        }
+
+        void on_message_complete() {
+            sink.messages++;
+        }
+
+        sink_t& sink;
+    };
+
+    void parse_dynamic(const char* data, const size_t length, sink_t& sink) {
+        parser_t parser(parser_t::parser_type_t::RESPONSE);
+        parser.bind_cb([&sink](const char*,
+                               const size_t,
+                               const unsigned short,
+                               const unsigned short,
+                               const unsigned int code) {
+            sink.status += code;
+        });
+        parser.bind_cb(parser_t::HEADER_FIELD, [&sink](const char*, const size_t size) {
+            sink.header_bytes += size;
+        });
+        parser.bind_cb(parser_t::HEADER_VALUE, [&sink](const char*, const size_t size) {
+            sink.header_bytes += size;
+        });
+        parser.bind_cb(parser_t::BODY, [&sink](const char*, const size_t size) {
+            sink.body_bytes += size;
+        });
+        parser.bind_cb(parser_t::CHUNK_HEADER, [&sink](const size_t) {
+            sink.chunks++;
+        });
+        parser.bind_cb(parser_t::MESSAGE_COMPLETE, [&sink]() {
+            sink.messages++;
+        });
+        parser.execute(data, length);
+    }
+
+    void parse_static(const char* data, const size_t length, sink_t& sink) {
+        handler_t handler(sink);
+        basic_parser_t<handler_t> parser(parser_t::parser_type_t::RESPONSE, handler);
+        parser.execute(data, length);
+    }
+
+    template <class ParseT>
+    void run(const string_t& name, const size_t iterations, ParseT&& parse) {
+        const size_t count = sizeof(CORPUS) / sizeof(CORPUS[0]);
+        size_t lengths[count];
+        for (size_t i = 0; i < count; ++i)
+            lengths[i] = std::strlen(CORPUS[i]);
+
+        sink_t sink;
+        const auto seconds = bench::measure([&]() {
+            for (size_t n = 0; n < iterations; ++n)
+                for (size_t i = 0; i < count; ++i)
+                    parse(CORPUS[i], lengths[i], sink);
+        });
+
+        bench::report(name, iterations * count, seconds);
+        if (sink.messages == 0)
+            std::cerr << "no message parsed" << std::endl;
+    }
+
+} /* anonymous namespace */
+
+/*
+  Parsing speed of the std::function based parser_t against the
+  statically dispatched basic_parser_t on the responses of
+  test/test_parser.cpp. Every message gets a new parser with its
+  callbacks bound, like a connection does for every request.
+
+  Usage: bench_parser [iterations]
+ */
+int main(int argc, char** argv) {
+    const size_t iterations = bench::arg(argc, argv, 1, 200000);
+
+    run("parser_t", iterations, parse_dynamic);
+    run("basic_parser_t", iterations, parse_static);
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "bench.h"
+#include "headers.h"
+#include "params.h"
+#include "scan.h"
+
+namespace {
+
+    using namespace crequests;
+
+    /*
+      A response header block of API size: many headers with long
+      values, like tracing ids, policies and cookies.
+     */
+    string_t make_header_block(const size_t count) {
+        string_t block;
+        for (size_t i = 0; i < count; ++i) {
+            block += "X-Header-" + std::to_string(i) + ": ";
+            block += string_t(40 + i % 80, 'v');
+            block += "\r\n";
+        }
+        block += "\r\n";
+        return block;
+    }
+
+    string_t make_query(const size_t count) {
+        string_t query;
+        for (size_t i = 0; i < count; ++i) {
+            if (i > 0)
+                query += "&";
+            query += "parameter" + std::to_string(i) + "=" + string_t(10 + i % 30, 'q');
+        }
+        return query;
+    }
+
+    /*
+      Counts the delimiters of a block the way the parsers walk it,
+      one find after another.
+     */
+    template <class FindT>
+    size_t count_delimiters(const string_t& str, FindT&& find) {
+        const char* it = str.data();
+        const char* const end = it + str.size();
+        size_t count = 0;
+        while ((it = find(it, end)) != end) {
+            ++count;
+            ++it;
+        }
+        return count;
+    }
+
+    template <class FunctionT>
+    void run(const string_t& name,
+             const size_t iterations,
+             const size_t bytes,
+             FunctionT&& fn)
+    {
+        size_t sink = 0;
+        const auto seconds = bench::measure([&]() {
+            for (size_t n = 0; n < iterations; ++n)
+                sink += fn();
+        });
+
+        bench::report(name, iterations, seconds);
+        std::cout << std::setw(52) << std::setprecision(0)
+                  << bytes * iterations / seconds / (1 << 20) << " MiB/s" << std::endl;
+        if (sink == 0)
+            std::cerr << "nothing found" << std::endl;
+    }
+
+} /* anonymous namespace */
+
+/*
+  Delimiter scanning of delimiters_t with the selected SIMD kernel
+  against its scalar search, and the parsers built on it, on a large
+  header block and a long query string.
+
+  Usage: bench_scan [iterations]
+ */
+int main(int argc, char** argv) {
+    const size_t iterations = bench::arg(argc, argv, 1, 20000);
+
+    const auto block = make_header_block(200);
+    const auto query = make_query(500);
+    const delimiters_t line_delimiters(":\n");
+    const delimiters_t query_delimiters("&=");
+
+    std::cout << "kernel: " << scan_kernel() << std::endl;
+
+    run("headers scalar", iterations, block.size(), [&]() {
+        return count_delimiters(block, [&](const char* begin, const char* end) {
+            return line_delimiters.find_scalar(begin, end);
+        });
+    });
+    run("headers simd", iterations, block.size(), [&]() {
+        return count_delimiters(block, [&](const char* begin, const char* end) {
+            return line_delimiters.find(begin, end);
+        });
+    });
+    run("query scalar", iterations, query.size(), [&]() {
+        return count_delimiters(query, [&](const char* begin, const char* end) {
+            return query_delimiters.find_scalar(begin, end);
+        });
+    });
+    run("query simd", iterations, query.size(), [&]() {
+        return count_delimiters(query, [&](const char* begin, const char* end) {
+            return query_delimiters.find(begin, end);
+        });
+    });
+
+    run("headers_t::from_string", iterations / 10, block.size(), [&]() {
+        return headers_t::from_string(block).size();
+    });
+    run("params_t::from_string", iterations / 10, query.size(), [&]() {
+        return params_t::from_string(query).size();
+    });
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include "api.h"
+#include "bench.h"
+#include "../test/server.h"
+
+#include <thread>
+
+/*
+  Throughput of one service_t against the local test server depending on
+  the number of service worker threads.
+
+  Usage: bench_service [requests] [max_threads]
+ */
+int main(int argc, char** argv) {
+    using namespace crequests;
+
+    const size_t requests = bench::arg(argc, argv, 1, 2000);
+    const size_t max_threads = bench::arg(
+        argc, argv, 2, std::max<size_t>(std::thread::hardware_concurrency(), 1));
+
+    server_t server{"127.0.0.1", "8090"};
+    std::vector<std::thread> server_threads;
+    for (size_t i = 0; i < max_threads; ++i)
+        server_threads.emplace_back([&server](){ server.run(); });
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        service_t service{threads_count_t{threads}};
+
+        const auto seconds = bench::measure([&]() {
+            std::vector<asyncresponse_t> responses;
+            responses.reserve(requests);
+            for (size_t i = 0; i < requests; ++i)
+                responses.push_back(
+                    AsyncGet(service, "127.0.0.1:8090/get_big_content_length"));
+            for (const auto& response : responses)
+                response.get();
+        });
+
+        bench::report("threads_count_t{" + std::to_string(threads) + "}",
+                      requests, seconds);
+    }
+
+    server.stop();
+    for (auto& thread : server_threads)
+        thread.join();
+
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include "api.h"
+#include "bench.h"
+#include "../test/server.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+
+#include <unistd.h>
+
+namespace {
+
+    using namespace crequests;
+
+    /*
+      Serialization alone: the whole request in one string as
+      make_request() builds it, against the head make_head() builds
+      for a gathered write.
+     */
+    void run_serialize(const size_t iterations, const string_t& data) {
+        request_t request;
+        request.uri("127.0.0.1:8091/upload"_uri);
+        request.method("POST"_method);
+        request.data(data_t{data});
+        request.gzip(gzip_t{false});
+        request.prepare();
+
+        size_t sink = 0;
+        const auto whole = bench::measure([&]() {
+            for (size_t n = 0; n < iterations; ++n)
+                sink += request.make_request().size();
+        });
+        bench::report("make_request " + std::to_string(data.size() >> 20) + " MiB",
+                      iterations, whole);
+
+        const auto head = bench::measure([&]() {
+            for (size_t n = 0; n < iterations; ++n)
+                sink += request.make_head().size();
+        });
+        bench::report("make_head " + std::to_string(data.size() >> 20) + " MiB",
+                      iterations, head);
+
+        if (sink == 0)
+            std::cerr << "nothing serialized" << std::endl;
+    }
+
+    void run_upload(service_t& service, const size_t iterations, const string_t& data) {
+        const auto seconds = bench::measure([&]() {
+            for (size_t n = 0; n < iterations; ++n) {
+                const auto response = Post(service, "127.0.0.1:8091/upload",
+                                           data_t{data}, gzip_t{false});
+                if (response.error())
+                    std::cerr << response.error() << std::endl;
+            }
+        });
+
+        bench::report("POST " + std::to_string(data.size() >> 20) + " MiB",
+                      iterations, seconds);
+        std::cout << std::setw(52) << std::setprecision(0)
+                  << data.size() * iterations / seconds / (1 << 20)
+                  << " MiB/s" << std::endl;
+    }
+
+    template <class BodyT>
+    void run_post(service_t& service, const string_t& name,
+                  const size_t iterations, const size_t size, const BodyT& body)
+    {
+        const auto seconds = bench::measure([&]() {
+            for (size_t n = 0; n < iterations; ++n) {
+                const auto response = Post(service, "127.0.0.1:8091/upload",
+                                           body(), gzip_t{false});
+                if (response.error())
+                    std::cerr << response.error() << std::endl;
+            }
+        });
+
+        bench::report(name + " " + std::to_string(size >> 20) + " MiB", iterations, seconds);
+        std::cout << std::setw(52) << std::setprecision(0)
+                  << size * iterations / seconds / (1 << 20)
+                  << " MiB/s" << std::endl;
+    }
+
+    /*
+      The same file sent as data_t after reading it into a string, as
+      a body_source_t which goes out with sendfile(2), and through a
+      reader which copies it in 64 KiB parts.
+     */
+    void run_file_upload(service_t& service, const size_t iterations, const size_t size) {
+        string_t path = "/tmp/crequests_bench_XXXXXX";
+        const int fd = ::mkstemp(&path[0]);
+        const string_t data(size, 'x');
+        if (fd < 0 or ::write(fd, data.data(), data.size()) != static_cast<ssize_t>(size)) {
+            std::cerr << "cannot write " << path << std::endl;
+            return;
+        }
+
+        run_post(service, "read + data_t", iterations, size, [&path]() {
+            std::ifstream file(path, std::ios::binary);
+            return data_t{string_t(std::istreambuf_iterator<char>(file),
+                                   std::istreambuf_iterator<char>())};
+        });
+        run_post(service, "from_file", iterations, size, [&path]() {
+            return body_source_t::from_file(path);
+        });
+        run_post(service, "from_reader", iterations, size, [fd, size]() {
+            auto offset = off_t{0};
+            return body_source_t::from_reader([fd, offset](char* buffer, const size_t length) mutable {
+                const auto count = ::pread(fd, buffer, length, offset);
+                if (count < 0)
+                    throw std::runtime_error("pread");
+                offset += count;
+                return static_cast<size_t>(count);
+            }, size);
+        });
+
+        ::close(fd);
+        std::remove(path.c_str());
+    }
+
+} /* anonymous namespace */
+
+/*
+  Large POST bodies against the local test server, which reads and
+  sums them. The body goes out as its own buffer of a gathered write.
+  A file body is compared with reading the file into data_t.
+
+  Usage: bench_upload [iterations]
+ */
+int main(int argc, char** argv) {
+    const size_t iterations = bench::arg(argc, argv, 1, 20);
+
+    server_t server{"127.0.0.1", "8091"};
+    std::thread server_thread([&server](){ server.run(); });
+
+    service_t service;
+    for (const size_t size : {1 << 20, 10 << 20, 64 << 20}) {
+        const string_t data(size, 'x');
+        run_serialize(iterations, data);
+        run_upload(service, iterations, data);
+        run_file_upload(service, iterations, size);
+    }
+
+    server.stop();
+    server_thread.join();
+
+    return 0;
+}
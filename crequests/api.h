@@ -3,6 +3,7 @@
 
 #include "response.h"
 #include "asyncresponse.h"
+#include "awaitable.h"
 #include "service.h"
 #include "session.h"
 
@@ -103,6 +104,99 @@ namespace crequests {
         set_option(session, std::forward<Args>(args)...);
         return session.AsyncHead();
     }
+
+    /*
+      Completion handler versions: the response is moved into the
+      handler on a service thread. Neither the session nor the
+      connection is kept by the service afterwards.
+     */
+    template <class ServiceT, class... Args>
+    void CallbackGet(ServiceT&& service, completion_handler_t handler, Args&& ...args) {
+        session_t session(service);
+        set_option(session, std::forward<Args>(args)...);
+        session.AsyncGet(std::move(handler));
+    }
+
+    template <class ServiceT, class... Args>
+    void CallbackPost(ServiceT&& service, completion_handler_t handler, Args&& ...args) {
+        session_t session(service);
+        set_option(session, std::forward<Args>(args)...);
+        session.AsyncPost(std::move(handler));
+    }
+
+    template <class ServiceT, class... Args>
+    void CallbackPut(ServiceT&& service, completion_handler_t handler, Args&& ...args) {
+        session_t session(service);
+        set_option(session, std::forward<Args>(args)...);
+        session.AsyncPut(std::move(handler));
+    }
+
+    template <class ServiceT, class... Args>
+    void CallbackPatch(ServiceT&& service, completion_handler_t handler, Args&& ...args) {
+        session_t session(service);
+        set_option(session, std::forward<Args>(args)...);
+        session.AsyncPatch(std::move(handler));
+    }
+
+    template <class ServiceT, class... Args>
+    void CallbackDelete(ServiceT&& service, completion_handler_t handler, Args&& ...args) {
+        session_t session(service);
+        set_option(session, std::forward<Args>(args)...);
+        session.AsyncDelete(std::move(handler));
+    }
+
+    template <class ServiceT, class... Args>
+    void CallbackHead(ServiceT&& service, completion_handler_t handler, Args&& ...args) {
+        session_t session(service);
+        set_option(session, std::forward<Args>(args)...);
+        session.AsyncHead(std::move(handler));
+    }
+
+    /*
+      co_await versions. The session is not kept by the service, it
+      lives in the awaitable until the response is there.
+     */
+    template <class ServiceT, class... Args>
+    awaitable_response_t AwaitGet(ServiceT&& service, Args&& ...args) {
+        session_t session(service);
+        set_option(session, std::forward<Args>(args)...);
+        return session.AwaitGet();
+    }
+
+    template <class ServiceT, class... Args>
+    awaitable_response_t AwaitPost(ServiceT&& service, Args&& ...args) {
+        session_t session(service);
+        set_option(session, std::forward<Args>(args)...);
+        return session.AwaitPost();
+    }
+
+    template <class ServiceT, class... Args>
+    awaitable_response_t AwaitPut(ServiceT&& service, Args&& ...args) {
+        session_t session(service);
+        set_option(session, std::forward<Args>(args)...);
+        return session.AwaitPut();
+    }
+
+    template <class ServiceT, class... Args>
+    awaitable_response_t AwaitPatch(ServiceT&& service, Args&& ...args) {
+        session_t session(service);
+        set_option(session, std::forward<Args>(args)...);
+        return session.AwaitPatch();
+    }
+
+    template <class ServiceT, class... Args>
+    awaitable_response_t AwaitDelete(ServiceT&& service, Args&& ...args) {
+        session_t session(service);
+        set_option(session, std::forward<Args>(args)...);
+        return session.AwaitDelete();
+    }
+
+    template <class ServiceT, class... Args>
+    awaitable_response_t AwaitHead(ServiceT&& service, Args&& ...args) {
+        session_t session(service);
+        set_option(session, std::forward<Args>(args)...);
+        return session.AwaitHead();
+    }
     
 } /* namespace crequests */
 
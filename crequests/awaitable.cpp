@@ -0,0 +1,28 @@
+#include "awaitable.h"
+#include "error.h"
+
+namespace crequests {
+
+
+    awaitable_response_t::awaitable_response_t(const session_t& session_,
+                                               const method_t& method_)
+        : session(session_),
+          method(method_)
+    {
+
+    }
+
+    response_t awaitable_response_t::await_resume() {
+        if (result->error() and result->request().throw_on_error())
+            throw result->error();
+        return std::move(*result);
+    }
+
+    void awaitable_response_t::send(completion_handler_t&& handler) {
+        if (not method.empty())
+            session.set_option(method);
+        session.AsyncSend(std::move(handler));
+    }
+
+
+} /* namespace crequests */
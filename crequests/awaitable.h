@@ -0,0 +1,59 @@
+#ifndef AWAITABLE_H
+#define AWAITABLE_H
+
+#include "response.h"
+#include "session.h"
+
+namespace crequests {
+
+    /*
+      A response of a session to co_await in a C++20 coroutine.
+
+      The request is sent when the coroutine suspends, and the
+      coroutine is resumed on a service thread right from the end of
+      the connection: there is no promise, no future and no thread
+      waiting for them. The coroutine runs as a handler of the service
+      until its next suspension, so it must not block, e.g. with a
+      synchronous request.
+
+      A response with an error is thrown by co_await when
+      throw_on_error is set, like a future does.
+
+      The class itself is C++11, await_suspend takes any coroutine
+      handle, so the library does not need to be built as C++20.
+     */
+    class awaitable_response_t {
+    public:
+        awaitable_response_t(const session_t& session, const method_t& method);
+
+    public:
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        template <class HandleT>
+        void await_suspend(HandleT handle) {
+            /*
+              The coroutine may be resumed and this object destroyed
+              on another thread before send() returns.
+             */
+            send([this, handle](response_t&& response) mutable {
+                result.emplace(std::move(response));
+                handle.resume();
+            });
+        }
+
+        response_t await_resume();
+
+    private:
+        void send(completion_handler_t&& handler);
+
+    private:
+        session_t session;
+        method_t method;
+        optional_t<response_t> result {};
+    };
+
+} /* namespace crequests */
+
+#endif /* AWAITABLE_H */
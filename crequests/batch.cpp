@@ -0,0 +1,405 @@
+#include "boost_asio.h"
+#include "batch.h"
+#include "connection.h"
+#include "error.h"
+#include "service.h"
+#include "timer_wheel.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace crequests {
+
+
+    namespace {
+
+        using lock_t = std::lock_guard<std::mutex>;
+
+        response_t canceled_response(const request_t& request, const string_t& msg) {
+            response_t response {request};
+            response.error(error_t(error_code_t::CANCELED, msg));
+            return response;
+        }
+
+    } /* anonymous namespace */
+
+
+    /************************************************************
+     * batch_impl_t section.
+     ************************************************************/
+
+
+    class batch_impl_t : public std::enable_shared_from_this<batch_impl_t> {
+    public:
+        batch_impl_t(service_t& service);
+        batch_impl_t(const batch_impl_t& batch) = delete;
+        batch_impl_t& operator=(const batch_impl_t& batch) = delete;
+        ~batch_impl_t();
+
+    public:
+        void start_deadline(const batch_deadline_t& deadline);
+
+        /*
+          Takes the index of the next request.
+         */
+        size_t reserve();
+
+        /*
+          Gives back the index of a request which could not be sent.
+          An index taken after it cannot move, so it is skipped.
+         */
+        void release(const size_t index);
+
+        /*
+          The handler of the request with the index.
+         */
+        completion_handler_t handler(const size_t index);
+
+        /*
+          Keeps the connection of a request to stop it later, unless
+          the request is finished already. A request without one (a
+          cache hit or a join of an exchange in flight) is kept with
+          its request, so the batch can finish it itself.
+         */
+        void track(const size_t index,
+                   optional_t<connection_t>&& connection,
+                   const request_t& request);
+
+        void finish(const size_t index, response_t&& response);
+        optional_t<batch_result_t> wait_any();
+        optional_t<batch_result_t> try_pop();
+        void cancel(const string_t& msg);
+        size_t size() const;
+        size_t pending() const;
+
+    private:
+        optional_t<batch_result_t> pop();
+
+        /*
+          Queues the response of an unfinished request. Must be called
+          with the mutex locked.
+         */
+        void push(const size_t index, response_t&& response);
+
+    public:
+        service_t& service;
+
+    private:
+        mutable std::mutex mutex {};
+        std::condition_variable finished {};
+        std::deque<batch_result_t> results {};
+        vector_t<bool> complete {};
+        std::unordered_map<size_t, connection_t> in_flight {};
+        std::unordered_map<size_t, request_t> untracked {};
+        size_t complete_count {0};
+        size_t popped_count {0};
+        optional_t<string_t> canceled {};
+        wheel_timer_t deadline_timer;
+    };
+
+    batch_impl_t::batch_impl_t(service_t& service_)
+        : service(service_),
+          deadline_timer(service_.get_timers())
+    {
+
+    }
+
+    batch_impl_t::~batch_impl_t()
+    {
+
+    }
+
+    void batch_impl_t::start_deadline(const batch_deadline_t& deadline) {
+        if (deadline.empty())
+            return;
+
+        const std::weak_ptr<batch_impl_t> weak = shared_from_this();
+        deadline_timer.expires_from_now(deadline.value());
+        deadline_timer.async_wait([weak](const ec_t& ec) {
+            const auto self = weak.lock();
+            if (self and not ec)
+                self->cancel("batch deadline");
+        });
+    }
+
+    size_t batch_impl_t::reserve() {
+        const lock_t lock(mutex);
+        complete.push_back(false);
+        return complete.size() - 1;
+    }
+
+    void batch_impl_t::release(const size_t index) {
+        {
+            const lock_t lock(mutex);
+            if (index + 1 == complete.size()) {
+                complete.pop_back();
+            }
+            else {
+                complete[index] = true;
+                ++complete_count;
+                ++popped_count;
+            }
+        }
+        finished.notify_all();
+    }
+
+    completion_handler_t batch_impl_t::handler(const size_t index) {
+        const auto self = shared_from_this();
+        return [self, index](response_t&& response) {
+            self->finish(index, std::move(response));
+        };
+    }
+
+    void batch_impl_t::track(const size_t index,
+                             optional_t<connection_t>&& connection,
+                             const request_t& request)
+    {
+        {
+            const lock_t lock(mutex);
+            if (complete[index])
+                return;
+
+            if (connection) {
+                if (canceled)
+                    connection->cancel(*canceled);
+                else
+                    in_flight.emplace(index, std::move(*connection));
+                return;
+            }
+
+            if (not canceled) {
+                untracked.emplace(index, request);
+                return;
+            }
+
+            push(index, canceled_response(request, *canceled));
+        }
+        finished.notify_all();
+    }
+
+    /*
+      A request the batch has finished itself may still complete
+      later; that response is dropped.
+     */
+    void batch_impl_t::finish(const size_t index, response_t&& response) {
+        {
+            const lock_t lock(mutex);
+            if (complete[index])
+                return;
+
+            push(index, std::move(response));
+        }
+        finished.notify_all();
+    }
+
+    void batch_impl_t::push(const size_t index, response_t&& response) {
+        complete[index] = true;
+        ++complete_count;
+        in_flight.erase(index);
+        untracked.erase(index);
+        results.push_back(batch_result_t {index, std::move(response)});
+    }
+
+    optional_t<batch_result_t> batch_impl_t::pop() {
+        if (results.empty())
+            return boost::none;
+
+        optional_t<batch_result_t> result {std::move(results.front())};
+        results.pop_front();
+        ++popped_count;
+        return result;
+    }
+
+    optional_t<batch_result_t> batch_impl_t::wait_any() {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this]() {
+            return not results.empty() or popped_count == complete.size();
+        });
+        return pop();
+    }
+
+    optional_t<batch_result_t> batch_impl_t::try_pop() {
+        const lock_t lock(mutex);
+        return pop();
+    }
+
+    /*
+      Connections finish with a CANCELED response of their own. Cache
+      hits and joins have none to stop, so they are finished here.
+     */
+    void batch_impl_t::cancel(const string_t& msg) {
+        {
+            const lock_t lock(mutex);
+            if (canceled)
+                return;
+
+            canceled = msg;
+            for (auto& connection : in_flight)
+                connection.second.cancel(msg);
+
+            const auto requests = std::move(untracked);
+            untracked.clear();
+            for (const auto& request : requests)
+                push(request.first, canceled_response(request.second, msg));
+        }
+        finished.notify_all();
+    }
+
+    size_t batch_impl_t::size() const {
+        const lock_t lock(mutex);
+        return complete.size();
+    }
+
+    size_t batch_impl_t::pending() const {
+        const lock_t lock(mutex);
+        return complete.size() - complete_count;
+    }
+
+
+    /************************************************************
+     * batch_t section.
+     ************************************************************/
+
+
+    batch_t::batch_t(service_t& service)
+        : pimpl {std::make_shared<batch_impl_t>(service)}
+    {
+
+    }
+
+    batch_t::batch_t(service_t& service, const batch_deadline_t& deadline)
+        : pimpl {std::make_shared<batch_impl_t>(service)}
+    {
+        pimpl->start_deadline(deadline);
+    }
+
+    batch_t::batch_t(batch_t&& batch)
+        : pimpl {std::move(batch.pimpl)}
+    {
+        batch.pimpl = nullptr;
+    }
+
+    batch_t& batch_t::operator=(batch_t&& batch) {
+        if (this != &batch) {
+            if (pimpl)
+                pimpl->cancel("canceled");
+            pimpl = std::move(batch.pimpl);
+            batch.pimpl = nullptr;
+        }
+
+        return *this;
+    }
+
+    batch_t::~batch_t()
+    {
+        if (pimpl)
+            pimpl->cancel("canceled");
+    }
+
+    size_t batch_t::add(const session_t& session) {
+        if (not pimpl)
+            throw std::logic_error("batch_t is moved from");
+
+        const auto index = pimpl->reserve();
+        optional_t<connection_t> connection;
+        try {
+            connection = session.Dispatch(pimpl->handler(index), true);
+        }
+        catch (...) {
+            pimpl->release(index);
+            throw;
+        }
+        pimpl->track(index, std::move(connection), session.get_request());
+        return index;
+    }
+
+    optional_t<batch_result_t> batch_t::wait_any() {
+        if (not pimpl)
+            return boost::none;
+
+        return pimpl->wait_any();
+    }
+
+    optional_t<batch_result_t> batch_t::try_pop() {
+        if (not pimpl)
+            return boost::none;
+
+        return pimpl->try_pop();
+    }
+
+    batch_t::iterator_t batch_t::begin() {
+        return iterator_t(*this);
+    }
+
+    batch_t::iterator_t batch_t::end() {
+        return iterator_t();
+    }
+
+    void batch_t::cancel() {
+        if (pimpl)
+            pimpl->cancel("canceled");
+    }
+
+    size_t batch_t::size() const {
+        return pimpl ? pimpl->size() : 0;
+    }
+
+    size_t batch_t::pending() const {
+        return pimpl ? pimpl->pending() : 0;
+    }
+
+    service_t& batch_t::get_service() const {
+        if (not pimpl)
+            throw std::logic_error("batch_t is moved from");
+
+        return pimpl->service;
+    }
+
+
+    /************************************************************
+     * batch_t::iterator_t section.
+     ************************************************************/
+
+
+    batch_t::iterator_t::iterator_t()
+        : batch(nullptr),
+          current()
+    {
+
+    }
+
+    batch_t::iterator_t::iterator_t(batch_t& batch_)
+        : batch(&batch_),
+          current()
+    {
+        ++*this;
+    }
+
+    batch_result_t& batch_t::iterator_t::operator*() {
+        return *current;
+    }
+
+    batch_result_t* batch_t::iterator_t::operator->() {
+        return &*current;
+    }
+
+    batch_t::iterator_t& batch_t::iterator_t::operator++() {
+        current = batch->wait_any();
+        if (not current)
+            batch = nullptr;
+        return *this;
+    }
+
+    bool batch_t::iterator_t::operator==(const iterator_t& rhs) const {
+        return batch == rhs.batch;
+    }
+
+    bool batch_t::iterator_t::operator!=(const iterator_t& rhs) const {
+        return not (*this == rhs);
+    }
+
+
+} /* namespace crequests */
@@ -0,0 +1,167 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "macros.h"
+#include "response.h"
+#include "session.h"
+#include "types.h"
+
+#include <cstddef>
+#include <iterator>
+
+namespace crequests {
+
+    declare_duration(batch_deadline)
+
+    /*
+      A response of a batch and the index of its request, in the order
+      the requests were added.
+     */
+    struct batch_result_t {
+        size_t index;
+        response_t response;
+    };
+
+    /*
+      Requests sent together whose responses are taken in the order
+      they finish, so a slow request does not hold back the others.
+
+      Each request is sent when it is added, with a completion handler
+      (no promise, no future), and its response is queued as soon as it
+      is complete. wait_any() waits for the next one, try_pop() does
+      not wait, and iterating the batch gives all of them in the order
+      they finish. Taking responses must not be done on a service thread.
+
+      When the deadline of the batch passes, on cancel() or when the
+      batch is destroyed, the requests still in flight are stopped with
+      a CANCELED error: every request gives exactly one response. This
+      includes cache hits and requests joined to an exchange of another
+      session, whose later responses are dropped. A request of a batch
+      joins coalesced exchanges in flight but never leads one, so
+      stopping it does not fail requests of other sessions.
+
+      A moved-from batch is empty: it takes no responses and adding a
+      request to it throws std::logic_error.
+     */
+    class batch_t {
+    public:
+        class iterator_t {
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = batch_result_t;
+            using difference_type = std::ptrdiff_t;
+            using pointer = batch_result_t*;
+            using reference = batch_result_t&;
+
+        public:
+            iterator_t();
+            explicit iterator_t(batch_t& batch);
+            iterator_t(const iterator_t& iterator) = default;
+            iterator_t(iterator_t&& iterator) = default;
+            iterator_t& operator=(const iterator_t& iterator) = default;
+            iterator_t& operator=(iterator_t&& iterator) = default;
+
+            batch_result_t& operator*();
+            batch_result_t* operator->();
+            iterator_t& operator++();
+            bool operator==(const iterator_t& rhs) const;
+            bool operator!=(const iterator_t& rhs) const;
+
+        private:
+            batch_t* batch;
+            optional_t<batch_result_t> current;
+        };
+
+    public:
+        batch_t(service_t& service);
+        batch_t(service_t& service, const batch_deadline_t& deadline);
+        batch_t(const batch_t& batch) = delete;
+        batch_t(batch_t&& batch);
+        batch_t& operator=(const batch_t& batch) = delete;
+        batch_t& operator=(batch_t&& batch);
+        ~batch_t();
+
+    public:
+        template <class... Args>
+        size_t Get(Args&&... args) {
+            return add(method_t {"GET"}, std::forward<Args>(args)...);
+        }
+
+        template <class... Args>
+        size_t Post(Args&&... args) {
+            return add(method_t {"POST"}, std::forward<Args>(args)...);
+        }
+
+        template <class... Args>
+        size_t Put(Args&&... args) {
+            return add(method_t {"PUT"}, std::forward<Args>(args)...);
+        }
+
+        template <class... Args>
+        size_t Patch(Args&&... args) {
+            return add(method_t {"PATCH"}, std::forward<Args>(args)...);
+        }
+
+        template <class... Args>
+        size_t Delete(Args&&... args) {
+            return add(method_t {"DELETE"}, std::forward<Args>(args)...);
+        }
+
+        template <class... Args>
+        size_t Head(Args&&... args) {
+            return add(method_t {"HEAD"}, std::forward<Args>(args)...);
+        }
+
+        /*
+          Sends the request of the session with its method. Returns the
+          index of the request. An exception of the send is passed on
+          and the request is not part of the batch.
+         */
+        size_t add(const session_t& session);
+
+        /*
+          The next finished response. Waits for it while requests are
+          in flight, returns none when every response was taken.
+         */
+        optional_t<batch_result_t> wait_any();
+
+        /*
+          The next finished response if there is one.
+         */
+        optional_t<batch_result_t> try_pop();
+
+        iterator_t begin();
+        iterator_t end();
+
+        /*
+          Stops the requests in flight.
+         */
+        void cancel();
+
+        /*
+          The number of requests added.
+         */
+        size_t size() const;
+
+        /*
+          The number of requests which are not finished.
+         */
+        size_t pending() const;
+
+    private:
+        template <class... Args>
+        size_t add(const method_t& method, Args&&... args) {
+            session_t session(get_service());
+            set_option(session, method, std::forward<Args>(args)...);
+            return add(session);
+        }
+
+        service_t& get_service() const;
+
+    private:
+        shared_ptr_t<class batch_impl_t> pimpl;
+    };
+
+} /* namespace crequests */
+
+#endif /* BATCH_H */
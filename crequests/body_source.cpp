@@ -0,0 +1,166 @@
+#include "body_source.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace crequests {
+
+
+    namespace {
+
+        std::system_error system_error(const string_t& what) {
+            return std::system_error(errno, std::generic_category(), what);
+        }
+
+        /*
+          Reads at offset, or at the current position of the descriptor
+          when offset is negative.
+         */
+        size_t read_fd(const int fd, char* buffer, const size_t size, const off_t offset) {
+            while (true) {
+                const auto length = offset < 0
+                    ? ::read(fd, buffer, size)
+                    : ::pread(fd, buffer, size, offset);
+                if (length >= 0)
+                    return static_cast<size_t>(length);
+                if (errno != EINTR)
+                    throw system_error("read");
+            }
+        }
+
+        shared_ptr_t<int> open_path(const string_t& path) {
+            const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                throw system_error("open " + path);
+
+            return shared_ptr_t<int>(new int(fd), [](int* fd_) {
+                ::close(*fd_);
+                delete fd_;
+            });
+        }
+
+        size_t size_after(const int fd, const off_t offset) {
+            struct stat status;
+            if (::fstat(fd, &status) != 0)
+                throw system_error("fstat");
+            return static_cast<size_t>(std::max<off_t>(status.st_size - offset, 0));
+        }
+
+        body_reader_t fd_reader(const shared_ptr_t<int>& fd, off_t offset) {
+            return [fd, offset](char* buffer, const size_t size) mutable {
+                const auto length = read_fd(*fd, buffer, size, offset);
+                if (offset >= 0)
+                    offset += static_cast<off_t>(length);
+                return length;
+            };
+        }
+
+    } /* anonymous namespace */
+
+
+    body_source_t::body_source_t() {
+
+    }
+
+    body_source_t body_source_t::from_file(const string_t& path) {
+        body_source_t body;
+
+        body.m_open = [path]() {
+            return fd_reader(open_path(path), 0);
+        };
+
+        struct stat status;
+        if (::stat(path.c_str(), &status) == 0 and S_ISREG(status.st_mode)) {
+            body.m_size = static_cast<size_t>(status.st_size);
+            body.m_open_file = [path]() {
+                const auto fd = open_path(path);
+                return body_file_t{fd, 0, size_after(*fd, 0)};
+            };
+        }
+
+        return body;
+    }
+
+    /*
+      Only a regular file has a size and can be read again by offset.
+     */
+    body_source_t body_source_t::from_fd(const int fd) {
+        body_source_t body;
+
+        const auto descriptor = std::make_shared<int>(fd);
+
+        struct stat status;
+        auto offset = ::lseek(fd, 0, SEEK_CUR);
+        if (offset >= 0 and ::fstat(fd, &status) == 0 and S_ISREG(status.st_mode)) {
+            body.m_size = size_after(fd, offset);
+            body.m_open_file = [descriptor, offset]() {
+                return body_file_t{descriptor,
+                                   static_cast<size_t>(offset),
+                                   size_after(*descriptor, offset)};
+            };
+        }
+        else {
+            offset = -1;
+        }
+
+        body.m_open = [descriptor, offset]() {
+            return fd_reader(descriptor, offset);
+        };
+
+        return body;
+    }
+
+    body_source_t body_source_t::from_reader(const body_reader_t& reader) {
+        body_source_t body;
+        body.m_open = [reader]() {
+            return reader;
+        };
+        return body;
+    }
+
+    body_source_t body_source_t::from_reader(const body_reader_t& reader, const size_t size) {
+        auto body = from_reader(reader);
+        body.m_size = size;
+        return body;
+    }
+
+    bool body_source_t::empty() const {
+        return not m_open;
+    }
+
+    const optional_t<size_t>& body_source_t::size() const {
+        return m_size;
+    }
+
+    body_reader_t body_source_t::open() const {
+        return m_open();
+    }
+
+    bool body_source_t::is_file() const {
+        return static_cast<bool>(m_open_file);
+    }
+
+    body_file_t body_source_t::open_file() const {
+        return m_open_file();
+    }
+
+    std::ostream& operator<<(std::ostream& out, const body_source_t& body_source) {
+        out << "body_source_t(";
+        if (body_source.empty())
+            out << "empty";
+        else if (body_source.size())
+            out << *body_source.size();
+        else
+            out << "chunked";
+        out << ")";
+        return out;
+    }
+
+
+} /* namespace crequests */
@@ -0,0 +1,92 @@
+#ifndef BODY_SOURCE_H
+#define BODY_SOURCE_H
+
+#include "types.h"
+
+#include <functional>
+
+namespace crequests {
+
+    /*
+      Reads the next part of a request body into buffer, at most size
+      bytes, and returns how many bytes were read. Zero ends the body.
+      It is called on a service thread; an exception fails the request
+      with WRITE_ERROR.
+     */
+    using body_reader_t = std::function<size_t(char* buffer, const size_t size)>;
+
+
+    /*
+      A body which is a regular file, opened to be sent without being
+      read into memory. size is what the file holds after offset.
+     */
+    struct body_file_t {
+        shared_ptr_t<int> fd;
+        size_t offset;
+        size_t size;
+    };
+
+
+    /*
+      A request body which is read in parts while it is sent, so it is
+      never held in memory as a whole. It comes from a file, an open
+      file descriptor or a reader. A body of known size is sent with
+      Content-Length, otherwise with Transfer-Encoding: chunked.
+
+      A file is opened again and a regular file descriptor is read
+      again from its starting offset for every send, so redirects and
+      retries repeat the body. A pipe, a socket or a reader are read
+      only once.
+
+      A regular file is not read by the library at all: it is sent with
+      sendfile(2) over plain HTTP and written from a memory mapping over
+      TLS. It must not shrink while it is sent.
+     */
+    class body_source_t {
+    public:
+        body_source_t();
+
+        /*
+          The size is taken when the source is made. The file is
+          opened when the request is sent.
+         */
+        static body_source_t from_file(const string_t& path);
+
+        /*
+          The descriptor is read from its current offset and is not
+          closed. It has to stay open while the request is sent.
+         */
+        static body_source_t from_fd(const int fd);
+
+        static body_source_t from_reader(const body_reader_t& reader);
+        static body_source_t from_reader(const body_reader_t& reader, const size_t size);
+
+    public:
+        bool empty() const;
+        const optional_t<size_t>& size() const;
+
+        /*
+          A reader of the body from its start. Throws std::system_error
+          when the body cannot be opened.
+         */
+        body_reader_t open() const;
+
+        /*
+          True when the body is a regular file, from from_file() or
+          from_fd(). Such a body can also be opened with open_file().
+         */
+        bool is_file() const;
+        body_file_t open_file() const;
+
+    private:
+        std::function<body_reader_t()> m_open {};
+        std::function<body_file_t()> m_open_file {};
+        optional_t<size_t> m_size {};
+    };
+
+    std::ostream& operator<<(std::ostream& out, const body_source_t& body_source);
+
+
+} /* namespace crequests */
+
+#endif /* BODY_SOURCE_H */
@@ -6,6 +6,7 @@
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
 #include <boost/asio/steady_timer.hpp>
+#include <boost/version.hpp>
 
 namespace crequests {
     
@@ -23,6 +24,24 @@ namespace crequests {
     using timer_ptr_t = shared_ptr_t<timer__t>;
     using strand_t = boost::asio::io_service::strand;
 
+    /*
+      Makes a resolver answer from known endpoints. Since Boost 1.66
+      answers are created by basic_resolver_results which is still
+      a basic_resolver_iterator.
+     */
+    template <class EndpointIteratorT>
+    inline resolver_iterator_t make_resolver_iterator(EndpointIteratorT begin,
+                                                      EndpointIteratorT end,
+                                                      const std::string& host,
+                                                      const std::string& port)
+    {
+#if BOOST_VERSION >= 106600
+        return resolver_t::results_type::create(begin, end, host, port);
+#else
+        return resolver_iterator_t::create(begin, end, host, port);
+#endif
+    }
+
 } /* namespace crequests */
 
 #endif /* BOOST_ASIO_H */
@@ -16,6 +16,10 @@ namespace boost {
             template <class T>
             class basic_resolver_iterator;
         }
+
+        namespace ssl {
+            class context;
+        }
     }
 }
 
@@ -29,6 +33,8 @@ namespace crequests {
     using ioservice_ptr_t = shared_ptr_t<ioservice_t>;
     using resolver_iterator_t =
         boost::asio::ip::basic_resolver_iterator<boost::asio::ip::tcp>;
+    using ssl_context_t = boost::asio::ssl::context;
+    using ssl_context_ptr_t = shared_ptr_t<ssl_context_t>;
 
     
 } /* namespace crequests */
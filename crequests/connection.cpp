@@ -1,75 +1,78 @@
 #include "boost_asio.h"
 #include "connection.h"
+#include "decoder.h"
+#include "dns.h"
 #include "parser.h"
+#include "pool.h"
 #include "request.h"
 #include "response.h"
 #include "service.h"
+#include "ssl_context.h"
 #include "stream.h"
+#include "timer_wheel.h"
 #include "utils.h"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
 #include <thread>
 
+#include <sys/mman.h>
+#include <unistd.h>
+
 namespace crequests {
 
 
     namespace {
 
-        template <class StreamBufT>
-        headers_t parse_headers(StreamBufT&& response_buf) {
-            std::istream response_stream(&response_buf);
-            headers_t headers;
-
-            string_t header;
-            while (std::getline(response_stream, header) && header != "\r") {
-                const auto ind = header.find(":");
-                if (ind != string_t::npos)
-                    headers.emplace(
-                        trim(header.substr(0, ind)),
-                        trim(header.substr(ind + 2))
-                    );
-            }
-
-            return headers;
-        }
+        using steady_clock_t = std::chrono::steady_clock;
 
-        template <class T>
-        optional_t<std::size_t> parse_chunk_length(T&& chunkHeader) {
-            try {
-                return std::stoull(std::forward<T>(chunkHeader), 0, 16);
-            } catch (...) {
-                return boost::none;
-            }
-        }
-
-        template <class StreamBufT>
-        string_t read_buffer(StreamBufT& response_buf, const std::size_t length) {
-            if (length == 0)
-                return "";
-
-            vector_t<char> buf(length);
-            response_buf.sgetn(&buf[0], length);
-
-            return string_t(buf.begin(), buf.end());
-        }
-
-        template <class StreamBufT>
-        bool consume_crlf(StreamBufT& buf) {
-            std::istream in(&buf);
-            char c {};
+        /*
+          Size of one read from the socket. Small responses
+          arrive in a single read of this size.
+         */
+        constexpr size_t READ_BUFFER_SIZE = 16384;
 
-            return in.get(c) and c == '\r' and in.get(c) and c == '\n';
-        }
+        /*
+          Most memory reserved for a body up front. Content-Length comes
+          from the server, and a larger body grows as it arrives.
+         */
+        constexpr size_t MAX_BODY_RESERVE = READ_BUFFER_SIZE * 64;
 
-        template <class StreamBufT>
-        optional_t<size_t> peek_crlf(StreamBufT& sbuf) {
-            const auto begin = boost::asio::buffers_begin(sbuf.data());
-            const auto end = boost::asio::buffers_end(sbuf.data());
+        /*
+          Size of one part of a streamed request body. It bounds the
+          memory an upload takes, whatever the size of the body.
+         */
+        constexpr size_t BODY_PART_SIZE = 65536;
 
-            for (auto it = begin; it != end; ++it)
-                if (*it == '\r' && (it + 1) != end && *(it + 1) == '\n')
-                    return std::distance(begin, it);
+        /*
+          Size of one part of a file body, sent by sendfile(2) or
+          written from its mapping. Nothing is copied for it, so it
+          is larger.
+         */
+        constexpr size_t FILE_PART_SIZE = 1048576;
 
-            return boost::none;
+        /*
+          Error of a response which ended while being read in the
+          given state.
+         */
+        error_code_t read_error_of(const error_code_t& state) {
+            switch (state) {
+            case error_code_t::READ_HEADERS:
+                return error_code_t::READ_HEADERS_ERROR;
+            case error_code_t::READ_CONTENT_LENGTH:
+                return error_code_t::READ_CONTENT_LENGTH_ERROR;
+            case error_code_t::READ_CHUNK_HEADER:
+                return error_code_t::READ_CHUNK_HEADER_ERROR;
+            case error_code_t::READ_CHUNK_DATA:
+                return error_code_t::READ_CHUNK_DATA_ERROR;
+            case error_code_t::READ_UNTIL_EOF:
+                return error_code_t::READ_UNTIL_EOF_ERROR;
+            default:
+                return error_code_t::READ_STATUS_ERROR;
+            }
         }
 
         template <class ErrorT>
@@ -89,6 +92,30 @@ namespace crequests {
                  ec.value() == boost::asio::ssl::error::stream_truncated);
         }
 
+        /*
+          Whether some of the request may have been written by the time
+          the exchange is in the given state.
+         */
+        bool is_sent(const error_code_t& state) {
+            switch (state) {
+            case error_code_t::INIT:
+            case error_code_t::RESOLVE:
+            case error_code_t::CONNECT:
+            case error_code_t::HANDSHAKE:
+                return false;
+            default:
+                return true;
+            }
+        }
+
+        /*
+          A body_source() which is not a file is read only once, so a
+          request with it cannot be written again.
+         */
+        bool is_resendable(const request_t& request) {
+            return request.body_source().empty() or request.body_source().is_file();
+        }
+
         bool is_redirect_code(const status_code_t& code) {
             return
                 code == status_code_t(301) or
@@ -102,6 +129,27 @@ namespace crequests {
                 response.request().redirect_count().value();
         }
 
+        /*
+          A TLS stream is only reused by requests with the same TLS
+          settings, so it is never given to a request which asks for
+          another peer verification or client certificate.
+         */
+        string_t pool_key(const request_t& request) {
+            auto key =
+                request.uri().protocol().value() + "://" +
+                request.uri().domain().value() + ":" +
+                request.uri().port().value();
+            if (request.is_ssl())
+                key += "#" + ssl_context_fingerprint(request);
+            return key;
+        }
+
+        string_t ssl_session_key(const request_t& request) {
+            return
+                request.uri().domain().value() + ":" +
+                request.uri().port().value();
+        }
+
 
     } /* anonymous namespace */
 
@@ -111,7 +159,8 @@ namespace crequests {
     ************************************************************/
 
 
-    class conn_impl_t : public std::enable_shared_from_this<conn_impl_t> {
+    class conn_impl_t : public std::enable_shared_from_this<conn_impl_t>,
+                        public parser_handler_t {
     public:
         /*
           For creating a new connection you need aservice instance
@@ -147,6 +196,13 @@ namespace crequests {
           This connection will ends up in a background process.
         */
         void restart();
+
+        /*
+          Restarts a request which was written to a stale connection,
+          or fails it with WRITE_ERROR when its body cannot be written
+          again.
+        */
+        void resend();
         
         /*
           Function which gives us an object for the future response.
@@ -163,6 +219,12 @@ namespace crequests {
         */
         bool is_expired() const;
 
+        /*
+          Ends the connection with a CANCELED error unless it is
+          already done.
+         */
+        void cancel(const string_t& msg);
+
     private:
         /*
           This functions starts resolving process.
@@ -219,102 +281,74 @@ namespace crequests {
         void on_write(const ec_t& ec, const std::size_t&);
 
         /*
-          This function starts after writing process and trying to
-          read status of the incoming HTTP response from remote
-          server.
-         */
-        void read_status();
-
-        /*
-          This function starts when read status process is done.
-          The process may ends up with an error.
-         */
-        void on_read_status(const ec_t& ec, const std::size_t&);
-
-        /*
-          This function starts after read status process and trying to
-          read HTTP headers of the remote server response body.
-         */
-        void read_headers();
-
-        /*
-          This function starts when headers reading is done.
-          The process may ends up with an error.
+          These functions send a body_source() of the request in parts,
+          one part per write, with the head in front of the first one.
          */
-        void on_read_headers(const ec_t& ec, const std::size_t&);
+        void write_body_part();
+        void on_write_body_part(const ec_t& ec, const bool is_last);
 
         /*
-          This function is responsible for reading content of the remote
-          server response. Content can be readed in several ways.
-          It's can be content length enabled in headers. So we are reading
-          precise length of the body.
-          Or it can be chunk encoding response. It is a response which remote
-          server send to us part by part of fixed size.
-          In other way we must use fallback which read body data until it is an end.
+          These functions send a body_source() which is a regular file.
+          Over plain HTTP the head is written first and the file follows
+          with sendfile(2), a part each time the socket is writable.
+          Over TLS the file is mapped and its parts are written from
+          the mapping, with the head in front of the first one.
          */
-        void read_content();
+        void write_file();
+        void send_file_part();
+        void write_mapped_file();
+        void write_mapped_part();
+        void on_write_mapped_part(const ec_t& ec, const size_t length);
 
         /*
-          This fuction read body of fixed size according to content length in headers.
+          This function reads whatever the remote server has sent so far
+          into the response buffer. The parser decides from the data what
+          is read: status, headers, content length, chunks or body until EOF.
          */
-        void read_content_length();
+        void read_response();
 
         /*
-          This function starts when reading body is done.
+          This function starts when some data is read. It feeds all of it
+          to the parser and reads again until the message is complete.
           The process may ends up with an error.
          */
-        void on_read_content_length(const ec_t& ec,
-                                    const std::size_t length);
+        void on_read_response(const ec_t& ec, const std::size_t length);
 
         /*
-          This function read header of chunk encoding protocol.
-          This header contains length of the next data after it.
-         */
-        void read_chunk_header();
-
-        /*
-          This function reads chunk data of the chunk encoding protocol.
-          If remote server has another data for us then header-data process
-          will repeat.
-         */
-        void read_chunk_data();
-        
-        /*
-          This function starts when reading chunk header is done.
-          The process may ends up with an error.
+          This function always setup timeout of connection.
+          This timeout is set in request data.
          */
-        void on_read_chunk_header(const ec_t& ec,
-                                  const std::size_t);
+        void setup_timeout();
 
         /*
-          This function starts when reading chunk data is done.
-          The process may ends up with an error.
+          This function starts when time is out and set state accordingly.
          */
-        void on_read_chunk_data(const ec_t& ec,
-                                const std::size_t);
+        void on_timeout(const ec_t& ec);
 
         /*
-          If it is not exists content length or chunk data we try to read
-          remote server response until EOF in the socket.
+          Arms the timeout of the current phase of the exchange (connect,
+          handshake or waiting for the first byte). The phase ends with
+          the given message if it is not over in time. A zero timeout
+          only cancels the timeout of the previous phase.
          */
-        void read_until_eof();
+        void setup_phase_timeout(const milliseconds_t& timeout, const string_t& msg);
 
         /*
-          This function starts when reading some data portion from socket is done.
-          The process may ends up with an error.
+          This function starts when the phase is timed out.
          */
-        void on_read_until_eof(const ec_t& ec, const std::size_t length);
+        void on_phase_timeout(const ec_t& ec, const string_t& msg);
 
         /*
-          This function always setup timeout of connection.
-          This timeout is set in request data.
+          Arms the idle read timeout of the response. It expires when no
+          data has been received for read_timeout since the last read.
          */
-        void setup_timeout();
+        void setup_read_timeout();
 
         /*
-          This function starts when time is out and set state accordingly.
+          This function starts when the read timeout is expired and checks
+          whether some data arrived in between.
          */
-        void on_timeout(const ec_t& ec);
+        void on_read_timeout(const ec_t& ec);
 
         /*
           This functions setup timeout for final response (with an error or not).
@@ -335,13 +369,26 @@ namespace crequests {
          */
         void perform_redirect();
 
+        /*
+          Schedules the next attempt of the request when its retry policy
+          allows one for the error, or for the status of the response when
+          the error is SUCCESS. The attempt starts after a backoff on the
+          retry timer. Returns false when the exchange has to end instead.
+         */
+        bool retry(const error_code_t& error);
+
+        /*
+          Sends the request again with a new response and stream.
+         */
+        void on_retry_timer(const ec_t& ec);
+
         /*
           Functions for working with states of connection mechanism.
          */
         void set_error(const error_code_t& new_state, const string_t& msg);
         void set_error(const error_code_t& new_state, const ec_t& ec);
         void set_success();
-        void set_timeout();
+        void set_timeout(const string_t& msg);
         void set_dispose();
         void set_state(const error_code_t& state_);
         bool in_final_state() const;
@@ -352,6 +399,20 @@ namespace crequests {
          */
         void end();
 
+        /*
+          This function takes an idle keep-alive stream to the same host
+          from the service pool. Returns true if one was found.
+         */
+        bool acquire_stream();
+
+        /*
+          This function gives the stream of a successfully completed
+          keep-alive exchange back to the service pool so the next
+          request to the same host skips connect and handshake.
+          Returns true if the stream was taken by the pool.
+         */
+        bool release_stream();
+
         /*
           This function returns true if this connection reuse previous connection.
           This behaviour can be done when keep-alive is enabled and we want to
@@ -360,14 +421,36 @@ namespace crequests {
         bool is_reused() const;
 
         /*
-          Set up all neccessary parameters and callbacks for http parser.
+          Clears the state the parser callbacks fill in for a new response.
          */
         void prepare_parser();
 
         /*
-          Start parser which will consume some data read from socket and do parsing
-          of http response or part of http response.
-          Can be called several times due to obtain remote server data from socket.
+          Callbacks of the response parser, called by it directly.
+         */
+        friend class basic_parser_t<conn_impl_t>;
+        void on_status(const char* at,
+                       const size_t length,
+                       const unsigned short major,
+                       const unsigned short minor,
+                       const unsigned int code);
+        void on_header_field(const char* at, const size_t length);
+        void on_header_value(const char* at, const size_t length);
+        void on_headers_complete(const size_t content_len);
+        void on_body(const char* at, const size_t length);
+        void on_chunk_header(const size_t length);
+        void on_chunk_complete();
+        void on_message_complete();
+
+        /*
+          Adds the header collected by the field and value callbacks,
+          which may come in pieces when a header spans two reads.
+         */
+        void add_header();
+
+        /*
+          Feeds all data of the response buffer to the parser.
+          Returns false if the data is not a valid response.
          */
         bool execute_parser();
 
@@ -375,45 +458,87 @@ namespace crequests {
         service_t& service;
         strand_t strand;
         stream_t stream;
-        resolver_t resolver;
-        timer__t timeout_timer;
-        timer__t dispose_timer;
-        promise_t<response_t> promise;
+        wheel_timer_t timeout_timer;
+        wheel_timer_t phase_timer;
+        wheel_timer_t dispose_timer;
+        wheel_timer_t retry_timer;
+        steady_clock_t::time_point last_read_time;
+        steady_clock_t::time_point deadline;
+        size_t attempt;
+        optional_t<promise_t<response_t> > promise;
         future_t<response_t> future;
+        completion_handler_t handler;
         response_t response;
         bool m_is_reused;
         error_code_t state;
 
-        streambuf_t request_buf;
+        string_t request_head;
+        body_reader_t body_reader;
+        optional_t<size_t> body_left;
+        vector_t<char> body_part;
+        string_t chunk_head;
+        optional_t<body_file_t> body_file;
+        off_t body_offset;
+        shared_ptr_t<void> body_mapping;
+        const char* body_data;
         streambuf_t response_buf;
 
-        parser_t* parser {nullptr};
+        basic_parser_t<conn_impl_t> parser;
 
         string_t header_field;
-        size_t content_length {0};
+        string_t header_value;
+        bool is_header_value {false};
+        bool message_complete {false};
         raw_t raw;
+        content_decoder_t decoder;
+        string_t content;
+        string_t content_error;
         headers_t headers;
+        header_block_t header_block;
+        optional_t<response_t> stale;
+        string_t flight;
     };
 
     conn_impl_t::conn_impl_t(service_t& service_, const request_t& request_)
         : service(service_),
           strand(service.get_service()),
-          stream(service.get_service(), request_),
-          resolver(service.get_service()),
-          timeout_timer(service.get_service()),
-          dispose_timer(service.get_service()),
-          promise(),
-          future{promise.get_future()},
+          stream(service.get_service(), request_, service.get_ssl_contexts()),
+          timeout_timer(service.get_timers()),
+          phase_timer(service.get_timers()),
+          dispose_timer(service.get_timers()),
+          retry_timer(service.get_timers()),
+          last_read_time(),
+          deadline(),
+          attempt(1),
+          promise{},
+          future{},
+          handler{},
           response(request_),
           m_is_reused(false),
           state{error_code_t::INIT},
-          request_buf{},
+          request_head{},
+          body_reader{},
+          body_left{},
+          body_part{},
+          chunk_head{},
+          body_file{},
+          body_offset{0},
+          body_mapping{},
+          body_data{nullptr},
           response_buf{},
-          parser{new parser_t(parser_t::parser_type_t::RESPONSE)},
+          parser{parser_t::parser_type_t::RESPONSE, *this},
           header_field{},
-          content_length{},
+          header_value{},
+          is_header_value{false},
+          message_complete{false},
           raw{},
-          headers{}
+          decoder{},
+          content{},
+          content_error{},
+          headers{},
+          header_block{},
+          stale{},
+          flight{}
     {
 
     }
@@ -424,31 +549,49 @@ namespace crequests {
         : service(service_),
           strand(service.get_service()),
           stream(std::move(connection.pimpl->stream)),
-          resolver(service.get_service()),
-          timeout_timer(service.get_service()),
-          dispose_timer(service.get_service()),
-          promise(),
-          future{promise.get_future()},
+          timeout_timer(service.get_timers()),
+          phase_timer(service.get_timers()),
+          dispose_timer(service.get_timers()),
+          retry_timer(service.get_timers()),
+          last_read_time(),
+          deadline(),
+          attempt(1),
+          promise{},
+          future{},
+          handler{},
           response(request_),
           m_is_reused(true),
           state{error_code_t::INIT},
-          request_buf{},
+          request_head{},
+          body_reader{},
+          body_left{},
+          body_part{},
+          chunk_head{},
+          body_file{},
+          body_offset{0},
+          body_mapping{},
+          body_data{nullptr},
           response_buf{},
-          parser{new parser_t(parser_t::parser_type_t::RESPONSE)},
+          parser{parser_t::parser_type_t::RESPONSE, *this},
           header_field{},
-          content_length{},
+          header_value{},
+          is_header_value{false},
+          message_complete{false},
           raw{},
-          headers{}
+          decoder{},
+          content{},
+          content_error{},
+          headers{},
+          header_block{},
+          stale{},
+          flight{}
     {
         response.redirects(connection.get().get().redirects());
     }
 
     conn_impl_t::~conn_impl_t()
     {
-        if (parser) {
-            delete parser;
-            parser = nullptr;
-        }
+
     }
 
 
@@ -458,84 +601,149 @@ namespace crequests {
 
     bool conn_impl_t::execute_parser() {
         const auto data = boost::asio::buffer_cast<const char*>(response_buf.data());
-        const auto nparsed = parser->execute(data, response_buf.size());
-        response_buf.consume(nparsed);
-        parser->unpause();
+        const auto size = response_buf.size();
+        const auto nparsed = parser.execute(data, size);
+        if (nparsed == 0 and size > 0)
+            return false;
 
-        return nparsed > 0;
+        response_buf.consume(nparsed);
+        return true;
     }
 
     void conn_impl_t::prepare_parser() {
         raw = ""_raw;
+        decoder = content_decoder_t();
+        content.clear();
+        content_error.clear();
         header_field = "";
-        content_length = 0;
+        header_value = "";
+        is_header_value = false;
+        message_complete = false;
         headers = ""_headers;
+        header_block.clear();
+    }
 
-        const auto status_fn = [this](const char* at,
-                                      const size_t length,
-                                      const unsigned short major,
-                                      const unsigned short minor,
-                                      const unsigned int code)
-        {
-            response.http_major(http_major_t{major});
-            response.http_minor(http_minor_t{minor});
-            response.status_code(status_code_t{code});
-            response.status_message(status_message_t{string_t(at, length)});
-            parser->pause();
-        };
+    void conn_impl_t::on_status(const char* at,
+                                const size_t length,
+                                const unsigned short major,
+                                const unsigned short minor,
+                                const unsigned int code)
+    {
+        response.http_major(http_major_t{major});
+        response.http_minor(http_minor_t{minor});
+        response.status_code(status_code_t{code});
+        response.status_message().value().append(at, length);
+        set_state(error_code_t::READ_HEADERS);
+    }
 
-        parser->bind_cb(status_fn);
+    void conn_impl_t::on_header_field(const char* at, const size_t length) {
+        if (response.request().lazy_headers()) {
+            header_block.append_name(at, length);
+            return;
+        }
 
-        const auto header_field_fn = [this](const char* at, const size_t length)
-        {
-            header_field.reserve(length);
-            header_field.assign(at, length);
-        };
+        if (is_header_value)
+            add_header();
+        header_field.append(at, length);
+    }
 
-        parser->bind_cb(parser_t::HEADER_FIELD, header_field_fn);
+    void conn_impl_t::on_header_value(const char* at, const size_t length) {
+        if (response.request().lazy_headers()) {
+            header_block.append_value(at, length);
+            return;
+        }
 
-        const auto header_value_fn = [this](const char* at, const size_t length)
-        {
-            string_t header_value(at, length);
-            if (tolower(header_field) == "set-cookie") {
-                auto cookie = cookie_t::from_string(header_value);
-                cookie.origin_domain(response.request().uri().domain().value());
-                cookie.origin_path(response.request().uri().path().value());
-                response.cookies().add(std::move(cookie));
-            }
-            headers.insert(header_field, std::move(header_value));
-            header_field.clear();
-        };
+        header_value.append(at, length);
+        is_header_value = true;
+    }
 
-        parser->bind_cb(parser_t::HEADER_VALUE, header_value_fn);
+    void conn_impl_t::add_header() {
+        if (header_name_of(header_field) == header_name_t::SET_COOKIE) {
+            auto cookie = cookie_t::from_string(header_value);
+            cookie.origin_domain(response.request().uri().domain().value());
+            cookie.origin_path(response.request().uri().path().value());
+            response.cookies().add(std::move(cookie));
+        }
+        headers.insert(header_field, header_value);
+        header_field.clear();
+        header_value.clear();
+        is_header_value = false;
+    }
 
-        const auto headers_complete_fn = [this](const ssize_t content_len)
-        {
-            content_length = content_len;
+    void conn_impl_t::on_headers_complete(const size_t content_len) {
+        if (response.request().lazy_headers()) {
+            response.header_block(std::move(header_block));
+        }
+        else {
+            if (is_header_value)
+                add_header();
             response.headers(std::move(headers));
-            parser->pause();
-        };
+        }
 
-        parser->bind_cb(parser_t::HEADERS_COMPLETE, headers_complete_fn);
+        decoder = content_decoder_t::from_encoding(response.header("Content-Encoding"));
+
+        if (response.has_header("Content-Length")) {
+            set_state(error_code_t::READ_CONTENT_LENGTH);
+            if (decoder.empty() and not response.request().body_callback())
+                raw.value().reserve(std::min<size_t>(content_len, MAX_BODY_RESERVE));
+        }
+        else if (response.header_contains("Transfer-Encoding", "chunked")) {
+            set_state(error_code_t::READ_CHUNK_HEADER);
+        }
+        else {
+            set_state(error_code_t::READ_UNTIL_EOF);
+        }
+    }
 
-        const auto body_fn = [this](const char* at, const size_t length)
-        {
-            if (response.request().body_callback())
-                response.request().body_callback()(at, length, error_t{});
+    /*
+      An encoded body is decoded as it arrives. The body callback gets
+      the decoded parts; otherwise they make the content, which is the
+      only copy kept: the encoded body is not. Data which cannot be
+      decoded pauses the parser and fails the response.
+     */
+    void conn_impl_t::on_body(const char* at, const size_t length) {
+        const auto& body_callback = response.request().body_callback();
+
+        if (decoder.empty()) {
+            if (body_callback)
+                body_callback(at, length, error_t{});
             else
                 raw.value().append(at, length);
-            parser->pause();
-        };
+            return;
+        }
 
-        parser->bind_cb(parser_t::BODY, body_fn);
+        try {
+            decoder.decode(at, length, [this, &body_callback](const char* data, const size_t size) {
+                if (body_callback)
+                    body_callback(data, size, error_t{});
+                else
+                    content.append(data, size);
+            });
+        }
+        catch (const std::exception& e) {
+            content_error = e.what();
+            parser.pause();
+        }
+    }
 
-        const auto chunk_header_fn = [this](const size_t length)
-        {
-            content_length = length;
-            parser->pause();
-        };
+    void conn_impl_t::on_chunk_header(const size_t length) {
+        if (length > 0)
+            set_state(error_code_t::READ_CHUNK_DATA);
+    }
+
+    void conn_impl_t::on_chunk_complete() {
+        set_state(error_code_t::READ_CHUNK_HEADER);
+    }
 
-        parser->bind_cb(parser_t::CHUNK_HEADER, chunk_header_fn);
+    /*
+      The parser is paused so that data after the message stays in the
+      response buffer and keeps the stream out of the pool.
+     */
+    void conn_impl_t::on_message_complete() {
+        message_complete = true;
+        if (not decoder.finished() and content_error.empty())
+            content_error = "encoded content is truncated";
+        parser.pause();
     }
 
     /*
@@ -550,6 +758,9 @@ namespace crequests {
     void conn_impl_t::start() {
         prepare_parser();
 
+        if (not is_reused())
+            m_is_reused = acquire_stream();
+
         if (is_reused()) {
             if (stream.is_open())
                 write();
@@ -565,19 +776,30 @@ namespace crequests {
 
     void conn_impl_t::restart() {
         stream.cancel();
-        stream = stream_t(service.get_service(), response.request());
-        if (parser) {
-            delete parser;
-            parser = nullptr;
-        }
-        parser = new parser_t(parser_t::parser_type_t::RESPONSE);
+        stream = stream_t(service.get_service(),
+                          response.request(),
+                          service.get_ssl_contexts());
+        parser.reset();
         m_is_reused = false;
         start();
     }
 
+    void conn_impl_t::resend() {
+        if (not is_resendable(response.request())) {
+            set_error(error_code_t::WRITE_ERROR, "body cannot be sent again");
+            return;
+        }
+
+        restart();
+    }
+
     void conn_impl_t::setup_timeout() {
-        timeout_timer.expires_from_now(
-            seconds_t(response.request().timeout().value()));
+        const auto& request = response.request();
+        const auto timeout = request.total_timeout().empty()
+            ? milliseconds_t(seconds_t(request.timeout().value()))
+            : request.total_timeout().value();
+        deadline = steady_clock_t::now() + timeout;
+        timeout_timer.expires_from_now(timeout);
         const auto self = shared_from_this();
         const auto callback = [this, self](const ec_t& ec) {
             on_timeout(ec);
@@ -587,7 +809,67 @@ namespace crequests {
 
     void conn_impl_t::on_timeout(const ec_t& ec) {
         if (not ec)
-            set_timeout();
+            set_timeout("timeout");
+    }
+
+    void conn_impl_t::setup_phase_timeout(const milliseconds_t& timeout,
+                                          const string_t& msg) {
+        if (timeout.count() <= 0) {
+            phase_timer.cancel();
+            return;
+        }
+
+        phase_timer.expires_from_now(timeout);
+        const auto self = shared_from_this();
+        const auto callback = [this, self, msg](const ec_t& ec) {
+            on_phase_timeout(ec, msg);
+        };
+        phase_timer.async_wait(strand.wrap(callback));
+    }
+
+    void conn_impl_t::on_phase_timeout(const ec_t& ec, const string_t& msg) {
+        if (not ec and not in_final_state())
+            set_timeout(msg);
+    }
+
+    void conn_impl_t::setup_read_timeout() {
+        last_read_time = steady_clock_t::now();
+        const auto& timeout = response.request().read_timeout();
+        if (timeout.empty()) {
+            phase_timer.cancel();
+            return;
+        }
+
+        phase_timer.expires_from_now(timeout.value());
+        const auto self = shared_from_this();
+        const auto callback = [this, self](const ec_t& ec) {
+            on_read_timeout(ec);
+        };
+        phase_timer.async_wait(strand.wrap(callback));
+    }
+
+    /*
+      Reads only stamp last_read_time, so the timer is re-armed once
+      per read_timeout at most instead of for every portion of data.
+     */
+    void conn_impl_t::on_read_timeout(const ec_t& ec) {
+        if (ec or in_final_state())
+            return;
+
+        const auto timeout = response.request().read_timeout().value();
+        const auto idle = std::chrono::duration_cast<milliseconds_t>(
+            steady_clock_t::now() - last_read_time);
+        if (idle >= timeout) {
+            set_timeout("read timeout");
+            return;
+        }
+
+        phase_timer.expires_from_now(timeout - idle);
+        const auto self = shared_from_this();
+        const auto callback = [this, self](const ec_t& ec_) {
+            on_read_timeout(ec_);
+        };
+        phase_timer.async_wait(strand.wrap(callback));
     }
 
     void conn_impl_t::setup_dispose_timer() {
@@ -605,22 +887,31 @@ namespace crequests {
             set_dispose();
     }
 
+    /*
+      The answer is not cancelled with the stream, so an answer for an
+      earlier attempt of a retried request is dropped.
+     */
     void conn_impl_t::resolve() {
-        const resolver_t::query query {
-            response.request().uri().domain().value(),
-            response.request().uri().port().value()
-        };
         const auto self = shared_from_this();
-        const auto callback = [this, self](const ec_t& ec,
-                                           const resolver_t::iterator& endpoint) {
-            on_resolve(ec, endpoint);
+        const auto resolving = attempt;
+        const auto callback = [this, self, resolving](const ec_t& ec,
+                                                      const resolver_t::iterator& endpoint) {
+            if (resolving == attempt)
+                on_resolve(ec, endpoint);
         };
         set_state(error_code_t::RESOLVE);
-        resolver.async_resolve(query, callback);
+        setup_phase_timeout(response.request().connect_timeout().value(),
+                            "connect timeout");
+        service.get_dns().resolve(response.request().uri().domain().value(),
+                                  response.request().uri().port().value(),
+                                  strand.wrap(callback));
     }
 
     void conn_impl_t::on_resolve(const ec_t& ec,
                                  const resolver_t::iterator& endpoint) {
+        if (in_final_state())
+            return;
+
         if (ec) {
             set_error(error_code_t::RESOLVE_ERROR, ec);
             return;
@@ -657,6 +948,11 @@ namespace crequests {
             on_handshake(ec);
         };
         set_state(error_code_t::HANDSHAKE);
+        setup_phase_timeout(stream.is_ssl()
+                            ? response.request().handshake_timeout().value()
+                            : milliseconds_t(0),
+                            "handshake timeout");
+        service.get_ssl_sessions().attach(ssl_session_key(response.request()), stream);
         stream.async_handshake(strand.wrap(callback));
     }
 
@@ -666,26 +962,72 @@ namespace crequests {
             return;
         }
 
+        service.get_ssl_sessions().update(ssl_session_key(response.request()), stream);
+
         write();
     }
 
+    /*
+      The head and the body go out as two buffers of one gathered write,
+      so the body is not copied. A compressed body was made and kept by
+      request_t::prepare(), so it is not compressed again here.
+     */
     void conn_impl_t::write() {
-        std::ostream request_stream(&request_buf);
-        request_stream << response.request().make_request();
-        request_stream.flush();
+        const auto& request = response.request();
+        request_head = request.make_head();
+
+        if (not request.body_source().empty()) {
+            set_state(error_code_t::WRITE);
+            setup_phase_timeout(request.first_byte_timeout().value(),
+                                "first byte timeout");
+            try {
+                if (request.body_source().is_file())
+                    body_file = request.body_source().open_file();
+                else
+                    body_reader = request.body_source().open();
+            }
+            catch (const std::exception& e) {
+                set_error(error_code_t::WRITE_ERROR, e.what());
+                return;
+            }
+            body_left = request.body_source().size();
+
+            if (body_file) {
+                if (not body_left or body_file->size < *body_left) {
+                    body_file = boost::none;
+                    set_error(error_code_t::WRITE_ERROR, "body is shorter than its size");
+                    return;
+                }
+                if (request.is_ssl())
+                    write_mapped_file();
+                else
+                    write_file();
+                return;
+            }
+
+            write_body_part();
+            return;
+        }
+
+        const std::array<boost::asio::const_buffer, 2> buffers {{
+            boost::asio::buffer(request_head),
+            boost::asio::buffer(request.body())
+        }};
 
         const auto self = shared_from_this();
         const auto callback = [this, self](const ec_t& ec, const std::size_t length) {
             on_write(ec, length);
         };
         set_state(error_code_t::WRITE);
-        stream.async_write(request_buf, strand.wrap(callback));
+        setup_phase_timeout(response.request().first_byte_timeout().value(),
+                            "first byte timeout");
+        stream.async_write(buffers, strand.wrap(callback));
     }
 
     void conn_impl_t::on_write(const ec_t& ec, const std::size_t&) {
         if (ec) {
             if (is_socket_closed(ec) and is_reused() and not in_final_state()) {
-                restart();
+                resend();
             }
             else {
                 set_error(error_code_t::WRITE_ERROR, ec);
@@ -693,207 +1035,288 @@ namespace crequests {
             return;
         }
 
-        read_status();
-    }
-
-    void conn_impl_t::read_status() {
-        const auto self = shared_from_this();
-        const auto callback = [this, self](const ec_t& ec, const std::size_t& length) {
-            on_read_status(ec, length);
-        };
         set_state(error_code_t::READ_STATUS);
-        stream.async_read_until(response_buf, "\r\n", strand.wrap(callback));
+        read_response();
     }
 
-    void conn_impl_t::on_read_status(const ec_t& ec, const std::size_t&) {
-        if (ec) {
-            if (is_socket_closed(ec) and is_reused() and not in_final_state()) {
-                restart();
-            }
-            else {
-                set_error(error_code_t::READ_STATUS_ERROR, ec);
-            }
+    /*
+      A body of known size ends with its last byte and is an error when
+      the reader ends earlier. Otherwise every part is a chunk and the
+      body ends with an empty one.
+     */
+    void conn_impl_t::write_body_part() {
+        body_part.resize(BODY_PART_SIZE);
+
+        size_t length = 0;
+        try {
+            const auto limit = body_left ? std::min(*body_left, BODY_PART_SIZE) : BODY_PART_SIZE;
+            if (limit > 0)
+                length = body_reader(body_part.data(), limit);
+        }
+        catch (const std::exception& e) {
+            set_error(error_code_t::WRITE_ERROR, e.what());
             return;
         }
 
-        if (not execute_parser()) {
-            set_error(error_code_t::READ_STATUS_DATA_ERROR, "bad status data");
-            return;
+        bool is_last = length == 0;
+        if (body_left) {
+            if (is_last and *body_left > 0) {
+                set_error(error_code_t::WRITE_ERROR, "body is shorter than its size");
+                return;
+            }
+            *body_left -= length;
+            is_last = *body_left == 0;
+            chunk_head.clear();
+        }
+        else {
+            std::ostringstream out;
+            out << std::hex << length << "\r\n";
+            if (is_last)
+                out << "\r\n";
+            chunk_head = out.str();
         }
 
-        read_headers();
-    }
+        static const string_t crlf = "\r\n";
+        const bool is_chunk = not body_left and length > 0;
+        const std::array<boost::asio::const_buffer, 4> buffers {{
+            boost::asio::buffer(request_head),
+            boost::asio::buffer(chunk_head),
+            boost::asio::buffer(body_part.data(), length),
+            boost::asio::buffer(crlf.data(), is_chunk ? crlf.size() : 0)
+        }};
 
-    void conn_impl_t::read_headers() {
         const auto self = shared_from_this();
-        const auto callback = [this, self](const ec_t& ec, const std::size_t& length) {
-            on_read_headers(ec, length);
+        const auto callback = [this, self, is_last](const ec_t& ec, const std::size_t) {
+            on_write_body_part(ec, is_last);
         };
-        set_state(error_code_t::READ_HEADERS);
-        stream.async_read_until(response_buf, "\r\n\r\n", strand.wrap(callback));
+        stream.async_write(buffers, strand.wrap(callback));
     }
 
-    void conn_impl_t::on_read_headers(const ec_t& ec, const std::size_t&) {
-        if (ec and not is_eof(ec)) {
-            set_error(error_code_t::READ_HEADERS_ERROR, ec);
+    /*
+      Every written part restarts the first byte timeout, so it limits
+      a stalled upload and not a long one.
+     */
+    void conn_impl_t::on_write_body_part(const ec_t& ec, const bool is_last) {
+        if (in_final_state())
             return;
-        }
 
-        if (response_buf.size() == 0)
-            set_error(error_code_t::READ_HEADERS_ERROR, "no headers");
+        request_head.clear();
 
-        if (not execute_parser()) {
-            set_error(error_code_t::READ_HEADERS_ERROR, "bad headers data");
+        if (ec or is_last) {
+            body_reader = nullptr;
+            on_write(ec, 0);
             return;
         }
 
-        read_content();
+        setup_phase_timeout(response.request().first_byte_timeout().value(),
+                            "first byte timeout");
+        write_body_part();
     }
 
-    void conn_impl_t::read_content() {
-        if (response.headers().count("Content-Length"))
-            read_content_length();
-        else if (response.headers().contains("Transfer-Encoding", "chunked"))
-            read_chunk_header();
-        else
-            read_until_eof();
-    }
+    void conn_impl_t::write_file() {
+        body_offset = static_cast<off_t>(body_file->offset);
 
-    void conn_impl_t::read_content_length() {
         const auto self = shared_from_this();
-        const auto callback = [this, self](const ec_t& ec, const std::size_t length) {
-            on_read_content_length(ec, length);
+        const auto callback = [this, self](const ec_t& ec, const std::size_t) {
+            if (in_final_state())
+                return;
+
+            request_head.clear();
+            if (ec) {
+                body_file = boost::none;
+                on_write(ec, 0);
+                return;
+            }
+            send_file_part();
         };
-        set_state(error_code_t::READ_CONTENT_LENGTH);
-        const size_t n = response_buf.size() > content_length
-            ? 0
-            : content_length - response_buf.size();
-        stream.async_read(response_buf,
-                          boost::asio::transfer_at_least(n),
-                          strand.wrap(callback));
-    }
-
-    void conn_impl_t::on_read_content_length(const ec_t& ec, const std::size_t) {
-        if ((ec and not is_eof(ec)) or
-            (ec and is_eof(ec) and response_buf.size() < content_length))
-        {
-            set_error(error_code_t::READ_CONTENT_LENGTH_ERROR, ec);
-        }
-        else {
-            raw.value().reserve(content_length);
-            if (not execute_parser()) {
-                set_error(error_code_t::READ_CONTENT_LENGTH_ERROR, "bad content length");
+        stream.async_write(boost::asio::buffer(request_head), strand.wrap(callback));
+    }
+
+    /*
+      A part which was sent restarts the first byte timeout, like a
+      part of a streamed body.
+     */
+    void conn_impl_t::send_file_part() {
+        if (*body_left > 0) {
+            ec_t ec;
+            const auto length = stream.sendfile_some(*body_file->fd, body_offset,
+                                                     std::min(*body_left, FILE_PART_SIZE), ec);
+            if (ec == boost::asio::error::would_block or
+                ec == boost::asio::error::try_again or
+                (not ec and length > 0))
+            {
+                if (length > 0) {
+                    *body_left -= length;
+                    setup_phase_timeout(response.request().first_byte_timeout().value(),
+                                        "first byte timeout");
+                }
+
+                const auto self = shared_from_this();
+                const auto callback = [this, self](const ec_t& ec_, const std::size_t) {
+                    if (in_final_state())
+                        return;
+
+                    if (ec_) {
+                        body_file = boost::none;
+                        on_write(ec_, 0);
+                        return;
+                    }
+                    send_file_part();
+                };
+                stream.async_wait_writable(strand.wrap(callback));
                 return;
             }
-            set_success();
+
+            body_file = boost::none;
+            if (ec)
+                on_write(ec, 0);
+            else
+                set_error(error_code_t::WRITE_ERROR, "body is shorter than its size");
+            return;
         }
+
+        body_file = boost::none;
+        on_write(ec_t(), 0);
     }
 
-    void conn_impl_t::read_chunk_header() {
-        set_state(error_code_t::READ_CHUNK_HEADER);
+    /*
+      The mapping starts at the page of the offset. The descriptor is
+      not needed after mmap(2), the mapping is kept until the body is
+      written.
+     */
+    void conn_impl_t::write_mapped_file() {
+        if (*body_left > 0) {
+            const auto page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+            const auto start = body_file->offset - body_file->offset % page_size;
+            const auto length = body_file->offset - start + *body_left;
+
+            void* address = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE,
+                                   *body_file->fd, static_cast<off_t>(start));
+            if (address == MAP_FAILED) {
+                body_file = boost::none;
+                set_error(error_code_t::WRITE_ERROR,
+                          ec_t(errno, boost::system::system_category()));
+                return;
+            }
+            ::madvise(address, length, MADV_SEQUENTIAL);
 
-        const auto crlf = peek_crlf(response_buf);
-        if (crlf) {
-            on_read_chunk_header(ec_t(), 0);
-            return;
+            body_mapping = shared_ptr_t<void>(address, [length](void* address_) {
+                ::munmap(address_, length);
+            });
+            body_data = static_cast<const char*>(address) + (body_file->offset - start);
         }
 
+        body_file = boost::none;
+        write_mapped_part();
+    }
+
+    void conn_impl_t::write_mapped_part() {
+        const auto length = std::min(*body_left, FILE_PART_SIZE);
+        const std::array<boost::asio::const_buffer, 2> buffers {{
+            boost::asio::buffer(request_head),
+            boost::asio::buffer(body_data, length)
+        }};
+
         const auto self = shared_from_this();
-        const auto callback = [this, self](const ec_t& ec, const std::size_t length) {
-            on_read_chunk_header(ec, length);
+        const auto callback = [this, self, length](const ec_t& ec, const std::size_t) {
+            on_write_mapped_part(ec, length);
         };
-
-        stream.async_read_until(response_buf, "\r\n", strand.wrap(callback));
+        stream.async_write(buffers, strand.wrap(callback));
     }
 
-    void conn_impl_t::on_read_chunk_header(const ec_t& ec, const std::size_t) {
-        if (ec) {
-            if (not is_eof(ec))
-                set_error(error_code_t::READ_CHUNK_HEADER_ERROR, ec);
-            else
-                set_success();
+    void conn_impl_t::on_write_mapped_part(const ec_t& ec, const size_t length) {
+        if (in_final_state())
             return;
-        }
 
-        if (not execute_parser()) {
-            set_error(error_code_t::READ_CHUNK_HEADER_ERROR,"bad chunk header");
+        request_head.clear();
+        body_data += length;
+        *body_left -= length;
+
+        if (ec or *body_left == 0) {
+            body_mapping.reset();
+            body_data = nullptr;
+            on_write(ec, 0);
             return;
         }
 
-        if (content_length > 0) {
-            if (response_buf.size() > content_length) {
-                set_state(error_code_t::READ_CHUNK_DATA);
-                on_read_chunk_data(ec_t(), content_length);
-            }
-            else {
-                read_chunk_data();
-            }
-        }
-        else {
-            set_success();
-        }
+        setup_phase_timeout(response.request().first_byte_timeout().value(),
+                            "first byte timeout");
+        write_mapped_part();
     }
 
-    void conn_impl_t::read_chunk_data() {
-        set_state(error_code_t::READ_CHUNK_DATA);
-
+    void conn_impl_t::read_response() {
         const auto self = shared_from_this();
-        const auto callback = [this, self](const ec_t& ec,
-                                           const std::size_t length) {
-            on_read_chunk_data(ec, length);
+        const auto callback = [this, self](const ec_t& ec, const std::size_t length) {
+            on_read_response(ec, length);
         };
-
-        stream.async_read(response_buf,
-                          boost::asio::transfer_at_least(content_length - response_buf.size()),
-                          strand.wrap(callback));
+        stream.async_read_some(response_buf.prepare(READ_BUFFER_SIZE),
+                               strand.wrap(callback));
     }
 
-    void conn_impl_t::on_read_chunk_data(const ec_t& ec, const std::size_t) {
+    void conn_impl_t::on_read_response(const ec_t& ec, const std::size_t length) {
+        if (in_final_state())
+            return;
+
+        response_buf.commit(length);
+        last_read_time = steady_clock_t::now();
+
         if (ec and not is_eof(ec)) {
-            set_error(error_code_t::READ_CHUNK_DATA_ERROR, ec);
+            if (is_socket_closed(ec) and is_reused() and
+                state == error_code_t::READ_STATUS and response_buf.size() == 0) {
+                resend();
+            }
+            else {
+                set_error(read_error_of(state), ec);
+            }
             return;
         }
-        else if (ec and is_eof(ec) and response_buf.size() < content_length) {
-            set_error(error_code_t::READ_CHUNK_DATA_ERROR, ec);
+
+        const bool first_data = state == error_code_t::READ_STATUS;
+        const bool parsed = execute_parser();
+        if (not content_error.empty()) {
+            set_error(read_error_of(state), content_error);
             return;
         }
 
-        raw.value().reserve(response.raw().value().size() + content_length);
-        if (not execute_parser()) {
-            set_error(error_code_t::READ_CHUNK_DATA_ERROR, "chunk data error");
+        if (not parsed) {
+            set_error(state == error_code_t::READ_STATUS
+                      ? error_code_t::READ_STATUS_DATA_ERROR
+                      : read_error_of(state),
+                      parser.error_message());
             return;
         }
 
-        read_chunk_header();
-    }
-
-    void conn_impl_t::read_until_eof() {
-        const auto self = shared_from_this();
-        const auto callback = [this, self](const ec_t& ec, const std::size_t length) {
-            on_read_until_eof(ec, length);
-        };
-        set_state(error_code_t::READ_UNTIL_EOF);
-        stream.async_read(response_buf,
-                          boost::asio::transfer_at_least(1),
-                          strand.wrap(callback));
-    }
-
-    void conn_impl_t::on_read_until_eof(const ec_t& ec, const std::size_t) {
         if (ec) {
-            if (not is_eof(ec)) {
-                set_error(error_code_t::READ_UNTIL_EOF_ERROR, ec);
+            if (is_reused() and state == error_code_t::READ_STATUS and
+                response_buf.size() == 0) {
+                resend();
+                return;
             }
-            else {
-                if (not execute_parser()) {
-                    set_error(error_code_t::READ_UNTIL_EOF_ERROR, "until eof error");
-                    return;
-                }
-                set_success();
+
+            /*
+              End of the stream completes a response read until EOF,
+              and is tolerated between chunks.
+             */
+            const auto data = boost::asio::buffer_cast<const char*>(response_buf.data());
+            parser.execute(data, 0);
+            if (not message_complete and state != error_code_t::READ_CHUNK_HEADER) {
+                set_error(read_error_of(state), ec);
+                return;
+            }
+            if (not content_error.empty()) {
+                set_error(read_error_of(state), content_error);
+                return;
             }
         }
-        else {
-            read_until_eof();
+
+        if (message_complete or ec) {
+            set_success();
+            return;
         }
+
+        if (first_data and state != error_code_t::READ_STATUS)
+            setup_read_timeout();
+        read_response();
     }
 
 
@@ -910,32 +1333,93 @@ namespace crequests {
         return m_is_reused;
     }
 
+    bool conn_impl_t::acquire_stream() {
+        const auto pooled = service.get_pool().acquire(pool_key(response.request()));
+        if (not pooled)
+            return false;
+
+        stream = std::move(*pooled);
+        return true;
+    }
+
+    bool conn_impl_t::release_stream() {
+        if (response.error() or
+            not response.request().keep_alive() or
+            not message_complete or
+            response_buf.size() > 0 or
+            response.header_contains("Connection", "close") or
+            not stream.is_open())
+            return false;
+
+        if (response.http_major().value() == 1 and
+            response.http_minor().value() == 0 and
+            not response.header_contains("Connection", "keep-alive"))
+            return false;
+
+        return service.get_pool().release(
+            pool_key(response.request()),
+            std::make_shared<stream_t>(std::move(stream)));
+    }
+
     void conn_impl_t::end() {
-        resolver.cancel();
         timeout_timer.cancel();
-        if (response.request().final_callback())
-            response.request().final_callback()(response);
-        setup_dispose_timer();
-
-        if (response.request().keep_alive()) {
-            if (response.headers().contains("Connection", "close")) {
+        phase_timer.cancel();
+        retry_timer.cancel();
+        body_reader = nullptr;
+        body_file = boost::none;
+        body_mapping.reset();
+        body_data = nullptr;
+        if (not handler)
+            setup_dispose_timer();
+
+        if (not response.error() and stream.is_open())
+            service.get_ssl_sessions().store(ssl_session_key(response.request()), stream);
+
+        if (not release_stream()) {
+            if (response.request().keep_alive()) {
+                if (response.header_contains("Connection", "close")) {
+                    stream.cancel();
+                    stream.close();
+                }
+            }
+            else {
                 stream.cancel();
-                stream.close();
             }
         }
-        else {
-            stream.cancel();
-        }
 
         response.raw(std::move(raw));
+        if (not decoder.empty())
+            response.content(content_t{std::move(content)});
+
+        const auto& policy = response.request().retry_policy();
+        if (policy.enabled() and not response.error() and
+            not policy.is_retryable(response.status_code().value()))
+            service.get_retry_budget().deposit(pool_key(response.request()));
+
+        service.get_http_cache().complete(response, stale);
+
+        if (response.request().final_callback())
+            response.request().final_callback()(response);
+
+        if (not flight.empty())
+            service.get_single_flight().finish(flight, response);
 
         if (response.request().body_callback())
             response.request().body_callback()(nullptr, 0, response.error());
 
+        /*
+          Nobody keeps a connection with a handler, so it is not
+          disposed but freed with its last pending operation.
+         */
+        if (handler) {
+            handler(std::move(response));
+            return;
+        }
+
         if (response.error() and response.request().throw_on_error())
-            promise.set_exception(std::make_exception_ptr(response.error()));
+            promise->set_exception(std::make_exception_ptr(response.error()));
         else
-            promise.set_value(response);
+            promise->set_value(response);
     }
 
     void conn_impl_t::perform_redirect() {
@@ -944,11 +1428,18 @@ namespace crequests {
             return;
         }
 
-        if (not response.headers().count("Location")) {
+        if (not response.has_header("Location")) {
             set_error(error_code_t::REDIRECT_ERROR, "no Location.");
             return;
         }
 
+        if (not is_resendable(response.request())) {
+            set_error(error_code_t::WRITE_ERROR, "body cannot be sent again");
+            return;
+        }
+
+        release_stream();
+
         auto redirects = std::move(response.redirects());
 
         if (redirects.get().empty()) {
@@ -959,7 +1450,7 @@ namespace crequests {
         auto request = std::move(response.request());
 
         redirect_count.value()++;
-        request.uri(uri_t::from_string(response.headers().at("Location")));
+        request.uri(uri_t::from_string(response.header("Location")));
         request.prepare();
 
         response = response_t{std::move(request)};
@@ -970,30 +1461,120 @@ namespace crequests {
         redirects.add(response);
         response.redirects(std::move(redirects));
 
-        stream = stream_t(service.get_service(), response.request());
-
-        if (request_buf.size() > 0) {
-            request_buf.consume(request_buf.size());
-        }
+        stream = stream_t(service.get_service(),
+                          response.request(),
+                          service.get_ssl_contexts());
 
         if (response_buf.size() > 0) {
             response_buf.consume(response_buf.size());
         }
 
-        if (parser) {
-            delete parser;
-            parser = nullptr;
+        parser.reset();
+        prepare_parser();
+
+        m_is_reused = acquire_stream();
+        if (is_reused())
+            write();
+        else
+            resolve();
+    }
+
+    /*
+      The stream of the failed attempt goes back to the pool when its
+      response was read completely, as for a redirect. The retry timer
+      keeps the connection alive while it waits, and the total timeout
+      of the request still runs.
+     */
+    bool conn_impl_t::retry(const error_code_t& error) {
+        const auto& request = response.request();
+        const auto& policy = request.retry_policy();
+        if (attempt >= policy.max_attempts)
+            return false;
+
+        const bool is_retryable = error == error_code_t::SUCCESS
+            ? policy.is_retryable(response.status_code().value())
+            : policy.is_retryable(error);
+        if (not is_retryable)
+            return false;
+
+        if (is_sent(state)) {
+            if (not policy.retry_non_idempotent and
+                not policy.is_idempotent(request.method().value()))
+                return false;
+            if (not is_resendable(request))
+                return false;
+        }
+
+        auto delay = policy.backoff(attempt);
+        if (error == error_code_t::SUCCESS and policy.retry_after) {
+            const auto asked = retry_after_of(response);
+            if (asked) {
+                if (*asked > policy.max_delay)
+                    return false;
+                delay = std::max(delay, *asked);
+            }
         }
-        parser = new parser_t(parser_t::parser_type_t::RESPONSE);
+
+        if (steady_clock_t::now() + delay >= deadline)
+            return false;
+
+        if (not service.get_retry_budget().withdraw(pool_key(request)))
+            return false;
+
+        ++attempt;
+        phase_timer.cancel();
+        body_reader = nullptr;
+        body_file = boost::none;
+        body_mapping.reset();
+        body_data = nullptr;
+        if (not release_stream())
+            stream.cancel();
+        stream = stream_t(service.get_service(),
+                          request,
+                          service.get_ssl_contexts());
+        set_state(error_code_t::INIT);
+
+        retry_timer.expires_from_now(delay);
+        const auto self = shared_from_this();
+        const auto callback = [this, self](const ec_t& ec) {
+            on_retry_timer(ec);
+        };
+        retry_timer.async_wait(strand.wrap(callback));
+        return true;
+    }
+
+    void conn_impl_t::on_retry_timer(const ec_t& ec) {
+        if (ec or in_final_state())
+            return;
+
+        auto redirects = std::move(response.redirects());
+        auto redirect_count = std::move(response.redirect_count());
+        auto request = std::move(response.request());
+
+        response = response_t{std::move(request)};
+        response.redirect_count(std::move(redirect_count));
+        response.redirects(std::move(redirects));
+
+        if (response_buf.size() > 0)
+            response_buf.consume(response_buf.size());
+
+        parser.reset();
         prepare_parser();
 
-        resolve();
+        m_is_reused = acquire_stream();
+        if (is_reused())
+            write();
+        else
+            resolve();
     }
 
     void conn_impl_t::set_error(const error_code_t& new_state, const string_t& msg) {
         if (in_final_state())
             return;
 
+        if (retry(new_state))
+            return;
+
         set_state(new_state);
         response.error(error_t(new_state, msg));
         end();
@@ -1014,6 +1595,9 @@ namespace crequests {
         }
         else {
             if (not in_final_state()) {
+                if (retry(error_code_t::SUCCESS))
+                    return;
+
                 set_state(error_code_t::SUCCESS);
                 response.error(error_t(state, "success"));
                 end();
@@ -1021,15 +1605,29 @@ namespace crequests {
         }
     }
 
-    void conn_impl_t::set_timeout() {
+    void conn_impl_t::set_timeout(const string_t& msg) {
         if (in_final_state()) {
             if (not response.request().keep_alive())
                 stream.close();
             return;
         }
 
+        if (retry(error_code_t::TIMEOUT))
+            return;
+
         set_state(error_code_t::TIMEOUT);
-        response.error(error_t(state, "timeout"));
+        response.error(error_t(state, msg));
+        stream.cancel();
+        end();
+    }
+
+    void conn_impl_t::cancel(const string_t& msg) {
+        if (in_final_state())
+            return;
+
+        set_state(error_code_t::CANCELED);
+        response.error(error_t(state, msg));
+        stream.cancel();
         end();
     }
 
@@ -1059,6 +1657,7 @@ namespace crequests {
         case error_code_t::REDIRECT_ERROR:
         case error_code_t::TIMEOUT:
         case error_code_t::EXPIRED:
+        case error_code_t::CANCELED:
         case error_code_t::SUCCESS:
             return true;
 
@@ -1104,6 +1703,12 @@ namespace crequests {
 
     }
 
+    connection_t::connection_t(const connection_t& connection)
+        : pimpl {connection.pimpl}
+    {
+
+    }
+
     connection_t::connection_t(connection_t&& connection)
         : pimpl {std::move(connection.pimpl)}
     {
@@ -1138,12 +1743,48 @@ namespace crequests {
     }
 
     void connection_t::start() {
-        pimpl->start();
+        pimpl->promise.emplace();
+        pimpl->future = pimpl->promise->get_future();
+
+        /*
+          The service may run several worker threads, so the connection
+          must be started inside its strand like every other handler.
+         */
+        const auto impl = pimpl;
+        impl->strand.post([impl]() {
+            impl->start();
+        });
+    }
+
+    void connection_t::start(completion_handler_t handler) {
+        if (not handler)
+            throw std::invalid_argument("empty completion handler");
+
+        const auto impl = pimpl;
+        impl->handler = std::move(handler);
+        impl->strand.post([impl]() {
+            impl->start();
+        });
     }
 
     bool connection_t::is_expired() const {
         return pimpl->is_expired();
     }
 
+    void connection_t::cancel(const string_t& msg) {
+        const auto impl = pimpl;
+        impl->strand.post([impl, msg]() {
+            impl->cancel(msg);
+        });
+    }
+
+    void connection_t::revalidate(const response_t& stale) {
+        pimpl->stale = stale;
+    }
+
+    void connection_t::lead(const string_t& flight) {
+        pimpl->flight = flight;
+    }
+
 
 } /* namespace crequests */
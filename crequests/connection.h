@@ -36,6 +36,15 @@ namespace crequests {
         */
         void start();
 
+        /*
+          Starts the connection without a promise: the response is moved
+          into the handler on a service thread when the connection is
+          done, and get() must not be called. The connection is not kept
+          for the dispose timeout. Throws std::invalid_argument for an
+          empty handler.
+        */
+        void start(completion_handler_t handler);
+
         /*
           This function say us that the current connection is expired.
           This means the current connection ends up + waited dispose
@@ -44,6 +53,26 @@ namespace crequests {
         */
         bool is_expired() const;
 
+        /*
+          Stops the connection if it is not done yet: the response is
+          given with a CANCELED error and the message.
+        */
+        void cancel(const string_t& msg);
+
+        /*
+          Makes the connection a revalidation of a stale cached
+          response. A 304 is answered with the refreshed stale
+          response. Must be called before start().
+         */
+        void revalidate(const response_t& stale);
+
+        /*
+          Makes the connection the exchange of a single flight key.
+          Its response is given to the requests which joined it.
+          Must be called before start().
+         */
+        void lead(const string_t& flight);
+
     private:
         friend class conn_impl_t;
         shared_ptr_t<class conn_impl_t> pimpl;
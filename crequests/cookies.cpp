@@ -1,4 +1,5 @@
 #include "cookies.h"
+#include "scan.h"
 #include "utils.h"
 
 #include <sstream>
@@ -195,12 +196,16 @@ namespace crequests {
     }
 
     cookie_t cookie_t::from_string(const string_t& str) {
+        static const delimiters_t TOKEN_END(";");
+
         cookie_t cookie;
+        const char* it = str.data();
+        const char* const end = it + str.size();
 
-        std::istringstream in(str);
-        string_t token;
-        while (std::getline(in, token, ';')) {
-            token = trim(token);
+        while (it < end) {
+            const auto token_end = TOKEN_END.find(it, end);
+            auto token = trim(string_t(it, token_end));
+            it = token_end == end ? end : token_end + 1;
             if (token.empty()) {
                 break;
             }
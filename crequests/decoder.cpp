@@ -0,0 +1,473 @@
+#include "decoder.h"
+#include "utils.h"
+
+#include <array>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#include <zlib.h>
+
+#ifdef CREQUESTS_HAVE_BROTLI
+#include <brotli/decode.h>
+#endif
+
+#ifdef CREQUESTS_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace crequests {
+
+
+    namespace {
+
+        using lock_t = std::lock_guard<std::mutex>;
+
+        constexpr size_t OUTPUT_SIZE = 16384;
+
+        /*
+          Window of 32 KiB, with a gzip or a zlib header detected.
+         */
+        constexpr int GZIP_WINDOW_BITS = 15 + 32;
+
+        /*
+          Window of 32 KiB with a zlib header, or without any header.
+         */
+        constexpr int ZLIB_WINDOW_BITS = 15;
+        constexpr int RAW_WINDOW_BITS = -15;
+
+        /*
+          deflate is zlib framed data by RFC 9110, but some servers send
+          it raw. The first two bytes of a zlib stream name the deflate
+          method and are a multiple of 31.
+         */
+        bool is_zlib_header(const unsigned char first, const unsigned char second) {
+            return (first & 0x0f) == 8 and (first * 256 + second) % 31 == 0;
+        }
+
+
+        /*
+          A body may be several gzip members one after another, zlib is
+          reset after each of them. A deflate decoder waits for two
+          bytes to tell a zlib header from raw data.
+         */
+        class inflate_decoder_t : public decoder_t {
+        public:
+            explicit inflate_decoder_t(const bool is_deflate_)
+                : is_deflate(is_deflate_),
+                  is_initialized(false),
+                  in_stream(false),
+                  head(),
+                  stream(),
+                  output_buffer()
+            {
+
+            }
+
+            inflate_decoder_t(const inflate_decoder_t&) = delete;
+            inflate_decoder_t& operator=(const inflate_decoder_t&) = delete;
+
+            ~inflate_decoder_t() {
+                if (is_initialized)
+                    inflateEnd(&stream);
+            }
+
+            void decode(const char* at, const size_t length,
+                        const decoder_output_t& output) override
+            {
+                if (is_initialized) {
+                    inflate_some(at, length, output);
+                    return;
+                }
+
+                if (not is_deflate) {
+                    initialize(GZIP_WINDOW_BITS);
+                    inflate_some(at, length, output);
+                    return;
+                }
+
+                const auto taken = std::min(length, 2 - head.size());
+                head.append(at, taken);
+                if (head.size() < 2)
+                    return;
+
+                const auto first = static_cast<unsigned char>(head[0]);
+                const auto second = static_cast<unsigned char>(head[1]);
+                initialize(is_zlib_header(first, second) ? ZLIB_WINDOW_BITS : RAW_WINDOW_BITS);
+                inflate_some(head.data(), head.size(), output);
+                inflate_some(at + taken, length - taken, output);
+            }
+
+            bool finished() const override {
+                return not in_stream and head.size() != 1;
+            }
+
+        private:
+            void initialize(const int window_bits) {
+                if (inflateInit2(&stream, window_bits) != Z_OK)
+                    throw std::runtime_error("inflateInit2 failed");
+                is_initialized = true;
+            }
+
+            void inflate_some(const char* at, const size_t length,
+                              const decoder_output_t& output)
+            {
+                stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(at));
+                stream.avail_in = static_cast<uInt>(length);
+
+                while (stream.avail_in > 0) {
+                    in_stream = true;
+                    const auto available = stream.avail_in;
+                    stream.next_out = reinterpret_cast<Bytef*>(output_buffer.data());
+                    stream.avail_out = static_cast<uInt>(output_buffer.size());
+
+                    const auto result = inflate(&stream, Z_NO_FLUSH);
+                    if (result != Z_OK and result != Z_STREAM_END and result != Z_BUF_ERROR)
+                        throw std::runtime_error(string_t("inflate: ") +
+                                                 (stream.msg ? stream.msg : "invalid data"));
+
+                    const auto produced = output_buffer.size() - stream.avail_out;
+                    if (produced > 0)
+                        output(output_buffer.data(), produced);
+                    else if (stream.avail_in == available and result != Z_STREAM_END)
+                        throw std::runtime_error("inflate: no progress");
+
+                    if (result == Z_STREAM_END) {
+                        in_stream = false;
+                        inflateReset(&stream);
+                    }
+                }
+            }
+
+        private:
+            const bool is_deflate;
+            bool is_initialized;
+            bool in_stream;
+            string_t head;
+            z_stream stream;
+            std::array<char, OUTPUT_SIZE> output_buffer;
+        };
+
+
+#ifdef CREQUESTS_HAVE_BROTLI
+
+        /*
+          A brotli stream has one end, data after it is an error.
+         */
+        class brotli_decoder_t : public decoder_t {
+        public:
+            brotli_decoder_t()
+                : state(BrotliDecoderCreateInstance(nullptr, nullptr, nullptr)),
+                  in_stream(false),
+                  output_buffer()
+            {
+                if (not state)
+                    throw std::runtime_error("BrotliDecoderCreateInstance failed");
+            }
+
+            brotli_decoder_t(const brotli_decoder_t&) = delete;
+            brotli_decoder_t& operator=(const brotli_decoder_t&) = delete;
+
+            ~brotli_decoder_t() {
+                BrotliDecoderDestroyInstance(state);
+            }
+
+            void decode(const char* at, const size_t length,
+                        const decoder_output_t& output) override
+            {
+                auto next_in = reinterpret_cast<const uint8_t*>(at);
+                auto available_in = length;
+
+                while (available_in > 0 or BrotliDecoderHasMoreOutput(state)) {
+                    if (not in_stream and BrotliDecoderIsFinished(state))
+                        throw std::runtime_error("brotli: data after the end of the stream");
+
+                    in_stream = true;
+                    auto next_out = reinterpret_cast<uint8_t*>(output_buffer.data());
+                    auto available_out = output_buffer.size();
+
+                    const auto result = BrotliDecoderDecompressStream(
+                        state, &available_in, &next_in, &available_out, &next_out, nullptr);
+                    if (result == BROTLI_DECODER_RESULT_ERROR)
+                        throw std::runtime_error(
+                            string_t("brotli: ") +
+                            BrotliDecoderErrorString(BrotliDecoderGetErrorCode(state)));
+
+                    const auto produced = output_buffer.size() - available_out;
+                    if (produced > 0)
+                        output(output_buffer.data(), produced);
+
+                    if (result == BROTLI_DECODER_RESULT_SUCCESS)
+                        in_stream = false;
+                    else if (result == BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT)
+                        break;
+                }
+            }
+
+            bool finished() const override {
+                return not in_stream;
+            }
+
+        private:
+            BrotliDecoderState* state;
+            bool in_stream;
+            std::array<char, OUTPUT_SIZE> output_buffer;
+        };
+
+#endif /* CREQUESTS_HAVE_BROTLI */
+
+
+#ifdef CREQUESTS_HAVE_ZSTD
+
+        /*
+          zstd goes on to the next frame by itself, a body may be
+          several of them.
+         */
+        class zstd_decoder_t : public decoder_t {
+        public:
+            zstd_decoder_t()
+                : stream(ZSTD_createDStream()),
+                  in_frame(false),
+                  output_buffer()
+            {
+                if (not stream)
+                    throw std::runtime_error("ZSTD_createDStream failed");
+            }
+
+            zstd_decoder_t(const zstd_decoder_t&) = delete;
+            zstd_decoder_t& operator=(const zstd_decoder_t&) = delete;
+
+            ~zstd_decoder_t() {
+                ZSTD_freeDStream(stream);
+            }
+
+            void decode(const char* at, const size_t length,
+                        const decoder_output_t& output) override
+            {
+                ZSTD_inBuffer input {at, length, 0};
+
+                while (true) {
+                    ZSTD_outBuffer out {output_buffer.data(), output_buffer.size(), 0};
+                    const auto result = ZSTD_decompressStream(stream, &out, &input);
+                    if (ZSTD_isError(result))
+                        throw std::runtime_error(string_t("zstd: ") + ZSTD_getErrorName(result));
+
+                    if (out.pos > 0)
+                        output(output_buffer.data(), out.pos);
+
+                    if (input.pos > 0 or out.pos > 0)
+                        in_frame = result != 0;
+
+                    if (input.pos == input.size and out.pos < out.size)
+                        break;
+                }
+            }
+
+            bool finished() const override {
+                return not in_frame;
+            }
+
+        private:
+            ZSTD_DStream* stream;
+            bool in_frame;
+            std::array<char, OUTPUT_SIZE> output_buffer;
+        };
+
+#endif /* CREQUESTS_HAVE_ZSTD */
+
+
+        /*
+          The registered decoders. Built on the first use, so it is
+          ready for DEFAULT_HEADERS whatever the order of static
+          initialization is.
+         */
+        class registry_t {
+        public:
+            registry_t()
+                : mutex(),
+                  factories()
+            {
+                add("gzip", []() { return std::make_shared<inflate_decoder_t>(false); });
+                add("deflate", []() { return std::make_shared<inflate_decoder_t>(true); });
+#ifdef CREQUESTS_HAVE_BROTLI
+                add("br", []() { return std::make_shared<brotli_decoder_t>(); });
+#endif
+#ifdef CREQUESTS_HAVE_ZSTD
+                add("zstd", []() { return std::make_shared<zstd_decoder_t>(); });
+#endif
+            }
+
+            void add(const string_t& coding, const decoder_factory_t& factory) {
+                const lock_t lock(mutex);
+                for (auto&& entry : factories) {
+                    if (entry.first == coding) {
+                        entry.second = factory;
+                        return;
+                    }
+                }
+                factories.emplace_back(coding, factory);
+            }
+
+            decoder_factory_t find(const string_t& coding) const {
+                const lock_t lock(mutex);
+                for (auto&& entry : factories)
+                    if (entry.first == coding)
+                        return entry.second;
+                return nullptr;
+            }
+
+            string_t codings() const {
+                const lock_t lock(mutex);
+                string_t result;
+                for (auto&& entry : factories)
+                    result += (result.empty() ? "" : ", ") + entry.first;
+                return result;
+            }
+
+        private:
+            mutable std::mutex mutex;
+            vector_t<std::pair<string_t, decoder_factory_t> > factories;
+        };
+
+        /*
+          zlib framed data with window_bits 15, gzip with 15 + 16.
+         */
+        string_t deflate(const string_t& data, const int level, const int window_bits) {
+            z_stream stream {};
+            if (deflateInit2(&stream, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+                throw std::runtime_error("deflateInit2 failed");
+
+            string_t result(deflateBound(&stream, data.size()), '\0');
+            stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+            stream.avail_in = static_cast<uInt>(data.size());
+            stream.next_out = reinterpret_cast<Bytef*>(&result[0]);
+            stream.avail_out = static_cast<uInt>(result.size());
+
+            const auto status = ::deflate(&stream, Z_FINISH);
+            result.resize(stream.total_out);
+            deflateEnd(&stream);
+            if (status != Z_STREAM_END)
+                throw std::runtime_error("deflate failed");
+
+            return result;
+        }
+
+        registry_t& registry() {
+            static registry_t instance;
+            return instance;
+        }
+
+        void decode_through(const vector_t<shared_ptr_t<decoder_t> >& decoders,
+                            const size_t count,
+                            const char* at,
+                            const size_t length,
+                            const decoder_output_t& output)
+        {
+            if (count == 1) {
+                decoders.front()->decode(at, length, output);
+                return;
+            }
+
+            decoders[count - 1]->decode(at, length, [&](const char* data, const size_t size) {
+                decode_through(decoders, count - 1, data, size, output);
+            });
+        }
+
+    } /* anonymous namespace */
+
+
+    decoder_t::~decoder_t() {
+
+    }
+
+    void register_content_decoder(const string_t& coding, const decoder_factory_t& factory) {
+        registry().add(tolower(trim(coding)), factory);
+    }
+
+    string_t accept_encoding() {
+        return registry().codings();
+    }
+
+
+    bool can_encode_content(const string_t& coding) {
+#ifdef CREQUESTS_HAVE_ZSTD
+        if (coding == "zstd")
+            return true;
+#endif
+        return coding == "gzip" or coding == "deflate";
+    }
+
+    string_t encode_content(const string_t& coding, const string_t& data, const int level) {
+        if (coding == "gzip")
+            return deflate(data, level, 15 + 16);
+        if (coding == "deflate")
+            return deflate(data, level, 15);
+#ifdef CREQUESTS_HAVE_ZSTD
+        if (coding == "zstd") {
+            string_t result(ZSTD_compressBound(data.size()), '\0');
+            const auto size = ZSTD_compress(&result[0], result.size(), data.data(), data.size(), level);
+            if (ZSTD_isError(size))
+                throw std::runtime_error(string_t("zstd: ") + ZSTD_getErrorName(size));
+            result.resize(size);
+            return result;
+        }
+#endif
+        throw std::runtime_error("no encoder for " + coding);
+    }
+
+
+    /************************************************************
+     * content_decoder_t section.
+     ************************************************************/
+
+
+    content_decoder_t::content_decoder_t()
+        : decoders()
+    {
+
+    }
+
+    content_decoder_t content_decoder_t::from_encoding(const string_t& content_encoding) {
+        content_decoder_t decoder;
+
+        for (const auto& part : split(content_encoding, ',')) {
+            auto coding = tolower(trim(part));
+            if (coding.empty() or coding == "identity")
+                continue;
+            if (coding == "x-gzip")
+                coding = "gzip";
+
+            const auto factory = registry().find(coding);
+            if (not factory)
+                return content_decoder_t();
+            decoder.decoders.push_back(factory());
+        }
+
+        return decoder;
+    }
+
+    bool content_decoder_t::empty() const {
+        return decoders.empty();
+    }
+
+    void content_decoder_t::decode(const char* at, const size_t length,
+                                   const decoder_output_t& output)
+    {
+        if (decoders.empty()) {
+            if (length > 0)
+                output(at, length);
+            return;
+        }
+
+        decode_through(decoders, decoders.size(), at, length, output);
+    }
+
+    bool content_decoder_t::finished() const {
+        for (auto&& decoder : decoders)
+            if (not decoder->finished())
+                return false;
+        return true;
+    }
+
+
+} /* namespace crequests */
@@ -0,0 +1,105 @@
+#ifndef DECODER_H
+#define DECODER_H
+
+#include "types.h"
+
+#include <functional>
+
+namespace crequests {
+
+    /*
+      Receives a part of a decoded body.
+     */
+    using decoder_output_t = std::function<void(const char* at, const size_t length)>;
+
+    /*
+      Decoder of one content coding. It is fed the encoded body part by
+      part and passes what each part yields to output.
+     */
+    class decoder_t {
+    public:
+        virtual ~decoder_t();
+
+        /*
+          Throws std::runtime_error when the data is not valid for the coding.
+         */
+        virtual void decode(const char* at, const size_t length,
+                            const decoder_output_t& output) = 0;
+
+        /*
+          True when the encoded body ended or nothing has been decoded
+          yet. False means the body was cut short.
+         */
+        virtual bool finished() const = 0;
+    };
+
+    using decoder_factory_t = std::function<shared_ptr_t<decoder_t>()>;
+
+    /*
+      Adds a decoder of a content coding, or replaces the one of the
+      same name. gzip and deflate are always there, br and zstd when
+      the library was built with brotli and zstd.
+     */
+    void register_content_decoder(const string_t& coding, const decoder_factory_t& factory);
+
+    /*
+      The codings of the registered decoders, comma separated, in the
+      order they were registered. The Accept-Encoding of DEFAULT_HEADERS
+      is made from it when the program starts, so a decoder registered
+      later has to be asked for with an explicit Accept-Encoding header.
+     */
+    string_t accept_encoding();
+
+    /*
+      True for the codings a request body can be compressed with:
+      gzip, deflate, and zstd when the library is built with it.
+     */
+    bool can_encode_content(const string_t& coding);
+
+    /*
+      data compressed with the coding at the level, which is a zlib
+      level (0 to 9) for gzip and deflate and a zstd level for zstd.
+      Throws std::runtime_error for another coding or when the
+      compression fails.
+     */
+    string_t encode_content(const string_t& coding, const string_t& data, const int level);
+
+    /*
+      Decodes a body of a Content-Encoding part by part, as it is
+      received, so the decoded body is never made from a whole encoded
+      one. A list of codings is undone from the last to the first.
+      A body with a coding without a decoder is left as it is, the
+      decoder is empty then.
+     */
+    class content_decoder_t {
+    public:
+        content_decoder_t();
+
+        /*
+          A decoder of the value of a Content-Encoding header.
+         */
+        static content_decoder_t from_encoding(const string_t& content_encoding);
+
+    public:
+        bool empty() const;
+
+        /*
+          Decodes the next part of the body and passes what it yields
+          to output, in parts of up to 16 KiB. Throws std::runtime_error
+          when the data is not valid for the coding.
+         */
+        void decode(const char* at, const size_t length, const decoder_output_t& output);
+
+        /*
+          True when the encoded body ended or nothing has been decoded
+          yet. False means the body was cut short.
+         */
+        bool finished() const;
+
+    private:
+        vector_t<shared_ptr_t<decoder_t> > decoders;
+    };
+
+} /* namespace crequests */
+
+#endif /* DECODER_H */
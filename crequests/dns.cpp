@@ -0,0 +1,394 @@
+#include "boost_asio.h"
+#include "dns.h"
+#include "dns_resolver.h"
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace crequests {
+
+
+    namespace {
+
+        using lock_t = std::lock_guard<std::mutex>;
+        using steady_clock_t = std::chrono::steady_clock;
+
+        string_t dns_key(const string_t& domain, const string_t& port) {
+            return domain + ":" + port;
+        }
+
+    } /* anonymous namespace */
+
+
+    void dns_overrides_t::add(const string_t& domain,
+                              const string_t& port,
+                              const string_t& address)
+    {
+        (*this)[dns_key(domain, port)] = address;
+    }
+
+    void dns_nameservers_t::add(const string_t& nameserver) {
+        this->push_back(nameserver);
+    }
+
+
+    /************************************************************
+     * dns_cache_impl_t section.
+     ************************************************************/
+
+
+    class dns_cache_impl_t : public std::enable_shared_from_this<dns_cache_impl_t> {
+    public:
+        using callback_t = dns_cache_t::callback_t;
+
+    public:
+        dns_cache_impl_t(ioservice_t& ioservice);
+        dns_cache_impl_t(const dns_cache_impl_t& impl) = delete;
+        dns_cache_impl_t& operator=(const dns_cache_impl_t& impl) = delete;
+
+    public:
+        void set_option(const dns_ttl_t& ttl);
+        void set_option(const dns_negative_ttl_t& negative_ttl);
+        void set_option(const dns_cache_size_t& max_size);
+        void set_option(const dns_overrides_t& overrides);
+        void set_option(const dns_builtin_t& builtin);
+        void set_option(const dns_resolv_conf_t& resolv_conf);
+        void set_option(const dns_hosts_file_t& hosts_file);
+        void set_option(const dns_nameservers_t& nameservers);
+
+        void resolve(const string_t& domain,
+                     const string_t& port,
+                     const callback_t& callback);
+
+        void clear();
+        size_t size() const;
+        size_t hits() const;
+        size_t misses() const;
+
+    private:
+        struct entry_t {
+            string_t key;
+            ec_t ec;
+            resolver_iterator_t endpoint;
+            steady_clock_t::time_point expires;
+        };
+
+        using lru_t = std::list<entry_t>;
+
+        /*
+          Finds a live answer in the cache and makes it the most recently
+          used one. An expired answer is dropped.
+         */
+        bool lookup(const string_t& key, ec_t& ec, resolver_iterator_t& endpoint);
+
+        /*
+          Asks the system or the builtin resolver. All callbacks
+          waiting for the key are called when the answer comes.
+         */
+        void start_resolve(const string_t& key,
+                           const string_t& domain,
+                           const string_t& port);
+
+        void on_resolve(const string_t& key,
+                        const ec_t& ec,
+                        const resolver_iterator_t& endpoint);
+
+        /*
+          Puts the answer to the front of the LRU list and drops
+          the least recently used entries beyond the size limit.
+         */
+        void store(const string_t& key,
+                   const ec_t& ec,
+                   const resolver_iterator_t& endpoint);
+
+    private:
+        ioservice_t& ioservice;
+        dns_resolver_t builtin_resolver;
+        mutable std::mutex mutex {};
+        lru_t lru {};
+        std::unordered_map<string_t, lru_t::iterator> entries {};
+        std::unordered_map<string_t, vector_t<callback_t> > pending {};
+        std::unordered_map<string_t, resolver_iterator_t> overrides {};
+        dns_ttl_t ttl {60};
+        dns_negative_ttl_t negative_ttl {5};
+        dns_cache_size_t max_size {1000};
+        dns_builtin_t builtin {false};
+        std::atomic<size_t> hits_count {0};
+        std::atomic<size_t> misses_count {0};
+    };
+
+    dns_cache_impl_t::dns_cache_impl_t(ioservice_t& ioservice_)
+        : ioservice(ioservice_),
+          builtin_resolver(ioservice_)
+    {
+
+    }
+
+    void dns_cache_impl_t::set_option(const dns_ttl_t& ttl_) {
+        const lock_t lock(mutex);
+        ttl = ttl_;
+    }
+
+    void dns_cache_impl_t::set_option(const dns_negative_ttl_t& negative_ttl_) {
+        const lock_t lock(mutex);
+        negative_ttl = negative_ttl_;
+    }
+
+    void dns_cache_impl_t::set_option(const dns_cache_size_t& max_size_) {
+        const lock_t lock(mutex);
+        max_size = max_size_;
+    }
+
+    void dns_cache_impl_t::set_option(const dns_overrides_t& overrides_) {
+        const lock_t lock(mutex);
+        for (const auto& item : overrides_) {
+            const auto& key = item.first;
+            const auto ind = key.rfind(':');
+            if (ind == string_t::npos)
+                throw std::runtime_error("dns override must be host:port: " + key);
+
+            const auto port = key.substr(ind + 1);
+            const boost::asio::ip::tcp::endpoint endpoint {
+                boost::asio::ip::address::from_string(item.second),
+                static_cast<unsigned short>(std::stoul(port))
+            };
+
+            overrides[key] = make_resolver_iterator(&endpoint, &endpoint + 1,
+                                                    key.substr(0, ind), port);
+        }
+    }
+
+    void dns_cache_impl_t::set_option(const dns_builtin_t& builtin_) {
+        const lock_t lock(mutex);
+        builtin = builtin_;
+    }
+
+    void dns_cache_impl_t::set_option(const dns_resolv_conf_t& resolv_conf) {
+        builtin_resolver.set_option(resolv_conf);
+    }
+
+    void dns_cache_impl_t::set_option(const dns_hosts_file_t& hosts_file) {
+        builtin_resolver.set_option(hosts_file);
+    }
+
+    void dns_cache_impl_t::set_option(const dns_nameservers_t& nameservers) {
+        builtin_resolver.set_option(nameservers);
+    }
+
+    void dns_cache_impl_t::resolve(const string_t& domain,
+                                   const string_t& port,
+                                   const callback_t& callback)
+    {
+        const auto key = dns_key(domain, port);
+        ec_t ec {};
+        resolver_iterator_t endpoint {};
+
+        {
+            const lock_t lock(mutex);
+
+            const auto override_it = overrides.find(key);
+            if (override_it != overrides.end())
+                endpoint = override_it->second;
+            else if (lookup(key, ec, endpoint))
+                ++hits_count;
+            else {
+                auto& waiters = pending[key];
+                waiters.push_back(callback);
+                if (waiters.size() > 1) {
+                    ++hits_count;
+                    return;
+                }
+
+                ++misses_count;
+                start_resolve(key, domain, port);
+                return;
+            }
+        }
+
+        callback(ec, endpoint);
+    }
+
+    bool dns_cache_impl_t::lookup(const string_t& key,
+                                  ec_t& ec,
+                                  resolver_iterator_t& endpoint)
+    {
+        const auto it = entries.find(key);
+        if (it == entries.end())
+            return false;
+
+        if (it->second->expires <= steady_clock_t::now()) {
+            lru.erase(it->second);
+            entries.erase(it);
+            return false;
+        }
+
+        lru.splice(lru.begin(), lru, it->second);
+        ec = it->second->ec;
+        endpoint = it->second->endpoint;
+        return true;
+    }
+
+    void dns_cache_impl_t::start_resolve(const string_t& key,
+                                         const string_t& domain,
+                                         const string_t& port)
+    {
+        const auto self = shared_from_this();
+
+        if (builtin) {
+            const auto callback = [self, key](const ec_t& ec,
+                                              const resolver_iterator_t& endpoint) {
+                self->on_resolve(key, ec, endpoint);
+            };
+            builtin_resolver.resolve(domain, port, callback);
+            return;
+        }
+
+        const auto resolver = std::make_shared<resolver_t>(ioservice);
+        const auto callback = [self, key, resolver](const ec_t& ec,
+                                                    const resolver_iterator_t& endpoint) {
+            self->on_resolve(key, ec, endpoint);
+        };
+        resolver->async_resolve(resolver_t::query{domain, port}, callback);
+    }
+
+    void dns_cache_impl_t::on_resolve(const string_t& key,
+                                      const ec_t& ec,
+                                      const resolver_iterator_t& endpoint)
+    {
+        vector_t<callback_t> waiters;
+
+        {
+            const lock_t lock(mutex);
+            const auto it = pending.find(key);
+            if (it != pending.end()) {
+                waiters = std::move(it->second);
+                pending.erase(it);
+            }
+
+            if (ec != boost::asio::error::operation_aborted)
+                store(key, ec, endpoint);
+        }
+
+        for (const auto& waiter : waiters)
+            waiter(ec, endpoint);
+    }
+
+    void dns_cache_impl_t::store(const string_t& key,
+                                 const ec_t& ec,
+                                 const resolver_iterator_t& endpoint)
+    {
+        const auto lifetime = ec ? negative_ttl.value() : ttl.value();
+        if (lifetime == 0 or max_size.value() == 0)
+            return;
+
+        const auto it = entries.find(key);
+        if (it != entries.end()) {
+            lru.erase(it->second);
+            entries.erase(it);
+        }
+
+        lru.push_front(entry_t{
+            key, ec, endpoint, steady_clock_t::now() + seconds_t{lifetime}});
+        entries[key] = lru.begin();
+
+        while (lru.size() > max_size.value()) {
+            entries.erase(lru.back().key);
+            lru.pop_back();
+        }
+    }
+
+    void dns_cache_impl_t::clear() {
+        const lock_t lock(mutex);
+        entries.clear();
+        lru.clear();
+    }
+
+    size_t dns_cache_impl_t::size() const {
+        const lock_t lock(mutex);
+        return lru.size();
+    }
+
+    size_t dns_cache_impl_t::hits() const {
+        return hits_count;
+    }
+
+    size_t dns_cache_impl_t::misses() const {
+        return misses_count;
+    }
+
+
+    /************************************************************
+     * dns_cache_t section.
+     ************************************************************/
+
+
+    dns_cache_t::dns_cache_t(ioservice_t& ioservice)
+        : pimpl(std::make_shared<dns_cache_impl_t>(ioservice))
+    {
+
+    }
+
+    dns_cache_t::~dns_cache_t()
+    {
+
+    }
+
+    void dns_cache_t::set_option(const dns_ttl_t& ttl) {
+        pimpl->set_option(ttl);
+    }
+
+    void dns_cache_t::set_option(const dns_negative_ttl_t& negative_ttl) {
+        pimpl->set_option(negative_ttl);
+    }
+
+    void dns_cache_t::set_option(const dns_cache_size_t& max_size) {
+        pimpl->set_option(max_size);
+    }
+
+    void dns_cache_t::set_option(const dns_overrides_t& overrides) {
+        pimpl->set_option(overrides);
+    }
+
+    void dns_cache_t::set_option(const dns_builtin_t& builtin) {
+        pimpl->set_option(builtin);
+    }
+
+    void dns_cache_t::set_option(const dns_resolv_conf_t& resolv_conf) {
+        pimpl->set_option(resolv_conf);
+    }
+
+    void dns_cache_t::set_option(const dns_hosts_file_t& hosts_file) {
+        pimpl->set_option(hosts_file);
+    }
+
+    void dns_cache_t::set_option(const dns_nameservers_t& nameservers) {
+        pimpl->set_option(nameservers);
+    }
+
+    void dns_cache_t::resolve(const string_t& domain,
+                              const string_t& port,
+                              const callback_t& callback)
+    {
+        pimpl->resolve(domain, port, callback);
+    }
+
+    void dns_cache_t::clear() {
+        pimpl->clear();
+    }
+
+    size_t dns_cache_t::size() const {
+        return pimpl->size();
+    }
+
+    size_t dns_cache_t::hits() const {
+        return pimpl->hits();
+    }
+
+    size_t dns_cache_t::misses() const {
+        return pimpl->misses();
+    }
+
+
+} /* namespace crequests */
@@ -0,0 +1,93 @@
+#ifndef DNS_H
+#define DNS_H
+
+#include "boost_asio_fwd.h"
+#include "macros.h"
+#include "types.h"
+
+#include <functional>
+#include <map>
+
+namespace crequests {
+
+    declare_number(dns_ttl, size_t)
+    declare_number(dns_negative_ttl, size_t)
+    declare_number(dns_cache_size, size_t)
+    declare_bool(dns_builtin)
+    declare_string(dns_resolv_conf)
+    declare_string(dns_hosts_file)
+
+    /*
+      Static resolving of host:port pairs to ip addresses, like the
+      --resolve option of curl. Overridden hosts are never looked up.
+     */
+    class dns_overrides_t : public std::map<string_t, string_t> {
+        using std::map<string_t, string_t>::map;
+
+    public:
+        void add(const string_t& domain,
+                 const string_t& port,
+                 const string_t& address);
+    };
+
+    /*
+      Name servers of the builtin resolver given as "address" or
+      "address:port" ("[address]:port" for IPv6). They replace the
+      name servers found in resolv.conf.
+     */
+    class dns_nameservers_t : public vector_t<string_t> {
+        using vector_t<string_t>::vector;
+
+    public:
+        void add(const string_t& nameserver);
+    };
+
+    /*
+      Service wide cache of resolved endpoints. Successful lookups are
+      kept for dns_ttl seconds, failed ones for dns_negative_ttl seconds,
+      and the least recently used host is dropped when the cache is full.
+      Concurrent lookups of the same host are merged into one request to
+      the system resolver, or to the builtin one if dns_builtin is set.
+     */
+    class dns_cache_t {
+    public:
+        using callback_t = std::function<void(const ec_t& ec,
+                                              const resolver_iterator_t& endpoint)>;
+
+    public:
+        dns_cache_t(ioservice_t& ioservice);
+        dns_cache_t(const dns_cache_t& cache) = delete;
+        dns_cache_t& operator=(const dns_cache_t& cache) = delete;
+        ~dns_cache_t();
+
+    public:
+        void set_option(const dns_ttl_t& ttl);
+        void set_option(const dns_negative_ttl_t& negative_ttl);
+        void set_option(const dns_cache_size_t& max_size);
+        void set_option(const dns_overrides_t& overrides);
+        void set_option(const dns_builtin_t& builtin);
+        void set_option(const dns_resolv_conf_t& resolv_conf);
+        void set_option(const dns_hosts_file_t& hosts_file);
+        void set_option(const dns_nameservers_t& nameservers);
+
+        /*
+          Calls the callback with the endpoints of the host. The callback
+          is called in place when the answer is already known and from a
+          service thread otherwise.
+         */
+        void resolve(const string_t& domain,
+                     const string_t& port,
+                     const callback_t& callback);
+
+        void clear();
+        size_t size() const;
+        size_t hits() const;
+        size_t misses() const;
+
+    private:
+        shared_ptr_t<class dns_cache_impl_t> pimpl;
+    };
+
+} /* namespace crequests */
+
+#endif /* DNS_H */
@@ -0,0 +1,746 @@
+#include "dns_resolver.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace crequests {
+
+
+    namespace {
+
+        using lock_t = std::lock_guard<std::mutex>;
+        using udp_t = boost::asio::ip::udp;
+        using tcp_t = boost::asio::ip::tcp;
+        using address_t = dns_resolver_t::address_t;
+        using config_t = dns_resolver_t::config_t;
+        using callback_t = dns_resolver_t::callback_t;
+        using bytes_t = vector_t<unsigned char>;
+
+        constexpr unsigned short DNS_PORT = 53;
+        constexpr unsigned short TYPE_A = 1;
+        constexpr unsigned short TYPE_AAAA = 28;
+        constexpr unsigned short CLASS_IN = 1;
+        constexpr unsigned short FLAG_QR = 0x8000;
+        constexpr unsigned short FLAG_TC = 0x0200;
+        constexpr unsigned short FLAG_RD = 0x0100;
+        constexpr unsigned short RCODE_MASK = 0x000F;
+        constexpr unsigned short RCODE_NOERROR = 0;
+        constexpr unsigned short RCODE_NXDOMAIN = 3;
+        constexpr size_t HEADER_SIZE = 12;
+        constexpr size_t MAX_LABEL_SIZE = 63;
+        constexpr size_t MAX_MESSAGE_SIZE = 65535;
+        constexpr size_t UDP_BUFFER_SIZE = 4096;
+
+        size_t to_number(const string_t& str) {
+            return std::strtoul(str.c_str(), nullptr, 10);
+        }
+
+        string_t strip_comment(const string_t& line) {
+            return line.substr(0, line.find_first_of("#;"));
+        }
+
+        /*
+          Parses "address", "address:port" and "[address]:port".
+          Returns false if the address is not valid.
+         */
+        bool parse_nameserver(const string_t& str, udp_t::endpoint& endpoint) {
+            string_t address = str;
+            unsigned short port = DNS_PORT;
+
+            if (not str.empty() and str[0] == '[') {
+                const auto close = str.find(']');
+                if (close == string_t::npos)
+                    return false;
+                address = str.substr(1, close - 1);
+                if (close + 1 < str.size() and str[close + 1] == ':')
+                    port = static_cast<unsigned short>(to_number(str.substr(close + 2)));
+            }
+            else if (std::count(str.begin(), str.end(), ':') == 1) {
+                const auto ind = str.find(':');
+                address = str.substr(0, ind);
+                port = static_cast<unsigned short>(to_number(str.substr(ind + 1)));
+            }
+
+            ec_t ec;
+            const auto addr = address_t::from_string(address, ec);
+            if (ec or port == 0)
+                return false;
+
+            endpoint = udp_t::endpoint{addr, port};
+            return true;
+        }
+
+        void read_resolv_conf(const string_t& path, config_t& config) {
+            std::ifstream in(path);
+            string_t line;
+
+            while (std::getline(in, line)) {
+                std::istringstream words(strip_comment(line));
+                string_t keyword;
+                words >> keyword;
+
+                if (keyword == "nameserver") {
+                    string_t address;
+                    words >> address;
+                    udp_t::endpoint endpoint;
+                    if (parse_nameserver(address, endpoint))
+                        config.nameservers.push_back(endpoint);
+                }
+                else if (keyword == "options") {
+                    string_t option;
+                    while (words >> option) {
+                        if (option.compare(0, 8, "timeout:") == 0)
+                            config.timeout = to_number(option.substr(8));
+                        else if (option.compare(0, 9, "attempts:") == 0)
+                            config.attempts = to_number(option.substr(9));
+                    }
+                }
+            }
+        }
+
+        void read_hosts(const string_t& path, config_t& config) {
+            std::ifstream in(path);
+            string_t line;
+
+            while (std::getline(in, line)) {
+                std::istringstream words(line.substr(0, line.find('#')));
+                string_t address;
+                if (not (words >> address))
+                    continue;
+
+                ec_t ec;
+                const auto addr = address_t::from_string(address, ec);
+                if (ec)
+                    continue;
+
+                string_t name;
+                while (words >> name)
+                    config.hosts[tolower(name)].push_back(addr);
+            }
+        }
+
+        void put16(bytes_t& data, const size_t value) {
+            data.push_back(static_cast<unsigned char>((value >> 8) & 0xFF));
+            data.push_back(static_cast<unsigned char>(value & 0xFF));
+        }
+
+        unsigned short get16(const bytes_t& data, const size_t pos) {
+            return static_cast<unsigned short>((data[pos] << 8) | data[pos + 1]);
+        }
+
+        /*
+          Returns an empty message if the domain can not be encoded.
+         */
+        bytes_t encode_query(const unsigned short id,
+                             const string_t& domain,
+                             const unsigned short type)
+        {
+            bytes_t data;
+            put16(data, id);
+            put16(data, FLAG_RD);
+            put16(data, 1);
+            put16(data, 0);
+            put16(data, 0);
+            put16(data, 0);
+
+            for (const auto& label : split(domain, '.')) {
+                if (label.empty())
+                    continue;
+                if (label.size() > MAX_LABEL_SIZE)
+                    return bytes_t{};
+                data.push_back(static_cast<unsigned char>(label.size()));
+                data.insert(data.end(), label.begin(), label.end());
+            }
+
+            data.push_back(0);
+            put16(data, type);
+            put16(data, CLASS_IN);
+
+            return data;
+        }
+
+        bool skip_name(const bytes_t& data, const size_t size, size_t& pos) {
+            while (pos < size) {
+                const auto length = data[pos];
+                if ((length & 0xC0) == 0xC0) {
+                    pos += 2;
+                    return pos <= size;
+                }
+                if (length == 0) {
+                    pos += 1;
+                    return true;
+                }
+                pos += length + 1;
+            }
+            return false;
+        }
+
+        struct answer_t {
+            unsigned short id {0};
+            bool truncated {false};
+            unsigned short rcode {0};
+            bytes_t question {};
+            vector_t<address_t> addresses {};
+        };
+
+        /*
+          Takes A and AAAA records of the answer section whatever their
+          owner is, so CNAME chains resolved by the server just work.
+          The single question is kept to be matched against the query.
+         */
+        bool parse_answer(const bytes_t& data, const size_t size, answer_t& answer) {
+            if (size < HEADER_SIZE or size > data.size())
+                return false;
+
+            const auto flags = get16(data, 2);
+            if (not (flags & FLAG_QR))
+                return false;
+
+            answer.id = get16(data, 0);
+            answer.truncated = flags & FLAG_TC;
+            answer.rcode = flags & RCODE_MASK;
+
+            const auto questions = get16(data, 4);
+            const auto answers = get16(data, 6);
+            size_t pos = HEADER_SIZE;
+
+            if (questions != 1 or not skip_name(data, size, pos) or pos + 4 > size)
+                return false;
+            pos += 4;
+            answer.question.assign(data.begin() + HEADER_SIZE, data.begin() + pos);
+
+            for (size_t i = 0; i < answers; ++i) {
+                if (not skip_name(data, size, pos) or pos + 10 > size)
+                    return false;
+
+                const auto type = get16(data, pos);
+                const auto klass = get16(data, pos + 2);
+                const size_t length = get16(data, pos + 8);
+                pos += 10;
+
+                if (pos + length > size)
+                    return false;
+
+                if (klass == CLASS_IN and type == TYPE_A and length == 4) {
+                    boost::asio::ip::address_v4::bytes_type bytes;
+                    std::copy(data.begin() + pos, data.begin() + pos + 4, bytes.begin());
+                    answer.addresses.push_back(boost::asio::ip::address_v4{bytes});
+                }
+                else if (klass == CLASS_IN and type == TYPE_AAAA and length == 16) {
+                    boost::asio::ip::address_v6::bytes_type bytes;
+                    std::copy(data.begin() + pos, data.begin() + pos + 16, bytes.begin());
+                    answer.addresses.push_back(boost::asio::ip::address_v6{bytes});
+                }
+
+                pos += length;
+            }
+
+            return true;
+        }
+
+        /*
+          Whether the answer is for the name, type and class of the
+          query. Names are compared case insensitively.
+         */
+        bool same_question(const bytes_t& query, const bytes_t& question) {
+            if (query.size() != HEADER_SIZE + question.size())
+                return false;
+
+            return std::equal(question.begin(), question.end(), query.begin() + HEADER_SIZE,
+                              [](const unsigned char a, const unsigned char b) {
+                                  return std::tolower(a) == std::tolower(b);
+                              });
+        }
+
+        resolver_iterator_t make_answer(const vector_t<address_t>& addresses,
+                                        const string_t& domain,
+                                        const string_t& port)
+        {
+            const auto port_number = static_cast<unsigned short>(to_number(port));
+            vector_t<tcp_t::endpoint> endpoints;
+            for (const auto& address : addresses)
+                endpoints.emplace_back(address, port_number);
+
+            return make_resolver_iterator(endpoints.begin(), endpoints.end(), domain, port);
+        }
+
+
+        /************************************************************
+         * dns_lookup_t section.
+         ************************************************************/
+
+
+        /*
+          One lookup of a domain. The A and AAAA queries go out together
+          and the lookup ends when both are answered or when all
+          attempts are used up.
+         */
+        class dns_lookup_t : public std::enable_shared_from_this<dns_lookup_t> {
+        public:
+            dns_lookup_t(ioservice_t& ioservice,
+                         const shared_ptr_t<const config_t>& config,
+                         const string_t& domain,
+                         const string_t& port,
+                         const callback_t& callback);
+            dns_lookup_t(const dns_lookup_t& lookup) = delete;
+            dns_lookup_t& operator=(const dns_lookup_t& lookup) = delete;
+
+        public:
+            void start();
+
+        private:
+            struct query_t {
+                unsigned short type;
+                unsigned short id;
+                bytes_t data;
+                bool done;
+                bool nxdomain;
+                bool tcp;
+            };
+
+            struct tcp_exchange_t {
+                tcp_exchange_t(ioservice_t& ioservice) : socket(ioservice) {}
+                tcp_t::socket socket;
+                bytes_t request {};
+                bytes_t length = bytes_t(2);
+                bytes_t response {};
+                unsigned short id {0};
+            };
+
+            using tcp_exchange_ptr_t = shared_ptr_t<tcp_exchange_t>;
+
+            void send_attempt();
+            void receive();
+            void on_receive(const size_t generation, const ec_t& ec, const size_t size);
+            void on_timeout(const size_t generation, const ec_t& ec);
+            bool on_answer(const answer_t& answer);
+            query_t* find_query(const unsigned short id);
+
+            void tcp_connect(query_t& query);
+            void tcp_write(const tcp_exchange_ptr_t& exchange);
+            void tcp_read_length(const tcp_exchange_ptr_t& exchange);
+            void tcp_read_data(const tcp_exchange_ptr_t& exchange);
+            void on_tcp_error(const tcp_exchange_ptr_t& exchange);
+
+            void check_done();
+            void finish(const ec_t& ec);
+
+        private:
+            ioservice_t& ioservice;
+            strand_t strand;
+            udp_t::socket socket;
+            timer__t timer;
+            shared_ptr_t<const config_t> config;
+            string_t domain;
+            string_t port;
+            callback_t callback;
+            std::array<query_t, 2> queries;
+            vector_t<tcp_exchange_ptr_t> exchanges {};
+            vector_t<address_t> addresses_v4 {};
+            vector_t<address_t> addresses_v6 {};
+            bytes_t buffer = bytes_t(UDP_BUFFER_SIZE);
+            udp_t::endpoint server {};
+            udp_t::endpoint sender {};
+            size_t attempt {0};
+            size_t generation {0};
+            bool finished {false};
+        };
+
+        dns_lookup_t::dns_lookup_t(ioservice_t& ioservice_,
+                                   const shared_ptr_t<const config_t>& config_,
+                                   const string_t& domain_,
+                                   const string_t& port_,
+                                   const callback_t& callback_)
+            : ioservice(ioservice_),
+              strand(ioservice_),
+              socket(ioservice_),
+              timer(ioservice_),
+              config(config_),
+              domain(domain_),
+              port(port_),
+              callback(callback_),
+              queries{{query_t{TYPE_A, 0, {}, false, false, false},
+                       query_t{TYPE_AAAA, 0, {}, false, false, false}}}
+        {
+            std::random_device device;
+            std::mt19937 random(device());
+            std::uniform_int_distribution<unsigned short> ids;
+
+            queries[0].id = ids(random);
+            queries[1].id = ids(random);
+            if (queries[1].id == queries[0].id)
+                queries[1].id++;
+
+            for (auto& query : queries)
+                query.data = encode_query(query.id, domain, query.type);
+        }
+
+        void dns_lookup_t::start() {
+            const auto self = shared_from_this();
+            strand.post([self]() {
+                if (self->queries[0].data.empty())
+                    self->finish(boost::asio::error::host_not_found);
+                else
+                    self->send_attempt();
+            });
+        }
+
+        /*
+          Name servers are asked in turn, each attempt sends all
+          queries which are not answered yet.
+         */
+        void dns_lookup_t::send_attempt() {
+            const auto& nameservers = config->nameservers;
+            if (attempt >= config->attempts * nameservers.size()) {
+                finish(boost::asio::error::timed_out);
+                return;
+            }
+
+            const auto& nameserver = nameservers[attempt % nameservers.size()];
+            server = nameserver;
+            attempt++;
+            generation++;
+
+            ec_t ec;
+            socket.close(ec);
+            socket.open(nameserver.protocol(), ec);
+            if (ec) {
+                send_attempt();
+                return;
+            }
+
+            const auto self = shared_from_this();
+            for (const auto& query : queries)
+                if (not query.done and not query.tcp)
+                    socket.async_send_to(boost::asio::buffer(query.data),
+                                         nameserver,
+                                         strand.wrap([self](const ec_t&, const size_t) {}));
+
+            receive();
+
+            const auto current = generation;
+            timer.expires_from_now(seconds_t(config->timeout));
+            timer.async_wait(strand.wrap([self, current](const ec_t& ec_) {
+                self->on_timeout(current, ec_);
+            }));
+        }
+
+        void dns_lookup_t::receive() {
+            const auto self = shared_from_this();
+            const auto current = generation;
+            socket.async_receive_from(
+                boost::asio::buffer(buffer),
+                sender,
+                strand.wrap([self, current](const ec_t& ec, const size_t size) {
+                    self->on_receive(current, ec, size);
+                }));
+        }
+
+        void dns_lookup_t::on_receive(const size_t current,
+                                      const ec_t& ec,
+                                      const size_t size)
+        {
+            if (finished or current != generation or ec)
+                return;
+
+            answer_t answer;
+            if (sender == server and parse_answer(buffer, size, answer))
+                on_answer(answer);
+
+            if (not finished)
+                receive();
+        }
+
+        void dns_lookup_t::on_timeout(const size_t current, const ec_t& ec) {
+            if (finished or current != generation or ec)
+                return;
+
+            send_attempt();
+        }
+
+        dns_lookup_t::query_t* dns_lookup_t::find_query(const unsigned short id) {
+            for (auto& query : queries)
+                if (query.id == id and not query.done)
+                    return &query;
+            return nullptr;
+        }
+
+        /*
+          Failures other than NXDOMAIN leave the query unanswered,
+          so it is repeated with the next name server. An answer
+          which only shares the id of a query is not taken for it,
+          the lookup keeps waiting for the real one.
+         */
+        bool dns_lookup_t::on_answer(const answer_t& answer) {
+            const auto query = find_query(answer.id);
+            if (not query or not same_question(query->data, answer.question))
+                return false;
+
+            if (answer.truncated) {
+                if (not query->tcp)
+                    tcp_connect(*query);
+                return true;
+            }
+
+            if (answer.rcode == RCODE_NOERROR) {
+                auto& addresses = query->type == TYPE_A ? addresses_v4 : addresses_v6;
+                addresses.insert(addresses.end(),
+                                 answer.addresses.begin(),
+                                 answer.addresses.end());
+                query->done = true;
+            }
+            else if (answer.rcode == RCODE_NXDOMAIN) {
+                query->done = true;
+                query->nxdomain = true;
+            }
+
+            check_done();
+            return true;
+        }
+
+        void dns_lookup_t::tcp_connect(query_t& query) {
+            query.tcp = true;
+
+            const auto exchange = std::make_shared<tcp_exchange_t>(ioservice);
+            exchange->id = query.id;
+            put16(exchange->request, query.data.size());
+            exchange->request.insert(exchange->request.end(),
+                                     query.data.begin(),
+                                     query.data.end());
+            exchanges.push_back(exchange);
+
+            const tcp_t::endpoint endpoint {server.address(), server.port()};
+
+            const auto self = shared_from_this();
+            exchange->socket.async_connect(
+                endpoint,
+                strand.wrap([self, exchange](const ec_t& ec) {
+                    if (ec)
+                        self->on_tcp_error(exchange);
+                    else
+                        self->tcp_write(exchange);
+                }));
+        }
+
+        void dns_lookup_t::tcp_write(const tcp_exchange_ptr_t& exchange) {
+            const auto self = shared_from_this();
+            boost::asio::async_write(
+                exchange->socket,
+                boost::asio::buffer(exchange->request),
+                strand.wrap([self, exchange](const ec_t& ec, const size_t) {
+                    if (ec)
+                        self->on_tcp_error(exchange);
+                    else
+                        self->tcp_read_length(exchange);
+                }));
+        }
+
+        void dns_lookup_t::tcp_read_length(const tcp_exchange_ptr_t& exchange) {
+            const auto self = shared_from_this();
+            boost::asio::async_read(
+                exchange->socket,
+                boost::asio::buffer(exchange->length),
+                strand.wrap([self, exchange](const ec_t& ec, const size_t) {
+                    if (ec)
+                        self->on_tcp_error(exchange);
+                    else
+                        self->tcp_read_data(exchange);
+                }));
+        }
+
+        void dns_lookup_t::tcp_read_data(const tcp_exchange_ptr_t& exchange) {
+            const size_t length = get16(exchange->length, 0);
+            if (length < HEADER_SIZE or length > MAX_MESSAGE_SIZE) {
+                on_tcp_error(exchange);
+                return;
+            }
+
+            exchange->response.resize(length);
+
+            const auto self = shared_from_this();
+            boost::asio::async_read(
+                exchange->socket,
+                boost::asio::buffer(exchange->response),
+                strand.wrap([self, exchange](const ec_t& ec, const size_t size) {
+                    answer_t answer;
+                    if (ec or
+                        not parse_answer(exchange->response, size, answer) or
+                        answer.id != exchange->id)
+                    {
+                        self->on_tcp_error(exchange);
+                        return;
+                    }
+
+                    ec_t ignored;
+                    exchange->socket.close(ignored);
+                    answer.truncated = false;
+                    if (not self->on_answer(answer))
+                        self->on_tcp_error(exchange);
+                }));
+        }
+
+        /*
+          A query which failed over TCP is taken as answered
+          without addresses, UDP would only truncate it again.
+         */
+        void dns_lookup_t::on_tcp_error(const tcp_exchange_ptr_t& exchange) {
+            ec_t ignored;
+            exchange->socket.close(ignored);
+
+            const auto query = find_query(exchange->id);
+            if (query)
+                query->done = true;
+
+            check_done();
+        }
+
+        void dns_lookup_t::check_done() {
+            for (const auto& query : queries)
+                if (not query.done)
+                    return;
+
+            const bool nxdomain = queries[0].nxdomain and queries[1].nxdomain;
+            finish(nxdomain
+                   ? boost::asio::error::host_not_found
+                   : boost::asio::error::host_not_found_try_again);
+        }
+
+        /*
+          Any address found is a success, even if the other query failed
+          or timed out. The error is reported only when there is none.
+         */
+        void dns_lookup_t::finish(const ec_t& ec) {
+            if (finished)
+                return;
+            finished = true;
+
+            ec_t ignored;
+            timer.cancel(ignored);
+            socket.close(ignored);
+            for (const auto& exchange : exchanges)
+                exchange->socket.close(ignored);
+
+            vector_t<address_t> addresses = addresses_v4;
+            addresses.insert(addresses.end(), addresses_v6.begin(), addresses_v6.end());
+
+            if (addresses.empty())
+                callback(ec, resolver_iterator_t());
+            else
+                callback(ec_t(), make_answer(addresses, domain, port));
+        }
+
+    } /* anonymous namespace */
+
+
+    /************************************************************
+     * dns_resolver_t section.
+     ************************************************************/
+
+
+    dns_resolver_t::dns_resolver_t(ioservice_t& ioservice_)
+        : ioservice(ioservice_)
+    {
+
+    }
+
+    dns_resolver_t::~dns_resolver_t()
+    {
+
+    }
+
+    void dns_resolver_t::set_option(const dns_resolv_conf_t& resolv_conf_) {
+        const lock_t lock(mutex);
+        resolv_conf = resolv_conf_;
+        config.reset();
+    }
+
+    void dns_resolver_t::set_option(const dns_hosts_file_t& hosts_file_) {
+        const lock_t lock(mutex);
+        hosts_file = hosts_file_;
+        config.reset();
+    }
+
+    void dns_resolver_t::set_option(const dns_nameservers_t& nameservers_) {
+        udp_endpoint_t endpoint;
+        for (const auto& nameserver : nameservers_)
+            if (not parse_nameserver(nameserver, endpoint))
+                throw std::runtime_error("bad dns name server: " + nameserver);
+
+        const lock_t lock(mutex);
+        nameservers = nameservers_;
+        config.reset();
+    }
+
+    shared_ptr_t<const dns_resolver_t::config_t> dns_resolver_t::get_config() {
+        const lock_t lock(mutex);
+        if (config)
+            return config;
+
+        const auto new_config = std::make_shared<config_t>();
+        read_resolv_conf(resolv_conf.value(), *new_config);
+        read_hosts(hosts_file.value(), *new_config);
+
+        if (not nameservers.empty()) {
+            new_config->nameservers.clear();
+            for (const auto& nameserver : nameservers) {
+                udp_endpoint_t endpoint;
+                if (parse_nameserver(nameserver, endpoint))
+                    new_config->nameservers.push_back(endpoint);
+            }
+        }
+
+        if (new_config->nameservers.empty())
+            new_config->nameservers.emplace_back(
+                boost::asio::ip::address_v4::loopback(), DNS_PORT);
+
+        new_config->timeout = std::max<size_t>(new_config->timeout, 1);
+        new_config->attempts = std::max<size_t>(new_config->attempts, 1);
+
+        config = new_config;
+        return config;
+    }
+
+    /*
+      The answer is always posted, even when it is known in place,
+      because the caller may hold its own lock while asking.
+     */
+    void dns_resolver_t::resolve(const string_t& domain,
+                                 const string_t& port,
+                                 const callback_t& callback)
+    {
+        const auto current = get_config();
+
+        string_t host = domain;
+        if (host.size() > 2 and host.front() == '[' and host.back() == ']')
+            host = host.substr(1, host.size() - 2);
+
+        ec_t ec;
+        const auto address = address_t::from_string(host, ec);
+        if (not ec) {
+            const auto answer = make_answer({address}, domain, port);
+            ioservice.post([callback, answer]() {
+                callback(ec_t(), answer);
+            });
+            return;
+        }
+
+        const auto it = current->hosts.find(tolower(host));
+        if (it != current->hosts.end()) {
+            const auto answer = make_answer(it->second, domain, port);
+            ioservice.post([callback, answer]() {
+                callback(ec_t(), answer);
+            });
+            return;
+        }
+
+        std::make_shared<dns_lookup_t>(ioservice, current, host, port, callback)->start();
+    }
+
+
+} /* namespace crequests */
@@ -0,0 +1,70 @@
+#ifndef DNS_RESOLVER_H
+#define DNS_RESOLVER_H
+
+#include "boost_asio.h"
+#include "dns.h"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace crequests {
+
+    /*
+      Builtin asynchronous resolver. It takes name servers and options
+      from resolv.conf and static hosts from the hosts file, and sends
+      A and AAAA queries in parallel over UDP on the service io_service.
+      Truncated answers are repeated over TCP. Every attempt waits for
+      the resolv.conf timeout, then the next name server is asked, up to
+      attempts times for each of them. Search domains are not used.
+     */
+    class dns_resolver_t {
+    public:
+        using callback_t = dns_cache_t::callback_t;
+        using udp_endpoint_t = boost::asio::ip::udp::endpoint;
+        using address_t = boost::asio::ip::address;
+
+        struct config_t {
+            vector_t<udp_endpoint_t> nameservers {};
+            size_t timeout {5};
+            size_t attempts {2};
+            std::unordered_map<string_t, vector_t<address_t> > hosts {};
+        };
+
+    public:
+        dns_resolver_t(ioservice_t& ioservice);
+        dns_resolver_t(const dns_resolver_t& resolver) = delete;
+        dns_resolver_t& operator=(const dns_resolver_t& resolver) = delete;
+        ~dns_resolver_t();
+
+    public:
+        void set_option(const dns_resolv_conf_t& resolv_conf);
+        void set_option(const dns_hosts_file_t& hosts_file);
+        void set_option(const dns_nameservers_t& nameservers);
+
+        /*
+          Calls the callback with the addresses of the domain. Ip
+          addresses and hosts from the hosts file are answered in place.
+         */
+        void resolve(const string_t& domain,
+                     const string_t& port,
+                     const callback_t& callback);
+
+    private:
+        /*
+          Reads resolv.conf and the hosts file on the first lookup
+          after the options have been changed.
+         */
+        shared_ptr_t<const config_t> get_config();
+
+    private:
+        ioservice_t& ioservice;
+        std::mutex mutex {};
+        shared_ptr_t<const config_t> config {};
+        dns_resolv_conf_t resolv_conf {"/etc/resolv.conf"};
+        dns_hosts_file_t hosts_file {"/etc/hosts"};
+        dns_nameservers_t nameservers {};
+    };
+
+} /* namespace crequests */
+
+#endif /* DNS_RESOLVER_H */
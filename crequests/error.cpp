@@ -57,6 +57,8 @@ namespace crequests {
             return "TIMEOUT";
         case error_code_t::EXPIRED:
             return "EXPIRED";
+        case error_code_t::CANCELED:
+            return "CANCELED";
         case error_code_t::SUCCESS:
             return "SUCCESS";
         }
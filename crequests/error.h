@@ -32,6 +32,7 @@ namespace crequests {
         REDIRECT_ERROR,
         TIMEOUT,
         EXPIRED,
+        CANCELED,
         SUCCESS
     };
 
@@ -1,84 +1,358 @@
 #include "headers.h"
+#include "scan.h"
 #include "utils.h"
 
-#include <sstream>
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <algorithm>
+#include <cctype>
 #include <ostream>
 
 namespace crequests {
 
 
+    namespace {
+
+        /*
+          FNV-1a of the lower cased name, without a lower cased copy.
+         */
+        std::size_t fold_hash(const string_view_t& name) {
+            std::size_t hash = 14695981039346656037ULL;
+            for (const auto c : name) {
+                hash ^= static_cast<unsigned char>(
+                    std::tolower(static_cast<unsigned char>(c)));
+                hash *= 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        bool same_name(const header_t& header,
+                       const string_t& name,
+                       const header_name_t id,
+                       const std::size_t hash)
+        {
+            if (id != header_name_t::OTHER)
+                return header.id == id;
+            return header.hash == hash and
+                boost::algorithm::iequals(header.first, name);
+        }
+
+    } /* anonymous namespace */
+
+
+    header_name_t header_name_of(const string_view_t& name) {
+        const auto is = [&name](const char* known) {
+            return boost::algorithm::iequals(name, known);
+        };
+
+        switch (name.size()) {
+        case 8:
+            if (is("Location"))
+                return header_name_t::LOCATION;
+            break;
+        case 10:
+            if (is("Connection"))
+                return header_name_t::CONNECTION;
+            if (is("Set-Cookie"))
+                return header_name_t::SET_COOKIE;
+            break;
+        case 14:
+            if (is("Content-Length"))
+                return header_name_t::CONTENT_LENGTH;
+            break;
+        case 16:
+            if (is("Content-Encoding"))
+                return header_name_t::CONTENT_ENCODING;
+            break;
+        case 17:
+            if (is("Transfer-Encoding"))
+                return header_name_t::TRANSFER_ENCODING;
+            break;
+        default:
+            break;
+        }
+        return header_name_t::OTHER;
+    }
+
+    header_t::header_t(string_t name, string_t value)
+        : first(std::move(name)),
+          second(std::move(value)),
+          hash(fold_hash(first)),
+          id(header_name_of(first))
+    {
+
+    }
+
+    headers_t::headers_t(std::initializer_list<std::pair<string_t, string_t> > headers_) {
+        headers.reserve(headers_.size());
+        for (const auto& header : headers_)
+            headers.emplace_back(header.first, header.second);
+    }
+
+    /*
+      Lines up to an empty one, a line without a colon is skipped.
+      One scan finds the colon or the end of a line, the next one the
+      end of the value.
+     */
     headers_t headers_t::from_string(const string_t& str) {
-        std::istringstream stream(str);
+        static const delimiters_t NAME_END(":\n");
+        static const delimiters_t LINE_END("\n");
+
         headers_t headers;
+        const char* it = str.data();
+        const char* const end = it + str.size();
+
+        while (it < end) {
+            if (*it == '\r' and (it + 1 == end or it[1] == '\n'))
+                break;
+
+            const auto name_end = NAME_END.find(it, end);
+            if (name_end == end)
+                break;
+
+            if (*name_end == '\n') {
+                it = name_end + 1;
+                continue;
+            }
 
-        string_t header;
-        while (std::getline(stream, header) && header != "\r") {
-            const auto ind = header.find(":");
-            if (ind != string_t::npos)
-                headers.emplace(
-                    trim(header.substr(0, ind)),
-                    trim(header.substr(ind + 1))
-                );
+            const auto line_end = LINE_END.find(name_end + 1, end);
+            headers.emplace(
+                trim(string_t(it, name_end)),
+                trim(string_t(name_end + 1, line_end))
+            );
+            it = line_end == end ? end : line_end + 1;
         }
 
         return headers;
     }
 
     string_t headers_t::to_string() const {
-        /*
-          For success tests we must have strict headers order.
-         */
-        std::vector<std::pair<std::string, std::string> > pairs;
-        for (const auto& header : *this) {
-            pairs.emplace_back(header.first, header.second);
-        }
-
-        std::sort(std::begin(pairs), std::end(pairs));
-        
-        std::ostringstream out;
-
-        for (const auto& header : pairs) {
-            out << header.first << ": " << header.second << "\r\n";
-        }
-        out << "\r\n";
-            
-        return out.str();
+        string_t out;
+        out.reserve(string_size());
+        append_to(out);
+        return out;
     }
-    
-    void headers_t::update(const headers_t& headers) {
+
+    void headers_t::append_to(string_t& out) const {
         for (const auto& header : headers) {
-            this->emplace(header.first, header.second);
+            out.append(header.first);
+            out.append(": ");
+            out.append(header.second);
+            out.append("\r\n");
         }
+        out.append("\r\n");
+    }
+
+    size_t headers_t::string_size() const {
+        size_t size = 2;
+        for (const auto& header : headers)
+            size += header.first.size() + header.second.size() + 4;
+        return size;
+    }
+
+    void headers_t::update(const headers_t& headers_) {
+        headers.insert(headers.end(), headers_.begin(), headers_.end());
     }
 
     bool headers_t::contains(const string_t& name, const string_t& value) const {
-        const auto its = this->equal_range(name);
-        for (auto it = its.first; it != its.second; ++it) {
-            if (it->second == value) {
+        const auto id = header_name_of(name);
+        const auto hash = id == header_name_t::OTHER ? fold_hash(name) : 0;
+        for (const auto& header : headers) {
+            if (same_name(header, name, id, hash) and header.second == value)
                 return true;
-            }
         }
         return false;
     }
 
-    void headers_t::insert(const string_t& name, const string_t& value) {
-        if (tolower(name) != "set-cookie" and this->count(name)) {
-            const auto its = this->equal_range(name);
-            const auto it = its.first;
-            it->second = value;
+    void headers_t::insert(string_t name, string_t value) {
+        const auto it = find(name);
+        if (it != headers.end() and it->id != header_name_t::SET_COOKIE)
+            it->second = std::move(value);
+        else
+            headers.emplace_back(std::move(name), std::move(value));
+    }
+
+    string_t headers_t::at(const string_t& name) const {
+        const auto it = find(name);
+        return it != end() ? it->second : "";
+    }
+
+    void headers_t::emplace(string_t name, string_t value) {
+        headers.emplace_back(std::move(name), std::move(value));
+    }
+
+    headers_t::const_iterator headers_t::find(const string_t& name) const {
+        const auto id = header_name_of(name);
+        const auto hash = id == header_name_t::OTHER ? fold_hash(name) : 0;
+        return std::find_if(headers.begin(), headers.end(), [&](const header_t& header) {
+            return same_name(header, name, id, hash);
+        });
+    }
+
+    headers_t::container_t::iterator headers_t::find(const string_t& name) {
+        const auto it = static_cast<const headers_t&>(*this).find(name);
+        return headers.begin() + (it - headers.cbegin());
+    }
+
+    size_t headers_t::count(const string_t& name) const {
+        const auto id = header_name_of(name);
+        const auto hash = id == header_name_t::OTHER ? fold_hash(name) : 0;
+        return static_cast<size_t>(
+            std::count_if(headers.begin(), headers.end(), [&](const header_t& header) {
+                return same_name(header, name, id, hash);
+            }));
+    }
+
+    size_t headers_t::erase(const string_t& name) {
+        const auto id = header_name_of(name);
+        const auto hash = id == header_name_t::OTHER ? fold_hash(name) : 0;
+        const auto it = std::remove_if(headers.begin(), headers.end(), [&](const header_t& header) {
+            return same_name(header, name, id, hash);
+        });
+        const auto count = static_cast<size_t>(headers.end() - it);
+        headers.erase(it, headers.end());
+        return count;
+    }
+
+    headers_t::const_iterator headers_t::begin() const {
+        return headers.begin();
+    }
+
+    headers_t::const_iterator headers_t::end() const {
+        return headers.end();
+    }
+
+    bool headers_t::empty() const {
+        return headers.empty();
+    }
+
+    size_t headers_t::size() const {
+        return headers.size();
+    }
+
+    void headers_t::clear() {
+        headers.clear();
+    }
+
+    /*
+      The same headers in another order are equal. Names are
+      compared case insensitive, values exactly.
+     */
+    bool headers_t::operator==(const headers_t& headers_) const {
+        return headers.size() == headers_.headers.size() and
+            std::is_permutation(headers.begin(), headers.end(), headers_.headers.begin(),
+                                [](const header_t& header1, const header_t& header2) {
+                                    return header1.hash == header2.hash and
+                                        header1.second == header2.second and
+                                        boost::algorithm::iequals(header1.first,
+                                                                  header2.first);
+                                });
+    }
+
+    bool headers_t::operator!=(const headers_t& headers_) const {
+        return not (*this == headers_);
+    }
+
+    void header_block_t::append_name(const char* at, const size_t length) {
+        if (entries.empty() or is_value) {
+            if (buffer.empty())
+                buffer.reserve(1024);
+            entries.push_back(entry_t{buffer.size(), 0, 0, 0, 0, header_name_t::OTHER});
+            is_value = false;
         }
-        else {
-            this->emplace(name, value);
+
+        buffer.append(at, length);
+        entries.back().name_size += length;
+    }
+
+    void header_block_t::append_value(const char* at, const size_t length) {
+        if (entries.empty())
+            return;
+
+        auto& entry = entries.back();
+        if (not is_value) {
+            const string_view_t name(buffer.data() + entry.name, entry.name_size);
+            entry.value = buffer.size();
+            entry.hash = fold_hash(name);
+            entry.id = header_name_of(name);
+            is_value = true;
         }
+
+        buffer.append(at, length);
+        entry.value_size += length;
     }
 
-    string_t headers_t::at(const string_t& name) const {
-        if (not this->count(name)) {
-            return "";
+    void header_block_t::clear() {
+        buffer.clear();
+        entries.clear();
+        is_value = false;
+    }
+
+    size_t header_block_t::size() const {
+        return entries.size();
+    }
+
+    bool header_block_t::empty() const {
+        return entries.empty();
+    }
+
+    header_block_t::view_t header_block_t::operator[](const size_t index) const {
+        const auto& entry = entries[index];
+        return view_t(string_view_t(buffer.data() + entry.name, entry.name_size),
+                      string_view_t(buffer.data() + entry.value, entry.value_size));
+    }
+
+    bool header_block_t::same_name(const entry_t& entry,
+                                   const string_t& name,
+                                   const header_name_t id,
+                                   const std::size_t hash) const
+    {
+        if (id != header_name_t::OTHER)
+            return entry.id == id;
+        return entry.hash == hash and
+            boost::algorithm::iequals(
+                string_view_t(buffer.data() + entry.name, entry.name_size), name);
+    }
+
+    string_view_t header_block_t::at(const string_t& name) const {
+        const auto id = header_name_of(name);
+        const auto hash = id == header_name_t::OTHER ? fold_hash(name) : 0;
+        for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+            if (same_name(*it, name, id, hash))
+                return string_view_t(buffer.data() + it->value, it->value_size);
+        }
+        return string_view_t();
+    }
+
+    size_t header_block_t::count(const string_t& name) const {
+        const auto id = header_name_of(name);
+        const auto hash = id == header_name_t::OTHER ? fold_hash(name) : 0;
+        size_t result = 0;
+        for (const auto& entry : entries) {
+            if (same_name(entry, name, id, hash))
+                result++;
+        }
+        return result;
+    }
+
+    bool header_block_t::contains(const string_t& name, const string_t& value) const {
+        const auto id = header_name_of(name);
+        const auto hash = id == header_name_t::OTHER ? fold_hash(name) : 0;
+        for (const auto& entry : entries) {
+            if (same_name(entry, name, id, hash) and
+                string_view_t(buffer.data() + entry.value, entry.value_size) == value)
+                return true;
+        }
+        return false;
+    }
+
+    headers_t header_block_t::to_headers() const {
+        headers_t headers;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const auto header = (*this)[i];
+            headers.insert(header.first.to_string(), header.second.to_string());
         }
-        
-        const auto its = this->equal_range(name);
-        return its.first->second;
+        return headers;
     }
 
     std::ostream& operator<<(std::ostream& out, const headers_t& headers) {
@@ -93,5 +367,5 @@ namespace crequests {
         return headers_t::from_string(val);
     }
 
-    
+
 } /* namespace crequests */
@@ -3,20 +3,163 @@
 
 #include "types.h"
 
+#include <boost/container/small_vector.hpp>
+
+#include <initializer_list>
+
 namespace crequests {
 
-    using cookie_map = std::unordered_multimap<string_t, string_t, ihash, iequals>;
+    /*
+      Header names the library looks up itself. A header gets its id
+      once, when it is added, and lookups of these names compare ids
+      instead of strings.
+     */
+    enum class header_name_t : unsigned char {
+        OTHER,
+        CONNECTION,
+        CONTENT_ENCODING,
+        CONTENT_LENGTH,
+        LOCATION,
+        SET_COOKIE,
+        TRANSFER_ENCODING
+    };
 
-    class headers_t : public cookie_map {
-        using cookie_map::cookie_map;
+    header_name_t header_name_of(const string_view_t& name);
+
+    /*
+      One header line. Members are named like a map pair, so loops
+      over headers read header.first and header.second. The hash is
+      of the case folded name.
+     */
+    struct header_t {
+        header_t(string_t name, string_t value);
+
+        string_t first;
+        string_t second;
+        std::size_t hash;
+        header_name_t id;
+    };
+
+    /*
+      Headers in the order they were added, stored inline for a usual
+      request or response. Names are case insensitive, a name may
+      occur several times. Equality does not depend on the order.
+     */
+    class headers_t {
+    public:
+        using value_type = header_t;
+        using container_t = boost::container::small_vector<header_t, 8>;
+        using const_iterator = container_t::const_iterator;
+        using iterator = const_iterator;
+
+    public:
+        headers_t() = default;
+        headers_t(std::initializer_list<std::pair<string_t, string_t> > headers);
 
     public:
         static headers_t from_string(const string_t& str);
         string_t to_string() const;
+
+        /*
+          Appends what to_string() returns, string_size() bytes,
+          so a request head can be built in one buffer.
+         */
+        void append_to(string_t& out) const;
+        size_t string_size() const;
+
         void update(const headers_t& params);
         bool contains(const string_t& name, const string_t& value) const;
-        void insert(const string_t& name, const string_t& value);
+
+        /*
+          Replaces the value of the first header with the name,
+          or adds a header. Set-Cookie is always added.
+         */
+        void insert(string_t name, string_t value);
+
+        /*
+          The value of the first header with the name, or an empty string.
+         */
         string_t at(const string_t& name) const;
+
+        void emplace(string_t name, string_t value);
+        const_iterator find(const string_t& name) const;
+        size_t count(const string_t& name) const;
+
+        /*
+          Removes all headers with the name, returns how many.
+         */
+        size_t erase(const string_t& name);
+
+        const_iterator begin() const;
+        const_iterator end() const;
+        bool empty() const;
+        size_t size() const;
+        void clear();
+
+        bool operator==(const headers_t& headers) const;
+        bool operator!=(const headers_t& headers) const;
+
+    private:
+        container_t::iterator find(const string_t& name);
+
+    private:
+        container_t headers {};
+    };
+
+    /*
+      Received headers kept as one block: names and values are copied
+      into a single buffer as the parser delivers them, and read back
+      as views into it. Nothing else is allocated per header, headers_t
+      and cookies are built from the block only when asked for.
+
+      Views stay valid until the block is changed.
+     */
+    class header_block_t {
+    public:
+        using view_t = std::pair<string_view_t, string_view_t>;
+
+    public:
+        /*
+          Pieces of the current header. A name piece after a value
+          starts the next header.
+         */
+        void append_name(const char* at, const size_t length);
+        void append_value(const char* at, const size_t length);
+        void clear();
+
+        size_t size() const;
+        bool empty() const;
+        view_t operator[](const size_t index) const;
+
+        /*
+          The value headers_t::insert() would keep for the name: the
+          last one received. An empty view if there is no such header.
+         */
+        string_view_t at(const string_t& name) const;
+        size_t count(const string_t& name) const;
+        bool contains(const string_t& name, const string_t& value) const;
+
+        headers_t to_headers() const;
+
+    private:
+        struct entry_t {
+            size_t name;
+            size_t name_size;
+            size_t value;
+            size_t value_size;
+            std::size_t hash;
+            header_name_t id;
+        };
+
+        bool same_name(const entry_t& entry,
+                       const string_t& name,
+                       const header_name_t id,
+                       const std::size_t hash) const;
+
+    private:
+        string_t buffer {};
+        boost::container::small_vector<entry_t, 16> entries {};
+        bool is_value {false};
     };
 
     std::ostream& operator<<(std::ostream& out, const headers_t& headers);
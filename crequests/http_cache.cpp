@@ -0,0 +1,370 @@
+#include "http_cache.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <locale>
+#include <sstream>
+
+namespace crequests {
+
+
+    namespace {
+
+        using lock_t = std::lock_guard<std::mutex>;
+        using directives_t = std::unordered_map<string_t, string_t>;
+
+        /*
+          Heuristic freshness is a tenth of the time since Last-Modified,
+          but not more than a day.
+         */
+        const std::time_t MAX_HEURISTIC_LIFETIME = 86400;
+
+        /*
+          Directives of a Cache-Control value by lower case name. A quoted
+          argument is kept without the quotes.
+         */
+        directives_t cache_control(const string_t& value) {
+            directives_t directives;
+            for (const auto& part : split(value, ',')) {
+                const auto directive = trim(part);
+                if (directive.empty())
+                    continue;
+
+                const auto equal = directive.find('=');
+                if (equal == string_t::npos) {
+                    directives[tolower(directive)] = "";
+                    continue;
+                }
+
+                auto argument = trim(directive.substr(equal + 1));
+                if (argument.size() >= 2 and argument.front() == '"' and argument.back() == '"')
+                    argument = argument.substr(1, argument.size() - 2);
+                directives[tolower(trim(directive.substr(0, equal)))] = argument;
+            }
+            return directives;
+        }
+
+        bool parse_seconds(const string_t& value, std::time_t& seconds) {
+            if (value.empty() or value.size() > 10 or
+                not std::all_of(value.begin(), value.end(), ::isdigit))
+                return false;
+
+            seconds = static_cast<std::time_t>(std::stoll(value));
+            return true;
+        }
+
+        /*
+          An HTTP-date in any of the three formats of RFC 7231.
+         */
+        bool parse_date(const string_t& value, std::time_t& time) {
+            static const char* const formats[] = {
+                "%a, %d %b %Y %H:%M:%S",
+                "%A, %d-%b-%y %H:%M:%S",
+                "%a %b %d %H:%M:%S %Y"
+            };
+
+            for (const auto format : formats) {
+                std::tm tm {};
+                std::istringstream in(value);
+                in.imbue(std::locale::classic());
+                in >> std::get_time(&tm, format);
+                if (not in.fail()) {
+                    time = timegm(&tm);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        string_t cache_key(const request_t& request) {
+            const auto& uri = request.uri();
+            auto key =
+                request.method().value() + " " +
+                uri.protocol().value() + "://" +
+                uri.domain().value() + ":" +
+                uri.port().value() +
+                uri.path().value();
+            if (not uri.query().empty())
+                key += "?" + uri.query().value();
+            return key;
+        }
+
+        bool is_safe_method(const request_t& request) {
+            const auto& method = request.method().value();
+            return method == "GET" or method == "HEAD";
+        }
+
+        /*
+          Status codes which may be stored without explicit freshness.
+         */
+        bool is_heuristic_status(const unsigned int code) {
+            switch (code) {
+            case 200: case 203: case 204: case 300: case 301:
+            case 404: case 405: case 410: case 414: case 501:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        bool bypasses(const request_t& request) {
+            if (not is_safe_method(request) or
+                request.body_callback() or
+                not request.body_source().empty())
+                return true;
+
+            const auto& headers = request.headers();
+            for (const auto name : {"If-None-Match", "If-Modified-Since", "If-Match",
+                                    "If-Unmodified-Since", "If-Range", "Range"})
+                if (headers.count(name))
+                    return true;
+
+            return cache_control(headers.at("Cache-Control")).count("no-store") > 0;
+        }
+
+        /*
+          True when the request has the values of the headers named by
+          Vary of the stored response.
+         */
+        bool is_same_variant(const response_t& stored, const request_t& request) {
+            const auto vary = stored.header("Vary");
+            if (vary.empty())
+                return true;
+
+            const auto& stored_headers = stored.request().headers();
+            for (const auto& part : split(vary, ',')) {
+                const auto name = trim(part);
+                if (name == "*" or stored_headers.at(name) != request.headers().at(name))
+                    return false;
+            }
+            return true;
+        }
+
+        std::time_t freshness_lifetime(const response_t& response,
+                                       const directives_t& directives,
+                                       const std::time_t date)
+        {
+            std::time_t lifetime = 0;
+            const auto max_age = directives.find("max-age");
+            if (max_age != directives.end())
+                return parse_seconds(max_age->second, lifetime) ? lifetime : 0;
+
+            if (response.has_header("Expires")) {
+                std::time_t expires = 0;
+                if (not parse_date(response.header("Expires"), expires))
+                    return 0;
+                return std::max<std::time_t>(expires - date, 0);
+            }
+
+            std::time_t last_modified = 0;
+            if (is_heuristic_status(response.status_code().value()) and
+                parse_date(response.header("Last-Modified"), last_modified))
+                return std::min((date - last_modified) / 10, MAX_HEURISTIC_LIFETIME);
+
+            return 0;
+        }
+
+    } /* anonymous namespace */
+
+
+    http_cache_t::http_cache_t()
+    {
+
+    }
+
+    http_cache_t::~http_cache_t()
+    {
+
+    }
+
+    void http_cache_t::set_option(const http_cache_size_t& max_size_) {
+        const lock_t lock(mutex);
+        max_size = max_size_.value();
+        while (total > max_size)
+            erase(entries.back().key);
+    }
+
+    bool http_cache_t::enabled() const {
+        return max_size > 0;
+    }
+
+    http_cache_t::found_t http_cache_t::lookup(const request_t& request) {
+        found_t found {};
+        if (not enabled() or bypasses(request))
+            return found;
+
+        const auto key = cache_key(request);
+        const auto directives = cache_control(request.headers().at("Cache-Control"));
+        const bool no_cache = directives.count("no-cache") or
+            tolower(request.headers().at("Pragma")).find("no-cache") != string_t::npos;
+        const auto now = std::time(nullptr);
+
+        const lock_t lock(mutex);
+        const auto it = index.find(key);
+        if (it == index.end() or not is_same_variant(it->second->response, request)) {
+            ++misses_count;
+            return found;
+        }
+
+        entries.splice(entries.begin(), entries, it->second);
+        const auto& entry = entries.front();
+        const auto age = entry.initial_age + std::max<std::time_t>(now - entry.response_time, 0);
+
+        bool is_fresh = age < entry.lifetime and not entry.no_cache and not no_cache;
+        std::time_t max_age = 0;
+        const auto request_max_age = directives.find("max-age");
+        if (is_fresh and request_max_age != directives.end() and
+            parse_seconds(request_max_age->second, max_age))
+            is_fresh = age <= max_age;
+
+        if (is_fresh) {
+            ++hits_count;
+            found.fresh = entry.response;
+        }
+        else if (entry.has_validator) {
+            ++revalidations_count;
+            found.stale = entry.response;
+        }
+        else {
+            ++misses_count;
+        }
+        return found;
+    }
+
+    request_t http_cache_t::conditional(const request_t& request, const response_t& stale) {
+        auto result = request;
+        auto headers = result.headers();
+        if (stale.has_header("ETag"))
+            headers.insert("If-None-Match", stale.header("ETag"));
+        if (stale.has_header("Last-Modified"))
+            headers.insert("If-Modified-Since", stale.header("Last-Modified"));
+        result.headers(std::move(headers));
+        return result;
+    }
+
+    void http_cache_t::complete(response_t& response, const optional_t<response_t>& stale) {
+        if (not enabled() or response.error().code() != error_code_t::SUCCESS)
+            return;
+
+        const auto& request = response.request();
+        const auto key = cache_key(request);
+
+        if (not is_safe_method(request)) {
+            if (response.status_code().value() < 400) {
+                const lock_t lock(mutex);
+                erase("GET" + key.substr(key.find(' ')));
+                erase("HEAD" + key.substr(key.find(' ')));
+            }
+            return;
+        }
+
+        if (stale and response.status_code().value() == 304 and
+            cache_key(stale->request()) == key)
+        {
+            /*
+              The 304 updates the stored headers, except the ones
+              describing the stored body.
+             */
+            auto refreshed = *stale;
+            auto& headers = refreshed.headers();
+            for (const auto& header : response.headers())
+                if (header_name_of(header.first) != header_name_t::CONTENT_LENGTH and
+                    header_name_of(header.first) != header_name_t::TRANSFER_ENCODING)
+                    headers.insert(header.first, header.second);
+            refreshed.request(request);
+            refreshed.error(response.error());
+            response = std::move(refreshed);
+        }
+        else if (not stale and bypasses(request)) {
+            return;
+        }
+
+        store(key, response);
+    }
+
+    void http_cache_t::store(const string_t& key, const response_t& response) {
+        const auto directives = cache_control(response.header("Cache-Control"));
+        const bool has_validator =
+            response.has_header("ETag") or response.has_header("Last-Modified");
+        const bool is_storable =
+            not directives.count("no-store") and
+            response.header("Vary").find('*') == string_t::npos and
+            not cache_control(response.request().headers().at("Cache-Control")).count("no-store") and
+            (is_heuristic_status(response.status_code().value()) or
+             directives.count("max-age") or response.has_header("Expires"));
+
+        const auto now = std::time(nullptr);
+        std::time_t date = now;
+        if (not parse_date(response.header("Date"), date))
+            date = now;
+        std::time_t age = 0;
+        parse_seconds(response.header("Age"), age);
+
+        const auto lifetime = freshness_lifetime(response, directives, date);
+
+        const lock_t lock(mutex);
+        erase(key);
+        if (not is_storable or (lifetime <= 0 and not has_validator))
+            return;
+
+        entry_t entry {key, response, 0, now,
+                       std::max(std::max<std::time_t>(now - date, 0), age),
+                       lifetime, directives.count("no-cache") > 0, has_validator};
+
+        const auto& raw = entry.response.raw().value();
+        const auto& content = entry.response.content();
+        entry.size = key.size() + raw.size() + entry.response.headers().string_size() +
+            (&content != &raw ? content.size() : 0);
+        if (entry.size > max_size)
+            return;
+
+        entries.push_front(std::move(entry));
+        index[key] = entries.begin();
+        total += entries.front().size;
+        while (total > max_size)
+            erase(entries.back().key);
+    }
+
+    void http_cache_t::erase(const string_t& key) {
+        const auto it = index.find(key);
+        if (it == index.end())
+            return;
+
+        total -= it->second->size;
+        entries.erase(it->second);
+        index.erase(it);
+    }
+
+    void http_cache_t::clear() {
+        const lock_t lock(mutex);
+        entries.clear();
+        index.clear();
+        total = 0;
+    }
+
+    size_t http_cache_t::count() const {
+        const lock_t lock(mutex);
+        return entries.size();
+    }
+
+    size_t http_cache_t::size() const {
+        const lock_t lock(mutex);
+        return total;
+    }
+
+    size_t http_cache_t::hits() const {
+        return hits_count;
+    }
+
+    size_t http_cache_t::misses() const {
+        return misses_count;
+    }
+
+    size_t http_cache_t::revalidations() const {
+        return revalidations_count;
+    }
+
+
+} /* namespace crequests */
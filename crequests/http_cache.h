@@ -0,0 +1,116 @@
+#ifndef HTTP_CACHE_H
+#define HTTP_CACHE_H
+
+#include "macros.h"
+#include "response.h"
+#include "types.h"
+
+#include <atomic>
+#include <ctime>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace crequests {
+
+    declare_number(http_cache_size, size_t)
+
+    /*
+      Service wide private cache of responses to GET and HEAD requests
+      (RFC 7234). Responses are kept as Cache-Control, Expires, ETag and
+      Last-Modified allow, up to http_cache_size_t bytes in total, and
+      the least recently used ones are evicted first. The cache is off
+      while the size is zero, which is the default.
+
+      A fresh response is given back without a request to the server.
+      A stale one with a validator is revalidated with If-None-Match and
+      If-Modified-Since, and a 304 answer refreshes it. Requests with
+      their own conditional headers, Range, Cache-Control: no-store or
+      a body callback bypass the cache.
+     */
+    class http_cache_t {
+    public:
+        /*
+          What lookup() found. A fresh response is served as it is,
+          a stale one has to be revalidated first. Both are empty on
+          a miss.
+         */
+        struct found_t {
+            optional_t<response_t> fresh;
+            optional_t<response_t> stale;
+        };
+
+    public:
+        http_cache_t();
+        http_cache_t(const http_cache_t& cache) = delete;
+        http_cache_t& operator=(const http_cache_t& cache) = delete;
+        ~http_cache_t();
+
+    public:
+        void set_option(const http_cache_size_t& max_size);
+        bool enabled() const;
+
+        /*
+          Looks up the response to a prepared request. A fresh response
+          is counted as a hit, a stale one with a validator as a
+          revalidation and anything else as a miss.
+         */
+        found_t lookup(const request_t& request);
+
+        /*
+          The request with the validators of a stale response, which
+          is sent to revalidate it.
+         */
+        static request_t conditional(const request_t& request, const response_t& stale);
+
+        /*
+          Called with every finished response. A 304 to the revalidation
+          of stale replaces the response by the refreshed stale one. A
+          storable response is kept, and a successful unsafe request
+          drops the responses to its url.
+         */
+        void complete(response_t& response, const optional_t<response_t>& stale);
+
+        void clear();
+
+        /*
+          The number of responses and the bytes they take.
+         */
+        size_t count() const;
+        size_t size() const;
+
+        size_t hits() const;
+        size_t misses() const;
+        size_t revalidations() const;
+
+    private:
+        struct entry_t {
+            string_t key;
+            response_t response;
+            size_t size;
+            std::time_t response_time;
+            std::time_t initial_age;
+            std::time_t lifetime;
+            bool no_cache;
+            bool has_validator;
+        };
+
+        using entries_t = std::list<entry_t>;
+
+        void store(const string_t& key, const response_t& response);
+        void erase(const string_t& key);
+
+    private:
+        mutable std::mutex mutex {};
+        entries_t entries {};
+        std::unordered_map<string_t, entries_t::iterator> index {};
+        size_t total {0};
+        std::atomic<size_t> max_size {0};
+        std::atomic<size_t> hits_count {0};
+        std::atomic<size_t> misses_count {0};
+        std::atomic<size_t> revalidations_count {0};
+    };
+
+} /* namespace crequests */
+
+#endif /* HTTP_CACHE_H */
@@ -1,6 +1,7 @@
 #ifndef MACROS_H
 #define MACROS_H
 
+#include <chrono>
 #include <iostream>
 
 #define declare_string(class_name) \
@@ -112,4 +113,38 @@
         return class_name##_t { Chars... }; \
     }
 
+/*
+  A time interval option kept in milliseconds. It is made from any
+  std::chrono duration; a zero interval means the option is not set.
+ */
+#define declare_duration(class_name) \
+    class class_name##_t { \
+    public: \
+        explicit class_name##_t() = default; \
+        template <class Rep, class Period> \
+        explicit class_name##_t(const std::chrono::duration<Rep, Period>& arg) \
+            : val(std::chrono::duration_cast<std::chrono::milliseconds>(arg)) {} \
+        class_name##_t(const class_name##_t& arg) = default;            \
+        class_name##_t(class_name##_t&& arg) = default;                 \
+        class_name##_t& operator = (const class_name##_t& arg) = default; \
+        class_name##_t& operator = (class_name##_t&& arg) = default;    \
+        \
+        bool operator==(const class_name##_t& rhs) const { \
+            return val == rhs.val; \
+        } \
+        bool operator!=(const class_name##_t& rhs) const { \
+            return val != rhs.val; \
+        } \
+        const std::chrono::milliseconds& value() const { return val; } \
+        std::chrono::milliseconds& value() { return val; } \
+        bool empty() const { return val.count() <= 0; } \
+        \
+    private: \
+        std::chrono::milliseconds val {0}; \
+    }; \
+    inline std::ostream& operator<<(std::ostream& out, const class_name##_t& arg) {\
+        out << arg.value().count() << "ms";                              \
+        return out; \
+    }
+
 #endif /* MACROS_H */
@@ -1,4 +1,5 @@
 #include "params.h"
+#include "scan.h"
 #include "utils.h"
 
 #include <sstream>
@@ -7,18 +8,33 @@
 namespace crequests {
 
 
+    /*
+      Pairs without '=' are skipped.
+     */
     params_t params_t::from_string(const string_t& str) {
-        std::istringstream stream(str);
+        static const delimiters_t NAME_END("&=");
+        static const delimiters_t VALUE_END("&");
+
         params_t params;
+        const char* it = str.data();
+        const char* const end = it + str.size();
+
+        while (it < end) {
+            const auto name_end = NAME_END.find(it, end);
+            if (name_end == end)
+                break;
+
+            if (*name_end == '&') {
+                it = name_end + 1;
+                continue;
+            }
 
-        string_t name_value;
-        while (std::getline(stream, name_value, '&')) {
-            const auto ind = name_value.find("=");
-            if (ind != string_t::npos)
-                params.insert({
-                    name_value.substr(0, ind),
-                    name_value.substr(ind + 1)
-                });
+            const auto value_end = VALUE_END.find(name_end + 1, end);
+            params.insert({
+                string_t(it, name_end),
+                string_t(name_end + 1, value_end)
+            });
+            it = value_end == end ? end : value_end + 1;
         }
 
         return params;
@@ -73,6 +73,170 @@ namespace crequests {
         } data {};
     };
 
+
+    /*
+      Callbacks of basic_parser_t which do nothing. A handler derives
+      from it and declares only the callbacks it is interested in.
+     */
+    struct parser_handler_t {
+        void on_message_begin() {}
+        void on_url(const char*, const size_t) {}
+        void on_status(const char*,
+                       const size_t,
+                       const unsigned short,
+                       const unsigned short,
+                       const unsigned int) {}
+        void on_header_field(const char*, const size_t) {}
+        void on_header_value(const char*, const size_t) {}
+        void on_headers_complete(const size_t) {}
+        void on_body(const char*, const size_t) {}
+        void on_message_complete() {}
+        void on_chunk_header(const size_t) {}
+        void on_chunk_complete() {}
+    };
+
+
+    /*
+      Parser with the handler type known at compile time. The callbacks
+      of http_parser are trampolines of this handler type which call its
+      methods directly instead of going through std::function as in
+      parser_t, so nothing has to be bound per message and the handler
+      code is inlined into them. The handler must outlive the parser.
+     */
+    template <class HandlerT>
+    class basic_parser_t {
+    public:
+        using parser_type_t = parser_t::parser_type_t;
+
+    public:
+        basic_parser_t(const parser_type_t& parser_type_, HandlerT& handler)
+            : parser_type(parser_type_)
+        {
+            parser.data = &handler;
+            reset();
+        }
+
+        basic_parser_t(const basic_parser_t& parser_) = delete;
+        basic_parser_t& operator=(const basic_parser_t& parser_) = delete;
+
+    public:
+        /*
+          Prepares the parser for the next message.
+         */
+        void reset() {
+            http_parser_init(&parser,
+                             parser_type == parser_type_t::REQUEST
+                             ? HTTP_REQUEST
+                             : HTTP_RESPONSE);
+        }
+
+        size_t execute(const char* data, const size_t length) {
+            const size_t nparsed =
+                http_parser_execute(&parser, &settings, data, length);
+            if (parser.http_errno != HPE_OK and parser.http_errno != HPE_PAUSED)
+                return 0;
+            return nparsed;
+        }
+
+        void pause() {
+            if (parser.http_errno != HPE_PAUSED)
+                http_parser_pause(&parser, 1);
+        }
+
+        void unpause() {
+            if (parser.http_errno == HPE_PAUSED)
+                http_parser_pause(&parser, 0);
+        }
+
+        const char* error_message() const {
+            return http_errno_description(static_cast<http_errno>(parser.http_errno));
+        }
+
+    private:
+        static HandlerT& handler_of(http_parser* parser_) {
+            return *static_cast<HandlerT*>(parser_->data);
+        }
+
+        static int cb_message_begin(http_parser* parser_) {
+            handler_of(parser_).on_message_begin();
+            return 0;
+        }
+
+        static int cb_url(http_parser* parser_, const char* at, const size_t length) {
+            handler_of(parser_).on_url(at, length);
+            return 0;
+        }
+
+        static int cb_status(http_parser* parser_, const char* at, const size_t length) {
+            handler_of(parser_).on_status(at,
+                                          length,
+                                          parser_->http_major,
+                                          parser_->http_minor,
+                                          parser_->status_code);
+            return 0;
+        }
+
+        static int cb_header_field(http_parser* parser_, const char* at, const size_t length) {
+            handler_of(parser_).on_header_field(at, length);
+            return 0;
+        }
+
+        static int cb_header_value(http_parser* parser_, const char* at, const size_t length) {
+            handler_of(parser_).on_header_value(at, length);
+            return 0;
+        }
+
+        static int cb_headers_complete(http_parser* parser_) {
+            handler_of(parser_).on_headers_complete(parser_->content_length);
+            return 0;
+        }
+
+        static int cb_body(http_parser* parser_, const char* at, const size_t length) {
+            handler_of(parser_).on_body(at, length);
+            return 0;
+        }
+
+        static int cb_message_complete(http_parser* parser_) {
+            handler_of(parser_).on_message_complete();
+            return 0;
+        }
+
+        static int cb_chunk_header(http_parser* parser_) {
+            handler_of(parser_).on_chunk_header(parser_->content_length);
+            return 0;
+        }
+
+        static int cb_chunk_complete(http_parser* parser_) {
+            handler_of(parser_).on_chunk_complete();
+            return 0;
+        }
+
+        static http_parser_settings make_settings() {
+            http_parser_settings settings_ {};
+            http_parser_settings_init(&settings_);
+            settings_.on_message_begin = cb_message_begin;
+            settings_.on_url = cb_url;
+            settings_.on_status = cb_status;
+            settings_.on_header_field = cb_header_field;
+            settings_.on_header_value = cb_header_value;
+            settings_.on_headers_complete = cb_headers_complete;
+            settings_.on_body = cb_body;
+            settings_.on_chunk_header = cb_chunk_header;
+            settings_.on_chunk_complete = cb_chunk_complete;
+            settings_.on_message_complete = cb_message_complete;
+            return settings_;
+        }
+
+    private:
+        static const http_parser_settings settings;
+        http_parser parser {};
+        parser_type_t parser_type;
+    };
+
+    template <class HandlerT>
+    const http_parser_settings basic_parser_t<HandlerT>::settings =
+        basic_parser_t<HandlerT>::make_settings();
+
     
 } /* namespace crequests */
 
@@ -0,0 +1,149 @@
+#include "pool.h"
+#include "stream.h"
+
+namespace crequests {
+
+
+    namespace {
+
+        using lock_t = std::lock_guard<std::mutex>;
+
+    } /* anonymous namespace */
+
+
+    pool_t::pool_t()
+    {
+
+    }
+
+    pool_t::~pool_t()
+    {
+        clear();
+    }
+
+    void pool_t::set_option(const pool_max_idle_per_host_t& max_idle_per_host_) {
+        const lock_t lock(mutex);
+        max_idle_per_host = max_idle_per_host_;
+    }
+
+    void pool_t::set_option(const pool_max_total_t& max_total_) {
+        const lock_t lock(mutex);
+        max_total = max_total_;
+    }
+
+    void pool_t::set_option(const pool_idle_timeout_t& idle_timeout_) {
+        const lock_t lock(mutex);
+        idle_timeout = idle_timeout_;
+    }
+
+    pool_t::stream_ptr_t pool_t::acquire(const string_t& key) {
+        const lock_t lock(mutex);
+
+        const auto it = entries.find(key);
+        if (it == entries.end())
+            return nullptr;
+
+        auto& host_entries = it->second;
+        while (not host_entries.empty()) {
+            auto stream = std::move(host_entries.back().stream);
+            host_entries.pop_back();
+            total--;
+
+            if (stream->is_alive()) {
+                if (host_entries.empty())
+                    entries.erase(it);
+                return stream;
+            }
+        }
+
+        entries.erase(it);
+        return nullptr;
+    }
+
+    bool pool_t::release(const string_t& key, stream_ptr_t stream) {
+        const lock_t lock(mutex);
+
+        if (max_total.value() == 0 or max_idle_per_host.value() == 0)
+            return false;
+
+        const auto it = entries.find(key);
+        if (it != entries.end() and
+            it->second.size() >= max_idle_per_host.value())
+            return false;
+
+        while (total >= max_total.value() and evict_oldest())
+            ;
+
+        entries[key].push_back(entry_t{std::move(stream), steady_clock_t::now()});
+        total++;
+
+        return true;
+    }
+
+    void pool_t::reap() {
+        const lock_t lock(mutex);
+
+        const auto deadline =
+            steady_clock_t::now() - seconds_t{idle_timeout.value()};
+
+        auto it = entries.begin();
+        while (it != entries.end()) {
+            auto& host_entries = it->second;
+            while (not host_entries.empty() and
+                   host_entries.front().released <= deadline)
+            {
+                host_entries.pop_front();
+                total--;
+            }
+
+            if (host_entries.empty())
+                it = entries.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    void pool_t::clear() {
+        const lock_t lock(mutex);
+        entries.clear();
+        total = 0;
+    }
+
+    size_t pool_t::size() const {
+        const lock_t lock(mutex);
+        return total;
+    }
+
+    size_t pool_t::size(const string_t& key) const {
+        const lock_t lock(mutex);
+        const auto it = entries.find(key);
+        return it == entries.end() ? 0 : it->second.size();
+    }
+
+    /*
+      The oldest entry of every host is at the front of its deque,
+      so the oldest one of the pool is the oldest of these fronts.
+     */
+    bool pool_t::evict_oldest() {
+        auto oldest = entries.end();
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->second.empty())
+                continue;
+            if (oldest == entries.end() or
+                it->second.front().released < oldest->second.front().released)
+                oldest = it;
+        }
+
+        if (oldest == entries.end())
+            return false;
+
+        oldest->second.pop_front();
+        total--;
+        if (oldest->second.empty())
+            entries.erase(oldest);
+
+        return true;
+    }
+
+
+} /* namespace crequests */
@@ -0,0 +1,86 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include "macros.h"
+#include "types.h"
+
+#include <deque>
+#include <mutex>
+
+namespace crequests {
+
+    declare_number(pool_max_idle_per_host, size_t)
+    declare_number(pool_max_total, size_t)
+    declare_number(pool_idle_timeout, size_t)
+
+    class stream_t;
+
+    /*
+      Service wide storage of idle keep-alive streams. Streams are kept
+      per key (protocol, domain and port of the request) and are given
+      back in LIFO order, so the most recently used (and most likely
+      still alive) socket is reused first.
+     */
+    class pool_t {
+    public:
+        using stream_ptr_t = shared_ptr_t<stream_t>;
+
+    public:
+        pool_t();
+        pool_t(const pool_t& pool) = delete;
+        pool_t& operator=(const pool_t& pool) = delete;
+        ~pool_t();
+
+    public:
+        void set_option(const pool_max_idle_per_host_t& max_idle_per_host);
+        void set_option(const pool_max_total_t& max_total);
+        void set_option(const pool_idle_timeout_t& idle_timeout);
+
+        /*
+          Returns the most recently released live stream for the key or
+          nullptr when there is nothing to reuse. Dead streams found on
+          the way are dropped.
+         */
+        stream_ptr_t acquire(const string_t& key);
+
+        /*
+          Puts an idle stream to the pool. Returns false if the pool is
+          disabled or the per host limit is reached and the stream was not
+          taken. When the total limit is reached the oldest idle stream of
+          the whole pool is closed to make room for the new one.
+         */
+        bool release(const string_t& key, stream_ptr_t stream);
+
+        /*
+          Closes all streams which are idle longer than the idle timeout.
+         */
+        void reap();
+
+        void clear();
+        size_t size() const;
+        size_t size(const string_t& key) const;
+
+    private:
+        using steady_clock_t = std::chrono::steady_clock;
+
+        struct entry_t {
+            stream_ptr_t stream;
+            steady_clock_t::time_point released;
+        };
+
+        using entries_t = std::deque<entry_t>;
+
+        bool evict_oldest();
+
+    private:
+        mutable std::mutex mutex {};
+        std::unordered_map<string_t, entries_t> entries {};
+        size_t total {0};
+        pool_max_idle_per_host_t max_idle_per_host {10};
+        pool_max_total_t max_total {100};
+        pool_idle_timeout_t idle_timeout {30};
+    };
+
+} /* namespace crequests */
+
+#endif /* POOL_H */
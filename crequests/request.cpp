@@ -17,6 +17,11 @@ namespace crequests {
           m_method {request.m_method},
           m_timeout {request.m_timeout},
           m_store_timeout {request.m_store_timeout},
+          m_connect_timeout {request.m_connect_timeout},
+          m_handshake_timeout {request.m_handshake_timeout},
+          m_first_byte_timeout {request.m_first_byte_timeout},
+          m_read_timeout {request.m_read_timeout},
+          m_total_timeout {request.m_total_timeout},
           m_redirect {request.m_redirect},
           m_redirect_count {request.m_redirect_count},
           m_gzip {request.m_gzip},
@@ -35,7 +40,15 @@ namespace crequests {
           m_verify_path {request.m_verify_path},
           m_verify_filename {request.m_verify_filename},
           m_certificate_file {request.m_certificate_file},
-          m_private_key_file {request.m_private_key_file}
+          m_private_key_file {request.m_private_key_file},
+          m_lazy_headers {request.m_lazy_headers},
+          m_body_source {request.m_body_source},
+          m_compress_min_size {request.m_compress_min_size},
+          m_compress_level {request.m_compress_level},
+          m_compress_encoding {request.m_compress_encoding},
+          m_retry_policy {request.m_retry_policy},
+          m_encoded_data {request.m_encoded_data},
+          m_encoded_coding {request.m_encoded_coding}
     {
 
     }
@@ -45,6 +58,11 @@ namespace crequests {
           m_method {std::move(request.m_method)},
           m_timeout {std::move(request.m_timeout)},
           m_store_timeout {std::move(request.m_store_timeout)},
+          m_connect_timeout {std::move(request.m_connect_timeout)},
+          m_handshake_timeout {std::move(request.m_handshake_timeout)},
+          m_first_byte_timeout {std::move(request.m_first_byte_timeout)},
+          m_read_timeout {std::move(request.m_read_timeout)},
+          m_total_timeout {std::move(request.m_total_timeout)},
           m_redirect {std::move(request.m_redirect)},
           m_redirect_count {std::move(request.m_redirect_count)},
           m_gzip {std::move(request.m_gzip)},
@@ -63,7 +81,15 @@ namespace crequests {
           m_verify_path {std::move(request.m_verify_path)},
           m_verify_filename {std::move(request.m_verify_filename)},
           m_certificate_file {std::move(request.m_certificate_file)},
-          m_private_key_file {std::move(request.m_private_key_file)}
+          m_private_key_file {std::move(request.m_private_key_file)},
+          m_lazy_headers {std::move(request.m_lazy_headers)},
+          m_body_source {std::move(request.m_body_source)},
+          m_compress_min_size {std::move(request.m_compress_min_size)},
+          m_compress_level {std::move(request.m_compress_level)},
+          m_compress_encoding {std::move(request.m_compress_encoding)},
+          m_retry_policy {std::move(request.m_retry_policy)},
+          m_encoded_data {std::move(request.m_encoded_data)},
+          m_encoded_coding {std::move(request.m_encoded_coding)}
     {
 
     }
@@ -74,6 +100,11 @@ namespace crequests {
             m_method = request.m_method;
             m_timeout = request.m_timeout;
             m_store_timeout = request.m_store_timeout;
+            m_connect_timeout = request.m_connect_timeout;
+            m_handshake_timeout = request.m_handshake_timeout;
+            m_first_byte_timeout = request.m_first_byte_timeout;
+            m_read_timeout = request.m_read_timeout;
+            m_total_timeout = request.m_total_timeout;
             m_redirect = request.m_redirect;
             m_redirect_count = request.m_redirect_count;
             m_gzip = request.m_gzip;
@@ -93,6 +124,14 @@ namespace crequests {
             m_verify_filename = request.m_verify_filename;
             m_certificate_file = request.m_certificate_file;
             m_private_key_file = request.m_private_key_file;
+            m_lazy_headers = request.m_lazy_headers;
+            m_body_source = request.m_body_source;
+            m_compress_min_size = request.m_compress_min_size;
+            m_compress_level = request.m_compress_level;
+            m_compress_encoding = request.m_compress_encoding;
+            m_retry_policy = request.m_retry_policy;
+            m_encoded_data = request.m_encoded_data;
+            m_encoded_coding = request.m_encoded_coding;
         }
 
         return *this;
@@ -204,6 +243,26 @@ namespace crequests {
         m_store_timeout = store_timeout;
     }
 
+    void request_t::connect_timeout(const connect_timeout_t& connect_timeout) {
+        m_connect_timeout = connect_timeout;
+    }
+
+    void request_t::handshake_timeout(const handshake_timeout_t& handshake_timeout) {
+        m_handshake_timeout = handshake_timeout;
+    }
+
+    void request_t::first_byte_timeout(const first_byte_timeout_t& first_byte_timeout) {
+        m_first_byte_timeout = first_byte_timeout;
+    }
+
+    void request_t::read_timeout(const read_timeout_t& read_timeout) {
+        m_read_timeout = read_timeout;
+    }
+
+    void request_t::total_timeout(const total_timeout_t& total_timeout) {
+        m_total_timeout = total_timeout;
+    }
+
     void request_t::redirect(const redirect_t& redirect) {
         m_redirect = redirect;
     }
@@ -218,6 +277,7 @@ namespace crequests {
 
     void request_t::data(const data_t& data) {
         m_data = data;
+        m_encoded_data.reset();
     }
 
     void request_t::headers(const headers_t& headers) {
@@ -280,6 +340,32 @@ namespace crequests {
         m_private_key_file = private_key_file;
     }
 
+    void request_t::lazy_headers(const lazy_headers_t& lazy_headers) {
+        m_lazy_headers = lazy_headers;
+    }
+
+    void request_t::body_source(const body_source_t& body_source) {
+        m_body_source = body_source;
+    }
+
+    void request_t::compress_min_size(const compress_min_size_t& compress_min_size) {
+        m_compress_min_size = compress_min_size;
+    }
+
+    void request_t::compress_level(const compress_level_t& compress_level) {
+        m_compress_level = compress_level;
+        m_encoded_data.reset();
+    }
+
+    void request_t::compress_encoding(const compress_encoding_t& compress_encoding) {
+        m_compress_encoding = compress_encoding;
+        m_encoded_data.reset();
+    }
+
+    void request_t::retry_policy(const retry_policy_t& retry_policy) {
+        m_retry_policy = retry_policy;
+    }
+
 
     /****************************************************************************
      * Set. Rvalue reference.
@@ -298,6 +384,26 @@ namespace crequests {
         m_store_timeout = std::move(store_timeout);
     }
 
+    void request_t::connect_timeout(connect_timeout_t&& connect_timeout) {
+        m_connect_timeout = std::move(connect_timeout);
+    }
+
+    void request_t::handshake_timeout(handshake_timeout_t&& handshake_timeout) {
+        m_handshake_timeout = std::move(handshake_timeout);
+    }
+
+    void request_t::first_byte_timeout(first_byte_timeout_t&& first_byte_timeout) {
+        m_first_byte_timeout = std::move(first_byte_timeout);
+    }
+
+    void request_t::read_timeout(read_timeout_t&& read_timeout) {
+        m_read_timeout = std::move(read_timeout);
+    }
+
+    void request_t::total_timeout(total_timeout_t&& total_timeout) {
+        m_total_timeout = std::move(total_timeout);
+    }
+
     void request_t::redirect(redirect_t&& redirect) {
         m_redirect = std::move(redirect);
     }
@@ -312,6 +418,7 @@ namespace crequests {
 
     void request_t::data(data_t&& data) {
         m_data = std::move(data);
+        m_encoded_data.reset();
     }
 
     void request_t::headers(headers_t&& headers) {
@@ -374,6 +481,32 @@ namespace crequests {
         m_private_key_file = std::move(private_key_file);
     }
 
+    void request_t::lazy_headers(lazy_headers_t&& lazy_headers) {
+        m_lazy_headers = std::move(lazy_headers);
+    }
+
+    void request_t::body_source(body_source_t&& body_source) {
+        m_body_source = std::move(body_source);
+    }
+
+    void request_t::compress_min_size(compress_min_size_t&& compress_min_size) {
+        m_compress_min_size = std::move(compress_min_size);
+    }
+
+    void request_t::compress_level(compress_level_t&& compress_level) {
+        m_compress_level = std::move(compress_level);
+        m_encoded_data.reset();
+    }
+
+    void request_t::compress_encoding(compress_encoding_t&& compress_encoding) {
+        m_compress_encoding = std::move(compress_encoding);
+        m_encoded_data.reset();
+    }
+
+    void request_t::retry_policy(retry_policy_t&& retry_policy) {
+        m_retry_policy = std::move(retry_policy);
+    }
+
 
     /****************************************************************************
      * Get. Constant reference.
@@ -396,6 +529,26 @@ namespace crequests {
         return m_store_timeout;
     }
 
+    const connect_timeout_t& request_t::connect_timeout() const {
+        return m_connect_timeout;
+    }
+
+    const handshake_timeout_t& request_t::handshake_timeout() const {
+        return m_handshake_timeout;
+    }
+
+    const first_byte_timeout_t& request_t::first_byte_timeout() const {
+        return m_first_byte_timeout;
+    }
+
+    const read_timeout_t& request_t::read_timeout() const {
+        return m_read_timeout;
+    }
+
+    const total_timeout_t& request_t::total_timeout() const {
+        return m_total_timeout;
+    }
+
     const redirect_t& request_t::redirect() const {
         return m_redirect;
     }
@@ -472,6 +625,30 @@ namespace crequests {
         return m_private_key_file;
     }
 
+    const lazy_headers_t& request_t::lazy_headers() const {
+        return m_lazy_headers;
+    }
+
+    const body_source_t& request_t::body_source() const {
+        return m_body_source;
+    }
+
+    const compress_min_size_t& request_t::compress_min_size() const {
+        return m_compress_min_size;
+    }
+
+    const compress_level_t& request_t::compress_level() const {
+        return m_compress_level;
+    }
+
+    const compress_encoding_t& request_t::compress_encoding() const {
+        return m_compress_encoding;
+    }
+
+    const retry_policy_t& request_t::retry_policy() const {
+        return m_retry_policy;
+    }
+
 
     /****************************************************************************
      * Other functions.
@@ -479,56 +656,105 @@ namespace crequests {
 
 
     string_t request_t::make_request() const {
+        auto request = make_head();
+
+        if (m_body_source.empty())
+            request += body();
+
+        return request;
+    }
+
+    const string_t& request_t::body() const {
+        return m_encoded_data ? *m_encoded_data : m_data.value();
+    }
+
+    string_t request_t::make_head() const {
         assert(not m_method.empty());
         assert(not m_uri.path().empty());
         assert(not m_uri.domain().empty());
 
-        std::ostringstream out;
+        const auto& method = m_method.value();
+        const auto& path = m_uri.path().value();
+        const auto& query = m_uri.query().value();
+        const string_t version = " HTTP/1.1\r\n";
 
-        out << m_method << " " << m_uri.path();
+        const auto cookies = m_cookies.get(m_uri.domain().value(), path);
 
-        if (not m_uri.query().empty())
-            out << "?" + m_uri.query().value();
-
-        const auto cookies =
-            m_cookies.get(m_uri.domain().value(), m_uri.path().value());
-
-        auto headers_ = m_headers;
+        /*
+          The headers are copied only to add cookies.
+         */
+        optional_t<headers_t> with_cookies;
         if (not cookies.empty()) {
-            headers_.insert("Cookies", cookies.to_string());
+            with_cookies = m_headers;
+            with_cookies->insert("Cookies", cookies.to_string());
         }
+        const auto& headers_ = with_cookies ? *with_cookies : m_headers;
 
-        out << " " << "HTTP/1.1\r\n";
-        out << headers_.to_string();
+        string_t head;
+        head.reserve(method.size() + 1 + path.size() +
+                     (query.empty() ? 0 : query.size() + 1) +
+                     version.size() + headers_.string_size());
 
-        if (not m_data.empty()) {
-            if (m_gzip) {
-                out << compress(m_data.value());
-            }
-            else {
-                out << m_data;
-            }
-        }
+        head.append(method).append(" ").append(path);
+        if (not query.empty())
+            head.append("?").append(query);
+        head.append(version);
+        headers_.append_to(head);
 
-        return out.str();
+        return head;
     }
 
     void request_t::prepare()  {
         m_uri.prepare();
         assert(not m_uri.domain().empty() or not m_uri.url().empty());
-        if (m_gzip)
-            m_headers.insert("Content-Encoding", "gzip");
+        prepare_body();
         if (not m_auth.first.empty() and not m_auth.second.empty())
             m_headers.insert("Authorization",
                              "Basic " + b64encode(m_auth.to_string()));
         if (m_keep_alive)
             m_headers.insert("Connection", "keep-alive");
-        if (not m_data.empty())
-            m_headers.insert("Content-Length",
-                              std::to_string(m_data.value().size()));
+        if (not m_body_source.empty()) {
+            if (m_body_source.size())
+                m_headers.insert("Content-Length",
+                                 std::to_string(*m_body_source.size()));
+            else
+                m_headers.insert("Transfer-Encoding", "chunked");
+        }
+        else if (not m_data.empty()) {
+            m_headers.insert("Content-Length", std::to_string(body().size()));
+        }
         m_headers.insert("Host", m_uri.domain().value());
     }
 
+    /*
+      A compressed body is made once and kept until the data or the
+      compression options change. Content-Encoding added for it is
+      taken away when a later prepare() sends the data as it is.
+     */
+    void request_t::prepare_body() {
+        const bool is_compressed = m_gzip and m_body_source.empty() and
+            not m_data.empty() and m_data.value().size() >= m_compress_min_size.value();
+
+        if (not is_compressed) {
+            m_encoded_data.reset();
+            if (not m_encoded_coding.empty() and
+                m_headers.at("Content-Encoding") == m_encoded_coding)
+                m_headers.erase("Content-Encoding");
+            m_encoded_coding.clear();
+            return;
+        }
+
+        const auto coding = can_encode_content(m_compress_encoding.value())
+            ? m_compress_encoding.value()
+            : string_t("gzip");
+        if (not m_encoded_data or coding != m_encoded_coding) {
+            m_encoded_data = std::make_shared<const string_t>(
+                encode_content(coding, m_data.value(), m_compress_level.value()));
+            m_encoded_coding = coding;
+        }
+        m_headers.insert("Content-Encoding", coding);
+    }
+
     bool request_t::is_ssl() const {
         return uri().protocol().value() == "https";
     }
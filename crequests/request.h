@@ -2,9 +2,12 @@
 #define REQUEST_H
 
 #include "auth.h"
+#include "body_source.h"
 #include "cookies.h"
+#include "decoder.h"
 #include "headers.h"
 #include "macros.h"
+#include "retry.h"
 #include "ssl_auth.h"
 #include "ssl_certs.h"
 #include "types.h"
@@ -17,12 +20,21 @@ namespace crequests {
     declare_bool(cache_redirects)
     declare_bool(gzip)
     declare_bool(keep_alive)
+    declare_bool(lazy_headers)
     declare_bool(redirect)
     declare_bool(throw_on_error)
+    declare_number(compress_level, int)
+    declare_number(compress_min_size, size_t)
     declare_number(redirect_count, size_t)
     declare_number(store_timeout, size_t)
     declare_number(timeout, size_t)
+    declare_duration(connect_timeout)
+    declare_duration(handshake_timeout)
+    declare_duration(first_byte_timeout)
+    declare_duration(read_timeout)
+    declare_duration(total_timeout)
     declare_string(certificate_file)
+    declare_string(compress_encoding)
     declare_string(data)
     declare_string(private_key_file)
     declare_string(verify_filename)
@@ -32,7 +44,7 @@ namespace crequests {
 
     const headers_t DEFAULT_HEADERS {
         {"Accept", "*/*"},
-        {"Accept-Encoding", "gzip, deflate"},
+        {"Accept-Encoding", accept_encoding()},
         {"Connection", "close"},
         {"User-Agent", "Mozilla/5.0 (X11; Linux x86_64) "
                        "AppleWebKit/537.36 (KHTML, like Gecko) "
@@ -49,7 +61,30 @@ namespace crequests {
 
     public:
         void prepare();
+
+        /*
+          The whole request as it is sent. A body_source() is not read
+          here, so only its head is returned.
+         */
         string_t make_request() const;
+
+        /*
+          The request line and headers of make_request(), built in one
+          exactly sized string. The body is sent from body() without
+          being appended to it.
+         */
+        string_t make_head() const;
+
+        /*
+          The body sent for data(): data() itself, or data() compressed
+          by prepare(). Compression is done when gzip() is on and data()
+          has at least compress_min_size() bytes, with compress_encoding()
+          (gzip, or zstd when the library is built with it) at
+          compress_level(). The compressed body is kept, so prepare()
+          runs it once per data() in the thread which sends the request
+          and not on a service thread.
+         */
+        const string_t& body() const;
         bool is_ssl() const;
 
     public:
@@ -76,6 +111,11 @@ namespace crequests {
         void method(const method_t& method);
         void timeout(const timeout_t& timeout);
         void store_timeout(const store_timeout_t& store_timeout);
+        void connect_timeout(const connect_timeout_t& connect_timeout);
+        void handshake_timeout(const handshake_timeout_t& handshake_timeout);
+        void first_byte_timeout(const first_byte_timeout_t& first_byte_timeout);
+        void read_timeout(const read_timeout_t& read_timeout);
+        void total_timeout(const total_timeout_t& total_timeout);
         void redirect(const redirect_t& redirect);
         void redirect_count(const redirect_count_t& redirect_count);
         void gzip(const gzip_t& gzip);
@@ -95,10 +135,21 @@ namespace crequests {
         void verify_filename(const verify_filename_t& verify_filename);
         void certificate_file(const certificate_file_t& certificate_file);
         void private_key_file(const private_key_file_t& private_key_file);
+        void lazy_headers(const lazy_headers_t& lazy_headers);
+        void body_source(const body_source_t& body_source);
+        void compress_min_size(const compress_min_size_t& compress_min_size);
+        void compress_level(const compress_level_t& compress_level);
+        void compress_encoding(const compress_encoding_t& compress_encoding);
+        void retry_policy(const retry_policy_t& retry_policy);
 
         void method(method_t&& method);
         void timeout(timeout_t&& timeout);
         void store_timeout(store_timeout_t&& store_timeout);
+        void connect_timeout(connect_timeout_t&& connect_timeout);
+        void handshake_timeout(handshake_timeout_t&& handshake_timeout);
+        void first_byte_timeout(first_byte_timeout_t&& first_byte_timeout);
+        void read_timeout(read_timeout_t&& read_timeout);
+        void total_timeout(total_timeout_t&& total_timeout);
         void redirect(redirect_t&& redirect);
         void redirect_count(redirect_count_t&& redirect_count);
         void gzip(gzip_t&& gzip);
@@ -118,11 +169,22 @@ namespace crequests {
         void verify_filename(verify_filename_t&& verify_filename);
         void certificate_file(certificate_file_t&& certificate_file);
         void private_key_file(private_key_file_t&& private_key_file);
+        void lazy_headers(lazy_headers_t&& lazy_headers);
+        void body_source(body_source_t&& body_source);
+        void compress_min_size(compress_min_size_t&& compress_min_size);
+        void compress_level(compress_level_t&& compress_level);
+        void compress_encoding(compress_encoding_t&& compress_encoding);
+        void retry_policy(retry_policy_t&& retry_policy);
 
         const uri_t& uri() const;
         const method_t& method() const;
         const timeout_t& timeout() const;
         const store_timeout_t& store_timeout() const;
+        const connect_timeout_t& connect_timeout() const;
+        const handshake_timeout_t& handshake_timeout() const;
+        const first_byte_timeout_t& first_byte_timeout() const;
+        const read_timeout_t& read_timeout() const;
+        const total_timeout_t& total_timeout() const;
         const redirect_t& redirect() const;
         const redirect_count_t& redirect_count() const;
         const gzip_t& gzip() const;
@@ -142,12 +204,26 @@ namespace crequests {
         const verify_filename_t& verify_filename() const;
         const certificate_file_t& certificate_file() const;
         const private_key_file_t& private_key_file() const;
+        const lazy_headers_t& lazy_headers() const;
+        const body_source_t& body_source() const;
+        const compress_min_size_t& compress_min_size() const;
+        const compress_level_t& compress_level() const;
+        const compress_encoding_t& compress_encoding() const;
+        const retry_policy_t& retry_policy() const;
+
+    private:
+        void prepare_body();
 
     private:
         uri_t m_uri {};
         method_t m_method { "GET" };
         timeout_t m_timeout { 60 };
         store_timeout_t m_store_timeout { 60 };
+        connect_timeout_t m_connect_timeout {};
+        handshake_timeout_t m_handshake_timeout {};
+        first_byte_timeout_t m_first_byte_timeout {};
+        read_timeout_t m_read_timeout {};
+        total_timeout_t m_total_timeout {};
         redirect_t m_redirect { true };
         redirect_count_t m_redirect_count { 10 };
         gzip_t m_gzip { true };
@@ -167,6 +243,20 @@ namespace crequests {
         verify_filename_t m_verify_filename {};
         certificate_file_t m_certificate_file {};
         private_key_file_t m_private_key_file {};
+        lazy_headers_t m_lazy_headers {false};
+        body_source_t m_body_source {};
+        compress_min_size_t m_compress_min_size { 1024 };
+        compress_level_t m_compress_level { 6 };
+        compress_encoding_t m_compress_encoding { "gzip" };
+        retry_policy_t m_retry_policy {};
+
+        /*
+          data() encoded by prepare(), shared by the copies of the
+          request made for retries and redirects, and the coding it
+          is in. A change of the data or of the compression drops it.
+         */
+        shared_ptr_t<const string_t> m_encoded_data {};
+        string_t m_encoded_coding {};
     };
 
 
@@ -1,3 +1,4 @@
+#include "decoder.h"
 #include "response.h"
 #include "utils.h"
 
@@ -30,7 +31,10 @@ namespace crequests {
               m_redirect_count {response.m_pimpl->m_redirect_count},
               m_content {response.m_pimpl->m_content},
               m_redirects {response.m_pimpl->m_redirects},
-              m_cookies {response.m_pimpl->m_cookies}
+              m_cookies {response.m_pimpl->m_cookies},
+              m_header_block {response.m_pimpl->m_header_block},
+              m_lazy_headers {response.m_pimpl->m_lazy_headers},
+              m_lazy_cookies {response.m_pimpl->m_lazy_cookies}
         {
 
         }
@@ -47,24 +51,60 @@ namespace crequests {
               m_redirect_count {std::move(response.m_pimpl->m_redirect_count)},
               m_content {std::move(response.m_pimpl->m_content)},
               m_redirects {std::move(response.m_pimpl->m_redirects)},
-              m_cookies {std::move(response.m_pimpl->m_cookies)}
+              m_cookies {std::move(response.m_pimpl->m_cookies)},
+              m_header_block {std::move(response.m_pimpl->m_header_block)},
+              m_lazy_headers {response.m_pimpl->m_lazy_headers},
+              m_lazy_cookies {response.m_pimpl->m_lazy_cookies}
     {
 
     }
 
+    public:
+        /*
+          Build headers and cookies of a lazy_headers response from
+          its header block on first access.
+         */
+        void materialize_headers() const {
+            if (not m_lazy_headers)
+                return;
+
+            m_headers = m_header_block.to_headers();
+            m_lazy_headers = false;
+        }
+
+        void materialize_cookies() const {
+            if (not m_lazy_cookies)
+                return;
+
+            for (size_t i = 0; i < m_header_block.size(); ++i) {
+                const auto header = m_header_block[i];
+                if (header_name_of(header.first) != header_name_t::SET_COOKIE)
+                    continue;
+
+                auto cookie = cookie_t::from_string(header.second.to_string());
+                cookie.origin_domain(m_request.uri().domain().value());
+                cookie.origin_path(m_request.uri().path().value());
+                m_cookies.add(std::move(cookie));
+            }
+            m_lazy_cookies = false;
+        }
+
     public:
         request_t m_request {};
         http_major_t m_http_major {};
         http_minor_t m_http_minor {};
         status_code_t m_status_code {};
         status_message_t m_status_message {};
-        headers_t m_headers {};
+        mutable headers_t m_headers {};
         raw_t m_raw {};
         error_t m_error {};
         redirect_count_t m_redirect_count {};
         mutable content_t m_content {};
         redirects_t m_redirects {};
-        cookies_t m_cookies {};
+        mutable cookies_t m_cookies {};
+        header_block_t m_header_block {};
+        mutable bool m_lazy_headers {false};
+        mutable bool m_lazy_cookies {false};
     };
 
     response_t::response_t(const request_t& request)
@@ -149,6 +189,7 @@ namespace crequests {
 
     void response_t::headers(const headers_t& headers) {
         m_pimpl->m_headers = headers;
+        m_pimpl->m_lazy_headers = false;
     }
 
     void response_t::redirect_count(const redirect_count_t& redirect_count) {
@@ -165,6 +206,14 @@ namespace crequests {
 
     void response_t::cookies(const cookies_t& cookies) {
         m_pimpl->m_cookies = cookies;
+        m_pimpl->m_lazy_cookies = false;
+    }
+
+    void response_t::header_block(const header_block_t& header_block) {
+        m_pimpl->m_header_block = header_block;
+        m_pimpl->m_headers.clear();
+        m_pimpl->m_lazy_headers = true;
+        m_pimpl->m_lazy_cookies = true;
     }
 
 
@@ -203,6 +252,7 @@ namespace crequests {
 
     void response_t::headers(headers_t&& headers) {
         m_pimpl->m_headers = std::move(headers);
+        m_pimpl->m_lazy_headers = false;
     }
 
     void response_t::redirect_count(redirect_count_t&& redirect_count) {
@@ -219,6 +269,14 @@ namespace crequests {
 
     void response_t::cookies(cookies_t&& cookies) {
         m_pimpl->m_cookies = std::move(cookies);
+        m_pimpl->m_lazy_cookies = false;
+    }
+
+    void response_t::header_block(header_block_t&& header_block) {
+        m_pimpl->m_header_block = std::move(header_block);
+        m_pimpl->m_headers.clear();
+        m_pimpl->m_lazy_headers = true;
+        m_pimpl->m_lazy_cookies = true;
     }
 
 
@@ -256,6 +314,7 @@ namespace crequests {
     }
 
     const headers_t& response_t::headers() const {
+        m_pimpl->materialize_headers();
         return m_pimpl->m_headers;
     }
 
@@ -265,12 +324,24 @@ namespace crequests {
 
     const string_t& response_t::content() const {
         if (m_pimpl->m_content.value().empty() and not m_pimpl->m_raw.empty()) {
-            if (m_pimpl->m_headers.contains("Content-Encoding", "gzip")) {
-                m_pimpl->m_content = content_t(decompress(m_pimpl->m_raw.value()));
-            }
-            else {
+            auto decoder = content_decoder_t::from_encoding(header("Content-Encoding"));
+            if (decoder.empty())
                 return m_pimpl->m_raw.value();
+
+            const auto& raw = m_pimpl->m_raw.value();
+            string_t content;
+            try {
+                decoder.decode(raw.data(), raw.size(), [&content](const char* at, const size_t length) {
+                    content.append(at, length);
+                });
+            }
+            catch (const std::exception& e) {
+                return raw;
             }
+            if (not decoder.finished())
+                return raw;
+
+            m_pimpl->m_content = content_t(std::move(content));
         }
 
         return m_pimpl->m_content.value();
@@ -281,9 +352,14 @@ namespace crequests {
     }
 
     const cookies_t& response_t::cookies() const {
+        m_pimpl->materialize_cookies();
         return m_pimpl->m_cookies;
     }
 
+    const header_block_t& response_t::header_block() const {
+        return m_pimpl->m_header_block;
+    }
+
     request_t& response_t::request() {
         return m_pimpl->m_request;
     }
@@ -313,6 +389,7 @@ namespace crequests {
     }
 
     headers_t& response_t::headers() {
+        m_pimpl->materialize_headers();
         return m_pimpl->m_headers;
     }
 
@@ -321,7 +398,8 @@ namespace crequests {
     }
 
     string_t& response_t::content() {
-        return const_cast<string_t&>(content());
+        const auto& response = *this;
+        return const_cast<string_t&>(response.content());
     }
 
     redirects_t& response_t::redirects() {
@@ -329,9 +407,28 @@ namespace crequests {
     }
 
     cookies_t& response_t::cookies() {
+        m_pimpl->materialize_cookies();
         return m_pimpl->m_cookies;
     }
 
+    bool response_t::has_header(const string_t& name) const {
+        if (m_pimpl->m_lazy_headers)
+            return m_pimpl->m_header_block.count(name) > 0;
+        return m_pimpl->m_headers.count(name) > 0;
+    }
+
+    string_t response_t::header(const string_t& name) const {
+        if (m_pimpl->m_lazy_headers)
+            return m_pimpl->m_header_block.at(name).to_string();
+        return m_pimpl->m_headers.at(name);
+    }
+
+    bool response_t::header_contains(const string_t& name, const string_t& value) const {
+        if (m_pimpl->m_lazy_headers)
+            return m_pimpl->m_header_block.contains(name, value);
+        return m_pimpl->m_headers.contains(name, value);
+    }
+
 
     /****************************************************************************
      * Other functions.
@@ -40,6 +40,7 @@ namespace crequests {
         void content(const content_t& content);
         void redirects(const redirects_t& redirects);
         void cookies(const cookies_t& cookies);
+        void header_block(const header_block_t& header_block);
 
         void request(request_t&& request);
         void http_major(http_major_t&& http_major);
@@ -53,12 +54,18 @@ namespace crequests {
         void content(content_t&& content);
         void redirects(redirects_t&& redirects);
         void cookies(cookies_t&& cookies);
+        void header_block(header_block_t&& header_block);
 
         const request_t& request() const;
         const http_major_t& http_major() const;
         const http_minor_t& http_minor() const;
         const status_code_t& status_code() const;
         const status_message_t& status_message() const;
+
+        /*
+          The body as it was received. Empty when it was decoded, then
+          content() holds it, and when a body_callback_t was given.
+         */
         const raw_t& raw() const;
         const error_t& error() const;
         const headers_t& headers() const;
@@ -66,6 +73,7 @@ namespace crequests {
         const string_t& content() const;
         const redirects_t& redirects() const;
         const cookies_t& cookies() const;
+        const header_block_t& header_block() const;
 
         request_t& request();
         http_major_t& http_major();
@@ -80,6 +88,14 @@ namespace crequests {
         redirects_t& redirects();
         cookies_t& cookies();
 
+        /*
+          Header lookups for the library itself. They read the header
+          block of a lazy_headers response without building headers().
+         */
+        bool has_header(const string_t& name) const;
+        string_t header(const string_t& name) const;
+        bool header_contains(const string_t& name, const string_t& value) const;
+
     private:
         friend class response_impl_t;
         shared_ptr_t<class response_impl_t> m_pimpl;
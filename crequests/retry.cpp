@@ -0,0 +1,174 @@
+#include "response.h"
+#include "retry.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cctype>
+#include <ctime>
+#include <random>
+
+namespace crequests {
+
+
+    namespace {
+
+        using lock_t = std::lock_guard<std::mutex>;
+
+        /*
+          Delays are doubled at most this many times, more would not
+          fit into milliseconds and is capped by max_delay anyway.
+         */
+        constexpr size_t MAX_BACKOFF_SHIFT = 30;
+
+        /*
+          The longest Retry-After in seconds which is read as it is.
+         */
+        constexpr long MAX_RETRY_AFTER = 999999999;
+
+        std::mt19937& random_engine() {
+            thread_local std::mt19937 engine {std::random_device{}()};
+            return engine;
+        }
+
+    } /* anonymous namespace */
+
+
+    /************************************************************
+     * retry_policy_t section.
+     ************************************************************/
+
+
+    bool retry_policy_t::enabled() const {
+        return max_attempts > 1;
+    }
+
+    bool retry_policy_t::is_retryable(const error_code_t& error) const {
+        return std::find(errors.begin(), errors.end(), error) != errors.end();
+    }
+
+    bool retry_policy_t::is_retryable(const unsigned int status_code) const {
+        return std::find(status_codes.begin(), status_codes.end(), status_code) !=
+            status_codes.end();
+    }
+
+    bool retry_policy_t::is_idempotent(const string_t& method) const {
+        return
+            method == "GET" or method == "HEAD" or method == "PUT" or
+            method == "DELETE" or method == "OPTIONS" or method == "TRACE";
+    }
+
+    milliseconds_t retry_policy_t::backoff(const size_t attempt) const {
+        const auto shift = std::min(attempt > 0 ? attempt - 1 : 0, MAX_BACKOFF_SHIFT);
+        const auto ceiling = std::min(base_delay.count() << shift, max_delay.count());
+        if (ceiling <= 0)
+            return milliseconds_t(0);
+
+        std::uniform_int_distribution<milliseconds_t::rep> delay(0, ceiling);
+        return milliseconds_t(delay(random_engine()));
+    }
+
+    std::ostream& operator<<(std::ostream& out, const retry_policy_t& retry_policy) {
+        out << "max_attempts: " << retry_policy.max_attempts
+            << ", base_delay: " << retry_policy.base_delay.count() << "ms"
+            << ", max_delay: " << retry_policy.max_delay.count() << "ms";
+        return out;
+    }
+
+    optional_t<milliseconds_t> retry_after_of(const response_t& response) {
+        if (not response.has_header("Retry-After"))
+            return boost::none;
+
+        const auto value = trim(response.header("Retry-After"));
+        if (value.empty())
+            return boost::none;
+
+        const auto is_digit = [](const unsigned char c) { return std::isdigit(c) != 0; };
+        if (std::all_of(value.begin(), value.end(), is_digit)) {
+            /*
+              Longer delays are clamped rather than dropped, so they are
+              still beyond max_delay and refuse the retry.
+             */
+            const auto seconds = value.size() > 9 ? MAX_RETRY_AFTER : std::stol(value);
+            return milliseconds_t(seconds_t(seconds));
+        }
+
+        const auto time = string_to_time(value, "%a, %d %b %Y %H:%M:%S");
+        if (time == max_time())
+            return boost::none;
+
+        const auto now = now_gmt();
+        return milliseconds_t(seconds_t(time > now ? time - now : 0));
+    }
+
+
+    /************************************************************
+     * retry_budget_t section.
+     ************************************************************/
+
+
+    retry_budget_t::retry_budget_t()
+    {
+
+    }
+
+    retry_budget_t::~retry_budget_t()
+    {
+
+    }
+
+    void retry_budget_t::set_option(const retry_budget_tokens_t& tokens_) {
+        const lock_t lock(mutex);
+        max_tokens = tokens_;
+        tokens.clear();
+    }
+
+    void retry_budget_t::set_option(const retry_budget_ratio_t& ratio_) {
+        const lock_t lock(mutex);
+        ratio = ratio_;
+    }
+
+    bool retry_budget_t::withdraw(const string_t& key) {
+        const lock_t lock(mutex);
+        if (max_tokens.value() == 0) {
+            ++retries_count;
+            return true;
+        }
+
+        auto found = tokens.find(key);
+        const auto max = static_cast<double>(max_tokens.value());
+        if (found == tokens.end())
+            found = tokens.emplace(key, max).first;
+
+        if (found->second <= max / 2) {
+            ++refused_count;
+            return false;
+        }
+
+        found->second -= 1;
+        ++retries_count;
+        return true;
+    }
+
+    void retry_budget_t::deposit(const string_t& key) {
+        const lock_t lock(mutex);
+        const auto found = tokens.find(key);
+        if (found == tokens.end())
+            return;
+
+        found->second += ratio.value();
+        if (found->second >= static_cast<double>(max_tokens.value()))
+            tokens.erase(found);
+    }
+
+    size_t retry_budget_t::retries() const {
+        const lock_t lock(mutex);
+        return retries_count;
+    }
+
+    size_t retry_budget_t::refused() const {
+        const lock_t lock(mutex);
+        return refused_count;
+    }
+
+
+} /* namespace crequests */
@@ -0,0 +1,117 @@
+#ifndef RETRY_H
+#define RETRY_H
+
+#include "error.h"
+#include "macros.h"
+#include "types.h"
+
+#include <mutex>
+
+namespace crequests {
+
+    declare_number(retry_budget_tokens, size_t)
+    declare_number(retry_budget_ratio, double)
+
+    /*
+      When and how a request is sent again. A request is sent at most
+      max_attempts times; the default of one attempt never retries.
+
+      An attempt is retried when it ends with one of errors or with a
+      response of one of status_codes. An attempt which has written
+      anything is only retried for an idempotent method (GET, HEAD,
+      PUT, DELETE, OPTIONS, TRACE) unless retry_non_idempotent is set,
+      and never when its body_source() cannot be read again.
+
+      The delay before attempt n + 1 is taken at random between zero
+      and base_delay * 2^(n - 1), capped at max_delay ("full jitter").
+      A response with Retry-After waits at least as long as it asks; a
+      response which asks for more than max_delay is not retried. No
+      attempt starts after the total timeout of the request.
+     */
+    struct retry_policy_t {
+        size_t max_attempts {1};
+        bool retry_non_idempotent {false};
+        vector_t<error_code_t> errors {
+            error_code_t::RESOLVE_ERROR,
+            error_code_t::CONNECT_ERROR,
+            error_code_t::HANDSHAKE_ERROR,
+            error_code_t::WRITE_ERROR,
+            error_code_t::READ_STATUS_ERROR,
+            error_code_t::TIMEOUT
+        };
+        vector_t<unsigned int> status_codes {429, 502, 503, 504};
+        milliseconds_t base_delay {100};
+        milliseconds_t max_delay {10000};
+        bool retry_after {true};
+
+        bool enabled() const;
+        bool is_retryable(const error_code_t& error) const;
+        bool is_retryable(const unsigned int status_code) const;
+        bool is_idempotent(const string_t& method) const;
+
+        /*
+          A random delay before the attempt after the given one.
+         */
+        milliseconds_t backoff(const size_t attempt) const;
+    };
+
+    std::ostream& operator<<(std::ostream& out, const retry_policy_t& retry_policy);
+
+    /*
+      The delay asked by a Retry-After header, given in seconds or as
+      an HTTP-date. None when the header is absent or not understood.
+      More than 999999999 seconds is clamped to that.
+     */
+    optional_t<milliseconds_t> retry_after_of(const response_t& response);
+
+
+    /*
+      Service wide per host budget of retries, so retries of many
+      requests do not multiply the load of a host which is failing.
+
+      Each host has retry_budget_tokens tokens (10 by default). Every
+      retry takes one token and every successful response of a request
+      with retries enabled gives retry_budget_ratio (0.1) back. Retries
+      are refused while a host has half of its tokens or less. Zero
+      tokens turn the budget off.
+     */
+    class retry_budget_t {
+    public:
+        retry_budget_t();
+        retry_budget_t(const retry_budget_t& budget) = delete;
+        retry_budget_t& operator=(const retry_budget_t& budget) = delete;
+        ~retry_budget_t();
+
+    public:
+        void set_option(const retry_budget_tokens_t& tokens);
+        void set_option(const retry_budget_ratio_t& ratio);
+
+        /*
+          Takes a token of the host for a retry. Returns false when
+          the host has no budget left and the retry must not be made.
+         */
+        bool withdraw(const string_t& key);
+
+        /*
+          Gives a part of a token back for a successful response.
+         */
+        void deposit(const string_t& key);
+
+        /*
+          The number of retries made and refused.
+         */
+        size_t retries() const;
+        size_t refused() const;
+
+    private:
+        mutable std::mutex mutex {};
+        std::unordered_map<string_t, double> tokens {};
+        retry_budget_tokens_t max_tokens {10};
+        retry_budget_ratio_t ratio {0.1};
+        size_t retries_count {0};
+        size_t refused_count {0};
+    };
+
+} /* namespace crequests */
+
+#endif /* RETRY_H */
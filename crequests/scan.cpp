@@ -0,0 +1,141 @@
+#include "scan.h"
+
+#include <cassert>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CREQUESTS_SCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace crequests {
+
+
+    namespace {
+
+        using kernel_t = const char* (*)(const char* chars,
+                                         const bool* table,
+                                         const char* begin,
+                                         const char* end);
+
+        const char* find_scalar_kernel(const char*,
+                                       const bool* table,
+                                       const char* begin,
+                                       const char* end)
+        {
+            for (; begin < end; ++begin) {
+                if (table[static_cast<unsigned char>(*begin)])
+                    return begin;
+            }
+            return end;
+        }
+
+#ifdef CREQUESTS_SCAN_X86
+
+        __attribute__((target("sse2")))
+        const char* find_sse2_kernel(const char* chars,
+                                     const bool* table,
+                                     const char* begin,
+                                     const char* end)
+        {
+            const auto c0 = _mm_set1_epi8(chars[0]);
+            const auto c1 = _mm_set1_epi8(chars[1]);
+            const auto c2 = _mm_set1_epi8(chars[2]);
+            const auto c3 = _mm_set1_epi8(chars[3]);
+
+            while (end - begin >= 16) {
+                const auto data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+                const auto hits = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(data, c0), _mm_cmpeq_epi8(data, c1)),
+                    _mm_or_si128(_mm_cmpeq_epi8(data, c2), _mm_cmpeq_epi8(data, c3)));
+                const auto mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+                if (mask != 0)
+                    return begin + __builtin_ctz(mask);
+                begin += 16;
+            }
+
+            return find_scalar_kernel(chars, table, begin, end);
+        }
+
+        __attribute__((target("avx2")))
+        const char* find_avx2_kernel(const char* chars,
+                                     const bool* table,
+                                     const char* begin,
+                                     const char* end)
+        {
+            const auto c0 = _mm256_set1_epi8(chars[0]);
+            const auto c1 = _mm256_set1_epi8(chars[1]);
+            const auto c2 = _mm256_set1_epi8(chars[2]);
+            const auto c3 = _mm256_set1_epi8(chars[3]);
+
+            while (end - begin >= 32) {
+                const auto data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+                const auto hits = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(data, c0), _mm256_cmpeq_epi8(data, c1)),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(data, c2), _mm256_cmpeq_epi8(data, c3)));
+                const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+                if (mask != 0)
+                    return begin + __builtin_ctz(mask);
+                begin += 32;
+            }
+
+            return find_sse2_kernel(chars, table, begin, end);
+        }
+
+#endif /* CREQUESTS_SCAN_X86 */
+
+        struct kernel_info_t {
+            kernel_t kernel;
+            const char* name;
+        };
+
+        kernel_info_t select_kernel() {
+#ifdef CREQUESTS_SCAN_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return {find_avx2_kernel, "avx2"};
+            if (__builtin_cpu_supports("sse2"))
+                return {find_sse2_kernel, "sse2"};
+#endif
+            return {find_scalar_kernel, "scalar"};
+        }
+
+        const kernel_info_t& get_kernel() {
+            static const kernel_info_t kernel = select_kernel();
+            return kernel;
+        }
+
+    } /* anonymous namespace */
+
+
+    /*
+      Unused slots repeat the first delimiter, so the SIMD kernels
+      always compare with four bytes.
+     */
+    delimiters_t::delimiters_t(const char* chars_)
+        : chars{},
+          table{}
+    {
+        const auto count = std::strlen(chars_);
+        assert(count > 0 and count <= sizeof(chars));
+
+        for (size_t i = 0; i < sizeof(chars); ++i)
+            chars[i] = chars_[i < count ? i : 0];
+        for (size_t i = 0; i < count; ++i)
+            table[static_cast<unsigned char>(chars_[i])] = true;
+    }
+
+    const char* delimiters_t::find(const char* begin, const char* end) const {
+        return get_kernel().kernel(chars, table, begin, end);
+    }
+
+    const char* delimiters_t::find_scalar(const char* begin, const char* end) const {
+        return find_scalar_kernel(chars, table, begin, end);
+    }
+
+    const char* scan_kernel() {
+        return get_kernel().name;
+    }
+
+
+} /* namespace crequests */
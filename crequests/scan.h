@@ -0,0 +1,42 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include "types.h"
+
+namespace crequests {
+
+    /*
+      A set of up to four delimiter bytes, like CR and LF or '&' and
+      '=', and a search for the first of them in a range. The search
+      compares 32 or 16 bytes at a time with AVX2 or SSE2 when the
+      processor has them, which is checked once at runtime, and falls
+      back to a table lookup per byte.
+     */
+    class delimiters_t {
+    public:
+        explicit delimiters_t(const char* chars);
+
+    public:
+        /*
+          The first delimiter in [begin, end), or end.
+         */
+        const char* find(const char* begin, const char* end) const;
+
+        /*
+          The same search without SIMD, for tests and benchmarks.
+         */
+        const char* find_scalar(const char* begin, const char* end) const;
+
+    private:
+        char chars[4];
+        bool table[256];
+    };
+
+    /*
+      Name of the search delimiters_t::find() uses: avx2, sse2 or scalar.
+     */
+    const char* scan_kernel();
+
+} /* namespace crequests */
+
+#endif /* SCAN_H */
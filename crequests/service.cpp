@@ -1,10 +1,20 @@
 #include "boost_asio.h"
 #include "connection.h"
+#include "dns.h"
+#include "http_cache.h"
+#include "pool.h"
 #include "request.h"
+#include "retry.h"
 #include "service.h"
+#include "single_flight.h"
+#include "ssl_context.h"
+#include "ssl_session.h"
+#include "timer_wheel.h"
 
-#include <thread>
+#include <algorithm>
 #include <list>
+#include <mutex>
+#include <thread>
 
 namespace crequests {
 
@@ -12,6 +22,8 @@ namespace crequests {
     namespace {
 
         using thread_t = std::thread;
+        using mutex_t = std::mutex;
+        using lock_t = std::lock_guard<mutex_t>;
 
     } /* anonymous namespace */
 
@@ -23,28 +35,53 @@ namespace crequests {
 
     class service_t::service_data_t {
     public:
+        service_data_t();
         service_data_t(const dispose_timeout_t& dispose_timeout);
         service_data_t(dispose_timeout_t&& dispose_timeout);
         ~service_data_t();
 
     public:
         ioservice_t& get_service();
+        pool_t& get_pool();
+        dns_cache_t& get_dns();
+        ssl_context_cache_t& get_ssl_contexts();
+        ssl_session_cache_t& get_ssl_sessions();
+        timer_wheel_t& get_timers();
+        http_cache_t& get_http_cache();
+        single_flight_t& get_single_flight();
+        retry_budget_t& get_retry_budget();
         session_t& add_session(const session_t& session);
         void set_dispose_timer();
         void on_dispose_timer(const ec_t& ec);
         void start();
         void run();
 
+        void set_option(const dispose_timeout_t& dispose_timeout);
+        void set_option(const threads_count_t& threads_count);
+
     private:
         ioservice_t ioservice {};
         work_ptr_t work { std::make_shared<work_t>(ioservice) };
         strand_t strand { ioservice };
         timer__t dispose_timer { ioservice };
+        mutex_t sessions_mutex {};
         std::list<session_t> sessions {};
-        std::unique_ptr<std::thread> thread {};
+        vector_t<thread_t> threads {};
         dispose_timeout_t dispose_timeout { 1 };
+        threads_count_t threads_count { 1 };
+        pool_t pool {};
+        ssl_context_cache_t ssl_contexts {};
+        ssl_session_cache_t ssl_sessions {};
+        dns_cache_t dns { ioservice };
+        timer_wheel_t timers { ioservice };
+        http_cache_t http_cache {};
+        single_flight_t single_flight {};
+        retry_budget_t retry_budget {};
     };
 
+    service_t::service_data_t::service_data_t()
+    {}
+
     service_t::service_data_t::service_data_t(const dispose_timeout_t& dispose_timeout_)
         : dispose_timeout(dispose_timeout_)
     {}
@@ -57,14 +94,23 @@ namespace crequests {
         work.reset();
         ioservice.stop();
 
-        if (thread and thread->joinable())
-            thread->join();
+        for (auto& thread : threads)
+            if (thread.joinable())
+                thread.join();
     }
 
+    /*
+      All worker threads share one io_service. Every connection serializes
+      its own handlers through a strand, so different connections are
+      processed in parallel while a single connection never is.
+     */
     void service_t::service_data_t::start() {
-        thread.reset(new thread_t([this](){
-            ioservice.run();
-        }));
+        const auto count = std::max<size_t>(threads_count.value(), 1);
+        threads.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+            threads.emplace_back([this](){
+                ioservice.run();
+            });
 
         set_dispose_timer();
     }
@@ -77,11 +123,52 @@ namespace crequests {
         return ioservice;
     }
 
+    pool_t& service_t::service_data_t::get_pool() {
+        return pool;
+    }
+
+    dns_cache_t& service_t::service_data_t::get_dns() {
+        return dns;
+    }
+
+    ssl_context_cache_t& service_t::service_data_t::get_ssl_contexts() {
+        return ssl_contexts;
+    }
+
+    ssl_session_cache_t& service_t::service_data_t::get_ssl_sessions() {
+        return ssl_sessions;
+    }
+
+    timer_wheel_t& service_t::service_data_t::get_timers() {
+        return timers;
+    }
+
+    http_cache_t& service_t::service_data_t::get_http_cache() {
+        return http_cache;
+    }
+
+    single_flight_t& service_t::service_data_t::get_single_flight() {
+        return single_flight;
+    }
+
+    retry_budget_t& service_t::service_data_t::get_retry_budget() {
+        return retry_budget;
+    }
+
     session_t& service_t::service_data_t::add_session(const session_t& session) {
+        const lock_t lock(sessions_mutex);
         sessions.push_back(session);
         return sessions.back();
     }
 
+    void service_t::service_data_t::set_option(const dispose_timeout_t& dispose_timeout_) {
+        dispose_timeout = dispose_timeout_;
+    }
+
+    void service_t::service_data_t::set_option(const threads_count_t& threads_count_) {
+        threads_count = threads_count_;
+    }
+
     void service_t::service_data_t::set_dispose_timer() {
         dispose_timer.expires_from_now(
             seconds_t{ dispose_timeout.value() });
@@ -95,6 +182,7 @@ namespace crequests {
         if (ec)
             return;
 
+        const lock_t lock(sessions_mutex);
         auto it = sessions.cbegin();
         while (it != sessions.cend()) {
             if (it->is_expired()) {
@@ -107,6 +195,7 @@ namespace crequests {
             }
         }
 
+        pool.reap();
         set_dispose_timer();
     }
 
@@ -125,7 +214,7 @@ namespace crequests {
     service_t::service_t(const dispose_timeout_t& dispose_timeout)
         : data(std::make_shared<service_data_t>(dispose_timeout))
     {
-        data->start();
+        start();
     }
 
     service_t::service_t(const service_t& service)
@@ -165,13 +254,145 @@ namespace crequests {
         return data->get_service();
     }
 
+    pool_t& service_t::get_pool() {
+        return data->get_pool();
+    }
+
+    dns_cache_t& service_t::get_dns() {
+        return data->get_dns();
+    }
+
+    ssl_context_cache_t& service_t::get_ssl_contexts() {
+        return data->get_ssl_contexts();
+    }
+
+    ssl_session_cache_t& service_t::get_ssl_sessions() {
+        return data->get_ssl_sessions();
+    }
+
+    timer_wheel_t& service_t::get_timers() {
+        return data->get_timers();
+    }
+
+    http_cache_t& service_t::get_http_cache() {
+        return data->get_http_cache();
+    }
+
+    single_flight_t& service_t::get_single_flight() {
+        return data->get_single_flight();
+    }
+
+    retry_budget_t& service_t::get_retry_budget() {
+        return data->get_retry_budget();
+    }
+
     session_t& service_t::new_session() {
         return data->add_session(session_t(*this));
     }
 
+    batch_t service_t::new_batch() {
+        return batch_t(*this);
+    }
+
+    batch_t service_t::new_batch(const batch_deadline_t& deadline) {
+        return batch_t(*this, deadline);
+    }
+
     void service_t::run() {
         data->run();
     }
 
+    shared_ptr_t<service_t::service_data_t> service_t::create_data() {
+        return std::make_shared<service_data_t>();
+    }
+
+    void service_t::start() {
+        data->start();
+    }
+
+    void service_t::apply_option(const dispose_timeout_t& dispose_timeout) {
+        data->set_option(dispose_timeout);
+    }
+
+    void service_t::apply_option(const threads_count_t& threads_count) {
+        data->set_option(threads_count);
+    }
+
+    void service_t::apply_option(const pool_max_idle_per_host_t& max_idle_per_host) {
+        data->get_pool().set_option(max_idle_per_host);
+    }
+
+    void service_t::apply_option(const pool_max_total_t& max_total) {
+        data->get_pool().set_option(max_total);
+    }
+
+    void service_t::apply_option(const pool_idle_timeout_t& idle_timeout) {
+        data->get_pool().set_option(idle_timeout);
+    }
+
+    void service_t::apply_option(const ssl_session_cache_size_t& max_size) {
+        data->get_ssl_sessions().set_option(max_size);
+    }
+
+    void service_t::apply_option(const dns_ttl_t& ttl) {
+        data->get_dns().set_option(ttl);
+    }
+
+    void service_t::apply_option(const dns_negative_ttl_t& negative_ttl) {
+        data->get_dns().set_option(negative_ttl);
+    }
+
+    void service_t::apply_option(const dns_cache_size_t& max_size) {
+        data->get_dns().set_option(max_size);
+    }
+
+    void service_t::apply_option(const dns_overrides_t& overrides) {
+        data->get_dns().set_option(overrides);
+    }
+
+    void service_t::apply_option(const dns_builtin_t& builtin) {
+        data->get_dns().set_option(builtin);
+    }
+
+    void service_t::apply_option(const dns_resolv_conf_t& resolv_conf) {
+        data->get_dns().set_option(resolv_conf);
+    }
+
+    void service_t::apply_option(const dns_hosts_file_t& hosts_file) {
+        data->get_dns().set_option(hosts_file);
+    }
+
+    void service_t::apply_option(const dns_nameservers_t& nameservers) {
+        data->get_dns().set_option(nameservers);
+    }
+
+    void service_t::apply_option(const timer_tick_t& tick) {
+        data->get_timers().set_option(tick);
+    }
+
+    void service_t::apply_option(const http_cache_size_t& max_size) {
+        data->get_http_cache().set_option(max_size);
+    }
+
+    void service_t::apply_option(const coalesce_t& coalesce) {
+        data->get_single_flight().set_option(coalesce);
+    }
+
+    void service_t::apply_option(const coalesce_headers_t& headers) {
+        data->get_single_flight().set_option(headers);
+    }
+
+    void service_t::apply_option(const coalesce_key_t& key) {
+        data->get_single_flight().set_option(key);
+    }
+
+    void service_t::apply_option(const retry_budget_tokens_t& tokens) {
+        data->get_retry_budget().set_option(tokens);
+    }
+
+    void service_t::apply_option(const retry_budget_ratio_t& ratio) {
+        data->get_retry_budget().set_option(ratio);
+    }
+
 
 } /* namespace crequests */
@@ -1,14 +1,26 @@
 #ifndef SERVICE_H
 #define SERVICE_H
 
+#include "batch.h"
 #include "boost_asio_fwd.h"
+#include "dns.h"
+#include "http_cache.h"
 #include "macros.h"
+#include "pool.h"
+#include "retry.h"
 #include "session.h"
+#include "single_flight.h"
+#include "ssl_context.h"
+#include "ssl_session.h"
+#include "timer_wheel.h"
 #include "types.h"
 
+#include <type_traits>
+
 namespace crequests {
 
     declare_number(dispose_timeout, size_t)
+    declare_number(threads_count, size_t)
 
     class service_t {
     public:
@@ -20,8 +32,32 @@ namespace crequests {
         service_t& operator=(service_t&& service);
         ~service_t();
 
+        /*
+          Creates a service configured by an arbitrary set of service
+          options (dispose_timeout_t, threads_count_t, pool_max_total_t,
+          ...). Options are applied before any worker thread is started.
+         */
+        template <class Head, class... Tail,
+                  class = typename std::enable_if<
+                      not std::is_same<typename std::decay<Head>::type,
+                                       service_t>::value>::type>
+        explicit service_t(Head&& head, Tail&&... tail)
+            : data(create_data())
+        {
+            configure(std::forward<Head>(head), std::forward<Tail>(tail)...);
+            start();
+        }
+
     public:
         ioservice_t& get_service();
+        pool_t& get_pool();
+        dns_cache_t& get_dns();
+        ssl_context_cache_t& get_ssl_contexts();
+        ssl_session_cache_t& get_ssl_sessions();
+        timer_wheel_t& get_timers();
+        http_cache_t& get_http_cache();
+        single_flight_t& get_single_flight();
+        retry_budget_t& get_retry_budget();
         void run();
 
         template <class... Args>
@@ -33,8 +69,52 @@ namespace crequests {
 
         session_t& new_session();
 
+        /*
+          A batch of requests whose responses are taken in the order
+          they finish, see batch.h.
+         */
+        batch_t new_batch();
+        batch_t new_batch(const batch_deadline_t& deadline);
+
     private:
         class service_data_t;
+        static shared_ptr_t<service_data_t> create_data();
+        void start();
+
+        template <class Head>
+        void configure(Head&& head) {
+            apply_option(std::forward<Head>(head));
+        }
+
+        template <class Head, class... Tail>
+        void configure(Head&& head, Tail&&... tail) {
+            configure(std::forward<Head>(head));
+            configure(std::forward<Tail>(tail)...);
+        }
+
+        void apply_option(const dispose_timeout_t& dispose_timeout);
+        void apply_option(const threads_count_t& threads_count);
+        void apply_option(const pool_max_idle_per_host_t& max_idle_per_host);
+        void apply_option(const pool_max_total_t& max_total);
+        void apply_option(const pool_idle_timeout_t& idle_timeout);
+        void apply_option(const ssl_session_cache_size_t& max_size);
+        void apply_option(const dns_ttl_t& ttl);
+        void apply_option(const dns_negative_ttl_t& negative_ttl);
+        void apply_option(const dns_cache_size_t& max_size);
+        void apply_option(const dns_overrides_t& overrides);
+        void apply_option(const dns_builtin_t& builtin);
+        void apply_option(const dns_resolv_conf_t& resolv_conf);
+        void apply_option(const dns_hosts_file_t& hosts_file);
+        void apply_option(const dns_nameservers_t& nameservers);
+        void apply_option(const timer_tick_t& tick);
+        void apply_option(const http_cache_size_t& max_size);
+        void apply_option(const coalesce_t& coalesce);
+        void apply_option(const coalesce_headers_t& headers);
+        void apply_option(const coalesce_key_t& key);
+        void apply_option(const retry_budget_tokens_t& tokens);
+        void apply_option(const retry_budget_ratio_t& ratio);
+
+    private:
         shared_ptr_t<class service_data_t> data;
     };
 
@@ -1,7 +1,12 @@
+#include "awaitable.h"
+#include "boost_asio.h"
 #include "connection.h"
 #include "service.h"
 #include "session.h"
 
+#include <chrono>
+#include <stdexcept>
+
 namespace crequests {
 
 
@@ -36,6 +41,17 @@ namespace crequests {
     public:
         asyncresponse_t Send();
 
+        /*
+          Sends the request and moves the response into the handler,
+          without a promise and without keeping the connection. Returns
+          the connection when one was made. A cancelable request may
+          join an exchange in flight but never leads one, since stopping
+          it would fail the requests joined to it.
+         */
+        optional_t<connection_t> Send(completion_handler_t handler, const bool cancelable);
+
+        const request_t& get_request() const;
+
         void set_option(const string_t& url);
         void set_option(const url_t& url);
         void set_option(const protocol_t& protocol);
@@ -47,6 +63,11 @@ namespace crequests {
         void set_option(const method_t& method);
         void set_option(const timeout_t& timeout);
         void set_option(const store_timeout_t& store_timeout);
+        void set_option(const connect_timeout_t& connect_timeout);
+        void set_option(const handshake_timeout_t& handshake_timeout);
+        void set_option(const first_byte_timeout_t& first_byte_timeout);
+        void set_option(const read_timeout_t& read_timeout);
+        void set_option(const total_timeout_t& total_timeout);
         void set_option(const redirect_t& redirect);
         void set_option(const redirect_count_t& redirect_count);
         void set_option(const gzip_t& gzip);
@@ -66,6 +87,12 @@ namespace crequests {
         void set_option(const verify_filename_t& verify_filename);
         void set_option(const certificate_file_t& certificate_file);
         void set_option(const private_key_file_t& private_key_file);
+        void set_option(const lazy_headers_t& lazy_headers);
+        void set_option(const body_source_t& body_source);
+        void set_option(const compress_min_size_t& compress_min_size);
+        void set_option(const compress_level_t& compress_level);
+        void set_option(const compress_encoding_t& compress_encoding);
+        void set_option(const retry_policy_t& retry_policy);
 
         void set_option(string_t&& url);
         void set_option(url_t&& url);
@@ -78,6 +105,11 @@ namespace crequests {
         void set_option(method_t&& method);
         void set_option(timeout_t&& timeout);
         void set_option(store_timeout_t&& store_timeout);
+        void set_option(connect_timeout_t&& connect_timeout);
+        void set_option(handshake_timeout_t&& handshake_timeout);
+        void set_option(first_byte_timeout_t&& first_byte_timeout);
+        void set_option(read_timeout_t&& read_timeout);
+        void set_option(total_timeout_t&& total_timeout);
         void set_option(redirect_t&& redirect);
         void set_option(redirect_count_t&& redirect_count);
         void set_option(gzip_t&& gzip);
@@ -97,14 +129,44 @@ namespace crequests {
         void set_option(verify_filename_t&& verify_filename);
         void set_option(certificate_file_t&& certificate_file);
         void set_option(private_key_file_t&& private_key_file);
+        void set_option(lazy_headers_t&& lazy_headers);
+        void set_option(body_source_t&& body_source);
+        void set_option(compress_min_size_t&& compress_min_size);
+        void set_option(compress_level_t&& compress_level);
+        void set_option(compress_encoding_t&& compress_encoding);
+        void set_option(retry_policy_t&& retry_policy);
 
         bool is_expired() const;
         void skip_redirects(const response_t& response);
 
+        /*
+          Prepares the request to be sent. Returns true when the last
+          connection of the session can be reused, its cookies are
+          taken into the request then.
+         */
+        bool prepare();
+
+        /*
+          Gives a fresh response of the service cache back without
+          a connection. The final callback is still called on a
+          service thread.
+         */
+        asyncresponse_t serve_cached(response_t&& response);
+
+        /*
+          Answers the request with a response the session made no
+          connection for: a cache hit or an exchange in flight.
+         */
+        asyncresponse_t borrow(const future_t<response_t>& future);
+
     private:
+        using steady_clock_t = std::chrono::steady_clock;
+
         service_t& service;
         request_t request {};
         connection_t* connection {nullptr};
+        optional_t<future_t<response_t> > borrowed {};
+        steady_clock_t::time_point borrowed_at {};
     };
 
 
@@ -172,6 +234,26 @@ namespace crequests {
         request.store_timeout(store_timeout);
     }
 
+    void session_impl_t::set_option(const connect_timeout_t& connect_timeout) {
+        request.connect_timeout(connect_timeout);
+    }
+
+    void session_impl_t::set_option(const handshake_timeout_t& handshake_timeout) {
+        request.handshake_timeout(handshake_timeout);
+    }
+
+    void session_impl_t::set_option(const first_byte_timeout_t& first_byte_timeout) {
+        request.first_byte_timeout(first_byte_timeout);
+    }
+
+    void session_impl_t::set_option(const read_timeout_t& read_timeout) {
+        request.read_timeout(read_timeout);
+    }
+
+    void session_impl_t::set_option(const total_timeout_t& total_timeout) {
+        request.total_timeout(total_timeout);
+    }
+
     void session_impl_t::set_option(const redirect_t& redirect) {
         request.redirect(redirect);
     }
@@ -248,6 +330,30 @@ namespace crequests {
         request.private_key_file(private_key_file);
     }
 
+    void session_impl_t::set_option(const lazy_headers_t& lazy_headers) {
+        request.lazy_headers(lazy_headers);
+    }
+
+    void session_impl_t::set_option(const body_source_t& body_source) {
+        request.body_source(body_source);
+    }
+
+    void session_impl_t::set_option(const compress_min_size_t& compress_min_size) {
+        request.compress_min_size(compress_min_size);
+    }
+
+    void session_impl_t::set_option(const compress_level_t& compress_level) {
+        request.compress_level(compress_level);
+    }
+
+    void session_impl_t::set_option(const compress_encoding_t& compress_encoding) {
+        request.compress_encoding(compress_encoding);
+    }
+
+    void session_impl_t::set_option(const retry_policy_t& retry_policy) {
+        request.retry_policy(retry_policy);
+    }
+
 
     /****************************************************************************
      * Set. Rvalue reference.
@@ -298,6 +404,26 @@ namespace crequests {
         request.store_timeout(std::move(store_timeout));
     }
 
+    void session_impl_t::set_option(connect_timeout_t&& connect_timeout) {
+        request.connect_timeout(std::move(connect_timeout));
+    }
+
+    void session_impl_t::set_option(handshake_timeout_t&& handshake_timeout) {
+        request.handshake_timeout(std::move(handshake_timeout));
+    }
+
+    void session_impl_t::set_option(first_byte_timeout_t&& first_byte_timeout) {
+        request.first_byte_timeout(std::move(first_byte_timeout));
+    }
+
+    void session_impl_t::set_option(read_timeout_t&& read_timeout) {
+        request.read_timeout(std::move(read_timeout));
+    }
+
+    void session_impl_t::set_option(total_timeout_t&& total_timeout) {
+        request.total_timeout(std::move(total_timeout));
+    }
+
     void session_impl_t::set_option(redirect_t&& redirect) {
         request.redirect(std::move(redirect));
     }
@@ -374,36 +500,169 @@ namespace crequests {
         request.private_key_file(std::move(private_key_file));
     }
 
+    void session_impl_t::set_option(lazy_headers_t&& lazy_headers) {
+        request.lazy_headers(std::move(lazy_headers));
+    }
+
+    void session_impl_t::set_option(body_source_t&& body_source) {
+        request.body_source(std::move(body_source));
+    }
+
+    void session_impl_t::set_option(compress_min_size_t&& compress_min_size) {
+        request.compress_min_size(std::move(compress_min_size));
+    }
+
+    void session_impl_t::set_option(compress_level_t&& compress_level) {
+        request.compress_level(std::move(compress_level));
+    }
+
+    void session_impl_t::set_option(compress_encoding_t&& compress_encoding) {
+        request.compress_encoding(std::move(compress_encoding));
+    }
+
+    void session_impl_t::set_option(retry_policy_t&& retry_policy) {
+        request.retry_policy(std::move(retry_policy));
+    }
+
 
     /****************************************************************************
      * Other functions.
      ***************************************************************************/
 
 
-    asyncresponse_t session_impl_t::Send() {
+    bool session_impl_t::prepare() {
         if (connection and request.cache_redirects())
             skip_redirects(connection->get().get());
         else
             request.prepare();
 
-        if (not connection or
-            not can_reuse_connection(request, connection->get().get().request()))
-        {
-            connection = new connection_t(service, request);
-        }
-        else
-        {
+        const bool is_reused = connection and
+            can_reuse_connection(request, connection->get().get().request());
+        if (is_reused) {
             auto cookies = request.cookies();
             cookies.update(connection->get().get().cookies());
             request.cookies(cookies);
-            connection = new connection_t(service, request, *connection);
         }
+        return is_reused;
+    }
 
-        connection->start();
+    asyncresponse_t session_impl_t::Send() {
+        const bool is_reused = prepare();
+
+        auto& cache = service.get_http_cache();
+        auto found = cache.lookup(request);
+        if (found.fresh)
+            return serve_cached(std::move(*found.fresh));
+
+        auto& flights = service.get_single_flight();
+        const auto flight = flights.enabled() ? flights.key(request) : string_t();
+        if (not flight.empty()) {
+            const auto joined = flights.join(flight, request.final_callback());
+            if (joined)
+                return borrow(*joined);
+        }
+        borrowed = boost::none;
+
+        optional_t<request_t> conditional {};
+        if (found.stale)
+            conditional = http_cache_t::conditional(request, *found.stale);
+        const auto& sent = conditional ? *conditional : request;
+
+        /*
+          The flight is ended here when the connection cannot be made,
+          e.g. for TLS files which do not load.
+         */
+        try {
+            if (is_reused)
+                connection = new connection_t(service, sent, *connection);
+            else
+                connection = new connection_t(service, sent);
+
+            if (found.stale)
+                connection->revalidate(*found.stale);
+            if (not flight.empty())
+                connection->lead(flight);
+            connection->start();
+        }
+        catch (...) {
+            if (not flight.empty())
+                flights.abandon(flight, sent);
+            throw;
+        }
 
         return asyncresponse_t{connection->get()};
     }
 
+    /*
+      The connection is not kept by the session, so nothing of the
+      session may be touched once it is started: the handler can
+      destroy the session on another thread. The returned connection
+      only lets the caller cancel it.
+     */
+    optional_t<connection_t> session_impl_t::Send(completion_handler_t handler,
+                                                  const bool cancelable)
+    {
+        if (not handler)
+            throw std::invalid_argument("empty completion handler");
+
+        prepare();
+
+        auto& cache = service.get_http_cache();
+        auto found = cache.lookup(request);
+        if (found.fresh) {
+            auto response = std::move(*found.fresh);
+            response.request(request);
+            const auto callback = request.final_callback();
+            service.get_service().post([callback, handler, response]() mutable {
+                if (callback)
+                    callback(response);
+                handler(std::move(response));
+            });
+            return boost::none;
+        }
+
+        auto& flights = service.get_single_flight();
+        const auto flight = flights.enabled() ? flights.key(request) : string_t();
+        if (not flight.empty()) {
+            const auto callback = request.final_callback();
+            const auto follow = [callback, handler](const response_t& response) {
+                if (callback)
+                    callback(response);
+                handler(response_t(response));
+            };
+            const auto joined = cancelable
+                ? flights.follow(flight, follow)
+                : flights.join(flight, follow);
+            if (joined)
+                return boost::none;
+        }
+
+        optional_t<request_t> conditional {};
+        if (found.stale)
+            conditional = http_cache_t::conditional(request, *found.stale);
+
+        const auto& sent = conditional ? *conditional : request;
+        const bool leads = not flight.empty() and not cancelable;
+        try {
+            connection_t next(service, sent);
+            if (found.stale)
+                next.revalidate(*found.stale);
+            if (leads)
+                next.lead(flight);
+            next.start(std::move(handler));
+            return optional_t<connection_t>(std::move(next));
+        }
+        catch (...) {
+            if (leads)
+                flights.abandon(flight, sent);
+            throw;
+        }
+    }
+
+    const request_t& session_impl_t::get_request() const {
+        return request;
+    }
+
     void session_impl_t::skip_redirects(const response_t& response) {
         const auto resp = response.redirects().find(request);
         if (resp) {
@@ -414,7 +673,39 @@ namespace crequests {
         }
     }
 
+    asyncresponse_t session_impl_t::serve_cached(response_t&& response) {
+        response.request(request);
+
+        if (request.final_callback()) {
+            const auto callback = request.final_callback();
+            service.get_service().post([callback, response]() {
+                callback(response);
+            });
+        }
+
+        promise_t<response_t> promise;
+        promise.set_value(std::move(response));
+        return borrow(promise.get_future());
+    }
+
+    asyncresponse_t session_impl_t::borrow(const future_t<response_t>& future) {
+        borrowed = future;
+        borrowed_at = steady_clock_t::now();
+        return asyncresponse_t{future};
+    }
+
+    /*
+      A session which was last answered without a connection of its
+      own expires store_timeout after the request, once the response
+      is there.
+     */
     bool session_impl_t::is_expired() const {
+        if (borrowed)
+            return
+                borrowed->wait_for(std::chrono::seconds(0)) == std::future_status::ready and
+                steady_clock_t::now() - borrowed_at >=
+                    std::chrono::seconds(request.store_timeout().value()) and
+                (not connection or connection->is_expired());
         return connection and connection->is_expired();
     }
 
@@ -514,6 +805,26 @@ namespace crequests {
         pimpl->set_option(store_timeout);
     }
 
+    void session_t::set_option(const connect_timeout_t& connect_timeout) {
+        pimpl->set_option(connect_timeout);
+    }
+
+    void session_t::set_option(const handshake_timeout_t& handshake_timeout) {
+        pimpl->set_option(handshake_timeout);
+    }
+
+    void session_t::set_option(const first_byte_timeout_t& first_byte_timeout) {
+        pimpl->set_option(first_byte_timeout);
+    }
+
+    void session_t::set_option(const read_timeout_t& read_timeout) {
+        pimpl->set_option(read_timeout);
+    }
+
+    void session_t::set_option(const total_timeout_t& total_timeout) {
+        pimpl->set_option(total_timeout);
+    }
+
     void session_t::set_option(const redirect_t& redirect) {
         pimpl->set_option(redirect);
     }
@@ -590,6 +901,30 @@ namespace crequests {
         pimpl->set_option(private_key_file);
     }
 
+    void session_t::set_option(const lazy_headers_t& lazy_headers) {
+        pimpl->set_option(lazy_headers);
+    }
+
+    void session_t::set_option(const body_source_t& body_source) {
+        pimpl->set_option(body_source);
+    }
+
+    void session_t::set_option(const compress_min_size_t& compress_min_size) {
+        pimpl->set_option(compress_min_size);
+    }
+
+    void session_t::set_option(const compress_level_t& compress_level) {
+        pimpl->set_option(compress_level);
+    }
+
+    void session_t::set_option(const compress_encoding_t& compress_encoding) {
+        pimpl->set_option(compress_encoding);
+    }
+
+    void session_t::set_option(const retry_policy_t& retry_policy) {
+        pimpl->set_option(retry_policy);
+    }
+
 
     /****************************************************************************
      * Set. Rvalue reference.
@@ -640,6 +975,26 @@ namespace crequests {
         pimpl->set_option(std::move(store_timeout));
     }
 
+    void session_t::set_option(connect_timeout_t&& connect_timeout) {
+        pimpl->set_option(std::move(connect_timeout));
+    }
+
+    void session_t::set_option(handshake_timeout_t&& handshake_timeout) {
+        pimpl->set_option(std::move(handshake_timeout));
+    }
+
+    void session_t::set_option(first_byte_timeout_t&& first_byte_timeout) {
+        pimpl->set_option(std::move(first_byte_timeout));
+    }
+
+    void session_t::set_option(read_timeout_t&& read_timeout) {
+        pimpl->set_option(std::move(read_timeout));
+    }
+
+    void session_t::set_option(total_timeout_t&& total_timeout) {
+        pimpl->set_option(std::move(total_timeout));
+    }
+
     void session_t::set_option(redirect_t&& redirect) {
         pimpl->set_option(std::move(redirect));
     }
@@ -716,6 +1071,30 @@ namespace crequests {
         pimpl->set_option(std::move(private_key_file));
     }
 
+    void session_t::set_option(lazy_headers_t&& lazy_headers) {
+        pimpl->set_option(std::move(lazy_headers));
+    }
+
+    void session_t::set_option(body_source_t&& body_source) {
+        pimpl->set_option(std::move(body_source));
+    }
+
+    void session_t::set_option(compress_min_size_t&& compress_min_size) {
+        pimpl->set_option(std::move(compress_min_size));
+    }
+
+    void session_t::set_option(compress_level_t&& compress_level) {
+        pimpl->set_option(std::move(compress_level));
+    }
+
+    void session_t::set_option(compress_encoding_t&& compress_encoding) {
+        pimpl->set_option(std::move(compress_encoding));
+    }
+
+    void session_t::set_option(retry_policy_t&& retry_policy) {
+        pimpl->set_option(std::move(retry_policy));
+    }
+
 
     /****************************************************************************
      * Http methods.
@@ -756,6 +1135,55 @@ namespace crequests {
         return pimpl->Send();
     }
 
+    void session_t::AsyncGet(completion_handler_t handler) const {
+        pimpl->set_option(method_t {"GET"});
+        AsyncSend(std::move(handler));
+    }
+
+    void session_t::AsyncPost(completion_handler_t handler) const {
+        pimpl->set_option(method_t {"POST"});
+        AsyncSend(std::move(handler));
+    }
+
+    void session_t::AsyncPut(completion_handler_t handler) const {
+        pimpl->set_option(method_t {"PUT"});
+        AsyncSend(std::move(handler));
+    }
+
+    void session_t::AsyncPatch(completion_handler_t handler) const {
+        pimpl->set_option(method_t {"PATCH"});
+        AsyncSend(std::move(handler));
+    }
+
+    void session_t::AsyncDelete(completion_handler_t handler) const {
+        pimpl->set_option(method_t {"DELETE"});
+        AsyncSend(std::move(handler));
+    }
+
+    void session_t::AsyncHead(completion_handler_t handler) const {
+        pimpl->set_option(method_t {"HEAD"});
+        AsyncSend(std::move(handler));
+    }
+
+    void session_t::AsyncSend(completion_handler_t handler) const {
+        Dispatch(std::move(handler), false);
+    }
+
+    optional_t<connection_t> session_t::Dispatch(completion_handler_t handler,
+                                                 const bool cancelable) const
+    {
+        /*
+          The handler may destroy the last owner of the session before
+          the send returns.
+         */
+        const auto impl = pimpl;
+        return impl->Send(std::move(handler), cancelable);
+    }
+
+    const request_t& session_t::get_request() const {
+        return pimpl->get_request();
+    }
+
     response_t session_t::Get() const {
         pimpl->set_option(method_t {"GET"});
         return Send();
@@ -786,6 +1214,34 @@ namespace crequests {
         return Send();
     }
 
+    awaitable_response_t session_t::AwaitGet() const {
+        return awaitable_response_t {*this, method_t {"GET"}};
+    }
+
+    awaitable_response_t session_t::AwaitPost() const {
+        return awaitable_response_t {*this, method_t {"POST"}};
+    }
+
+    awaitable_response_t session_t::AwaitPut() const {
+        return awaitable_response_t {*this, method_t {"PUT"}};
+    }
+
+    awaitable_response_t session_t::AwaitPatch() const {
+        return awaitable_response_t {*this, method_t {"PATCH"}};
+    }
+
+    awaitable_response_t session_t::AwaitDelete() const {
+        return awaitable_response_t {*this, method_t {"DELETE"}};
+    }
+
+    awaitable_response_t session_t::AwaitHead() const {
+        return awaitable_response_t {*this, method_t {"HEAD"}};
+    }
+
+    awaitable_response_t session_t::AwaitSend() const {
+        return awaitable_response_t {*this, method_t {}};
+    }
+
     response_t session_t::Send() const {
         return pimpl->Send().get();
     }
@@ -9,6 +9,9 @@
 
 namespace crequests {
 
+    class awaitable_response_t;
+    class connection_t;
+
     class session_t {
     public:
         session_t(service_t& service);
@@ -27,6 +30,20 @@ namespace crequests {
         asyncresponse_t AsyncHead() const;
         asyncresponse_t AsyncSend() const;
 
+        /*
+          Completion handler versions. The response is moved into the
+          handler on a service thread; no promise or future is made and
+          the connection is not kept for store_timeout after it. An
+          empty handler throws std::invalid_argument.
+         */
+        void AsyncGet(completion_handler_t handler) const;
+        void AsyncPost(completion_handler_t handler) const;
+        void AsyncPut(completion_handler_t handler) const;
+        void AsyncPatch(completion_handler_t handler) const;
+        void AsyncDelete(completion_handler_t handler) const;
+        void AsyncHead(completion_handler_t handler) const;
+        void AsyncSend(completion_handler_t handler) const;
+
         response_t Get() const;
         response_t Post() const;
         response_t Put() const;
@@ -35,6 +52,18 @@ namespace crequests {
         response_t Head() const;
         response_t Send() const;
 
+        /*
+          Awaitable versions for C++20 coroutines, see awaitable.h.
+          The request is sent when the coroutine is suspended.
+         */
+        awaitable_response_t AwaitGet() const;
+        awaitable_response_t AwaitPost() const;
+        awaitable_response_t AwaitPut() const;
+        awaitable_response_t AwaitPatch() const;
+        awaitable_response_t AwaitDelete() const;
+        awaitable_response_t AwaitHead() const;
+        awaitable_response_t AwaitSend() const;
+
         void set_option(const string_t& url);
         void set_option(const url_t& url);
         void set_option(const protocol_t& protocol);
@@ -46,6 +75,11 @@ namespace crequests {
         void set_option(const method_t& method);
         void set_option(const timeout_t& timeout);
         void set_option(const store_timeout_t& store_timeout);
+        void set_option(const connect_timeout_t& connect_timeout);
+        void set_option(const handshake_timeout_t& handshake_timeout);
+        void set_option(const first_byte_timeout_t& first_byte_timeout);
+        void set_option(const read_timeout_t& read_timeout);
+        void set_option(const total_timeout_t& total_timeout);
         void set_option(const redirect_t& redirect);
         void set_option(const redirect_count_t& redirect_count);
         void set_option(const gzip_t& gzip);
@@ -65,6 +99,12 @@ namespace crequests {
         void set_option(const verify_filename_t& verify_filename);
         void set_option(const certificate_file_t& certificate_file);
         void set_option(const private_key_file_t& private_key_file);
+        void set_option(const lazy_headers_t& lazy_headers);
+        void set_option(const body_source_t& body_source);
+        void set_option(const compress_min_size_t& compress_min_size);
+        void set_option(const compress_level_t& compress_level);
+        void set_option(const compress_encoding_t& compress_encoding);
+        void set_option(const retry_policy_t& retry_policy);
 
         void set_option(string_t&& url);
         void set_option(url_t&& url);
@@ -77,6 +117,11 @@ namespace crequests {
         void set_option(method_t&& method);
         void set_option(timeout_t&& timeout);
         void set_option(store_timeout_t&& store_timeout);
+        void set_option(connect_timeout_t&& connect_timeout);
+        void set_option(handshake_timeout_t&& handshake_timeout);
+        void set_option(first_byte_timeout_t&& first_byte_timeout);
+        void set_option(read_timeout_t&& read_timeout);
+        void set_option(total_timeout_t&& total_timeout);
         void set_option(redirect_t&& redirect);
         void set_option(redirect_count_t&& redirect_count);
         void set_option(gzip_t&& gzip);
@@ -96,11 +141,32 @@ namespace crequests {
         void set_option(verify_filename_t&& verify_filename);
         void set_option(certificate_file_t&& certificate_file);
         void set_option(private_key_file_t&& private_key_file);
+        void set_option(lazy_headers_t&& lazy_headers);
+        void set_option(body_source_t&& body_source);
+        void set_option(compress_min_size_t&& compress_min_size);
+        void set_option(compress_level_t&& compress_level);
+        void set_option(compress_encoding_t&& compress_encoding);
+        void set_option(retry_policy_t&& retry_policy);
 
         bool is_expired() const;
 
+    private:
+        /*
+          AsyncSend() with a handler which returns the connection made
+          for the request, if any. A cancelable request does not lead
+          coalesced requests.
+         */
+        optional_t<connection_t> Dispatch(completion_handler_t handler,
+                                          const bool cancelable) const;
+
+        /*
+          The request of the session, as it was sent by the last send.
+         */
+        const request_t& get_request() const;
+
     private:
         friend class session_impl_t;
+        friend class batch_t;
         shared_ptr_t<class session_impl_t> pimpl;
     };
 
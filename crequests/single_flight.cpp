@@ -0,0 +1,148 @@
+#include "single_flight.h"
+#include "utils.h"
+
+namespace crequests {
+
+
+    namespace {
+
+        using lock_t = std::lock_guard<std::mutex>;
+
+    } /* anonymous namespace */
+
+
+    single_flight_t::single_flight_t()
+    {
+
+    }
+
+    single_flight_t::~single_flight_t()
+    {
+
+    }
+
+    void single_flight_t::set_option(const coalesce_t& coalesce) {
+        is_enabled = coalesce.value();
+    }
+
+    void single_flight_t::set_option(const coalesce_headers_t& headers_) {
+        const lock_t lock(mutex);
+        headers.clear();
+        for (const auto& name : split(headers_.value(), ','))
+            if (not trim(name).empty())
+                headers.push_back(trim(name));
+    }
+
+    void single_flight_t::set_option(const coalesce_key_t& key) {
+        const lock_t lock(mutex);
+        custom_key = key;
+    }
+
+    bool single_flight_t::enabled() const {
+        return is_enabled;
+    }
+
+    string_t single_flight_t::key(const request_t& request) const {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (custom_key) {
+            const auto key_of = custom_key;
+            lock.unlock();
+            return key_of(request);
+        }
+
+        const auto& method = request.method().value();
+        if ((method != "GET" and method != "HEAD") or
+            request.body_callback() or not request.body_source().empty())
+            return "";
+
+        const auto& uri = request.uri();
+        auto result =
+            method + " " +
+            uri.protocol().value() + "://" +
+            uri.domain().value() + ":" +
+            uri.port().value() +
+            uri.path().value() + "?" +
+            uri.query().value() + "\n" +
+            request.cookies().get(uri.domain().value(), uri.path().value()).to_string() + "\n" +
+            (request.throw_on_error() ? "throw\n" : "\n");
+
+        for (const auto& name : headers)
+            result.append(name).append(": ").append(request.headers().at(name)).append("\n");
+        return result;
+    }
+
+    optional_t<future_t<response_t> >
+    single_flight_t::join(const string_t& key, const final_callback_t& callback) {
+        const lock_t lock(mutex);
+        const auto it = flights.find(key);
+        if (it == flights.end()) {
+            flights.emplace(key, flight_t{nullptr, future_t<response_t>{}, {}});
+            return boost::none;
+        }
+
+        return add_follower(it->second, callback);
+    }
+
+    optional_t<future_t<response_t> >
+    single_flight_t::follow(const string_t& key, const final_callback_t& callback) {
+        const lock_t lock(mutex);
+        const auto it = flights.find(key);
+        if (it == flights.end())
+            return boost::none;
+
+        return add_follower(it->second, callback);
+    }
+
+    future_t<response_t> single_flight_t::add_follower(flight_t& flight,
+                                                       const final_callback_t& callback)
+    {
+        if (not flight.promise) {
+            flight.promise = std::make_shared<promise_t<response_t> >();
+            flight.future = flight.promise->get_future();
+        }
+        flight.callbacks.push_back(callback);
+        ++joined_count;
+        return flight.future;
+    }
+
+    void single_flight_t::finish(const string_t& key, const response_t& response) {
+        flight_t flight {};
+        {
+            const lock_t lock(mutex);
+            const auto it = flights.find(key);
+            if (it == flights.end())
+                return;
+            flight = std::move(it->second);
+            flights.erase(it);
+        }
+
+        if (not flight.promise)
+            return;
+
+        for (const auto& callback : flight.callbacks)
+            if (callback)
+                callback(response);
+
+        if (response.error() and response.request().throw_on_error())
+            flight.promise->set_exception(std::make_exception_ptr(response.error()));
+        else
+            flight.promise->set_value(response);
+    }
+
+    void single_flight_t::abandon(const string_t& key, const request_t& request) {
+        response_t response {request};
+        response.error(error_t(error_code_t::CONNECT_ERROR, "request was not sent"));
+        finish(key, response);
+    }
+
+    size_t single_flight_t::size() const {
+        const lock_t lock(mutex);
+        return flights.size();
+    }
+
+    size_t single_flight_t::joined() const {
+        return joined_count;
+    }
+
+
+} /* namespace crequests */
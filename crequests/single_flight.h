@@ -0,0 +1,123 @@
+#ifndef SINGLE_FLIGHT_H
+#define SINGLE_FLIGHT_H
+
+#include "macros.h"
+#include "response.h"
+#include "types.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+namespace crequests {
+
+    declare_bool(coalesce)
+    declare_string(coalesce_headers)
+
+    /*
+      Makes the key of a request. Requests with the same key share one
+      exchange, an empty key is never shared.
+     */
+    using coalesce_key_t = std::function<string_t(const request_t& request)>;
+
+    /*
+      Service wide coalescing of identical requests in flight. While a
+      GET or HEAD request is sent, the same requests of other sessions
+      do not make their own connections but wait for its response.
+
+      By default the key is the method, the url, the cookies, the
+      throw_on_error flag and the values of the headers named by
+      coalesce_headers_t (Accept, Accept-Encoding, Accept-Language and
+      Authorization). Requests with a body callback or a body source are
+      not coalesced. coalesce_key_t replaces these rules.
+
+      Joined requests get the response of the request which is sent,
+      made with its timeouts and options. Requests of a batch_t only
+      follow exchanges, as they can be cancelled. Coalescing is off by
+      default.
+     */
+    class single_flight_t {
+    public:
+        single_flight_t();
+        single_flight_t(const single_flight_t& flights) = delete;
+        single_flight_t& operator=(const single_flight_t& flights) = delete;
+        ~single_flight_t();
+
+    public:
+        void set_option(const coalesce_t& coalesce);
+        void set_option(const coalesce_headers_t& headers);
+        void set_option(const coalesce_key_t& key);
+        bool enabled() const;
+
+        /*
+          The key of a prepared request, empty when it is not coalesced.
+         */
+        string_t key(const request_t& request) const;
+
+        /*
+          Joins the request to the exchange in flight with the key.
+          Returns the future of its response, and callback will be
+          called with it. Returns none when there is no such exchange:
+          the caller sends the request and must call finish() with its
+          response.
+         */
+        optional_t<future_t<response_t> > join(const string_t& key,
+                                               const final_callback_t& callback);
+
+        /*
+          Joins the request to the exchange in flight with the key like
+          join(), but returns none without starting an exchange when
+          there is none.
+         */
+        optional_t<future_t<response_t> > follow(const string_t& key,
+                                                 const final_callback_t& callback);
+
+        /*
+          Gives the response to the joined requests and ends the
+          exchange of the key.
+         */
+        void finish(const string_t& key, const response_t& response);
+
+        /*
+          Ends the exchange of a request which could not be sent. The
+          joined requests get a CONNECT_ERROR response instead of
+          waiting forever.
+         */
+        void abandon(const string_t& key, const request_t& request);
+
+        /*
+          The number of exchanges in flight.
+         */
+        size_t size() const;
+
+        /*
+          The number of requests which joined an exchange.
+         */
+        size_t joined() const;
+
+    private:
+        struct flight_t {
+            shared_ptr_t<promise_t<response_t> > promise;
+            future_t<response_t> future;
+            vector_t<final_callback_t> callbacks;
+        };
+
+        /*
+          Adds the callback to the flight and returns its future. Must
+          be called with the mutex locked.
+         */
+        future_t<response_t> add_follower(flight_t& flight, const final_callback_t& callback);
+
+    private:
+        mutable std::mutex mutex {};
+        std::unordered_map<string_t, flight_t> flights {};
+        vector_t<string_t> headers {"Accept", "Accept-Encoding", "Accept-Language", "Authorization"};
+        coalesce_key_t custom_key {};
+        std::atomic<bool> is_enabled {false};
+        std::atomic<size_t> joined_count {0};
+    };
+
+} /* namespace crequests */
+
+#endif /* SINGLE_FLIGHT_H */
@@ -0,0 +1,83 @@
+#include "ssl_context.h"
+#include "stream.h"
+
+#include <sstream>
+
+namespace crequests {
+
+
+    namespace {
+
+        using lock_t = std::lock_guard<std::mutex>;
+
+        template <class T>
+        void add_field(std::ostream& out, const T& value) {
+            out << value.size() << ':' << value << ';';
+        }
+
+    } /* anonymous namespace */
+
+
+    /*
+      Every field is prefixed by its length, so different
+      settings never give the same fingerprint.
+     */
+    string_t ssl_context_fingerprint(const request_t& request) {
+        std::ostringstream out;
+
+        add_field(out, request.ssl_auth().first.value());
+        add_field(out, request.ssl_auth().second.value());
+
+        out << request.ssl_certs().size() << ';';
+        for (const auto& cert : request.ssl_certs())
+            add_field(out, cert.value());
+
+        add_field(out, request.verify_path().value());
+        add_field(out, request.verify_filename().value());
+        add_field(out, request.certificate_file().value());
+        add_field(out, request.private_key_file().value());
+        out << request.always_verify_peer().value();
+
+        return out.str();
+    }
+
+
+    ssl_context_cache_t::ssl_context_cache_t()
+    {
+
+    }
+
+    ssl_context_cache_t::~ssl_context_cache_t()
+    {
+
+    }
+
+    /*
+      The context is created under the lock, so two connections
+      started at the same time never build the same context twice.
+     */
+    ssl_context_ptr_t ssl_context_cache_t::get(const request_t& request) {
+        const auto key = ssl_context_fingerprint(request);
+        const lock_t lock(mutex);
+
+        const auto it = contexts.find(key);
+        if (it != contexts.end())
+            return it->second;
+
+        const auto context = create_ssl_client_context(request);
+        contexts.emplace(key, context);
+        return context;
+    }
+
+    void ssl_context_cache_t::clear() {
+        const lock_t lock(mutex);
+        contexts.clear();
+    }
+
+    size_t ssl_context_cache_t::size() const {
+        const lock_t lock(mutex);
+        return contexts.size();
+    }
+
+
+} /* namespace crequests */
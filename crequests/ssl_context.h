@@ -0,0 +1,51 @@
+#ifndef SSL_CONTEXT_H
+#define SSL_CONTEXT_H
+
+#include "boost_asio_fwd.h"
+#include "types.h"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace crequests {
+
+    /*
+      A string which is the same for two requests exactly when they
+      need the same client SSL context.
+     */
+    string_t ssl_context_fingerprint(const request_t& request);
+
+    /*
+      Service wide storage of client SSL contexts. Building a context
+      rescans the system CA store and parses every in-memory certificate,
+      so it is done once per distinct set of TLS settings of a request
+      (ssl_auth, ssl_certs, verify paths, certificate and key files,
+      always_verify_peer). Contexts are never changed after creation and
+      are shared by all connections with the same settings.
+     */
+    class ssl_context_cache_t {
+    public:
+        ssl_context_cache_t();
+        ssl_context_cache_t(const ssl_context_cache_t& cache) = delete;
+        ssl_context_cache_t& operator=(const ssl_context_cache_t& cache) = delete;
+        ~ssl_context_cache_t();
+
+    public:
+        /*
+          Returns the context for the TLS settings of the request, creating
+          it on the first use. Throws std::runtime_error (like the context
+          creation itself) if a certificate or a key can not be loaded.
+         */
+        ssl_context_ptr_t get(const request_t& request);
+
+        void clear();
+        size_t size() const;
+
+    private:
+        mutable std::mutex mutex {};
+        std::unordered_map<string_t, ssl_context_ptr_t> contexts {};
+    };
+
+} /* namespace crequests */
+
+#endif /* SSL_CONTEXT_H */
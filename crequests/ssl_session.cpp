@@ -0,0 +1,116 @@
+#include "ssl_session.h"
+#include "stream.h"
+
+namespace crequests {
+
+
+    namespace {
+
+        using lock_t = std::lock_guard<std::mutex>;
+
+        bool is_resumable(const ssl_session_ptr_t& session) {
+            if (not session)
+                return false;
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+            return SSL_SESSION_is_resumable(session.get()) == 1;
+#else
+            return true;
+#endif
+        }
+
+    } /* anonymous namespace */
+
+
+    ssl_session_cache_t::ssl_session_cache_t()
+    {
+
+    }
+
+    ssl_session_cache_t::~ssl_session_cache_t()
+    {
+        clear();
+    }
+
+    void ssl_session_cache_t::set_option(const ssl_session_cache_size_t& max_size_) {
+        const lock_t lock(mutex);
+        max_size = max_size_;
+    }
+
+    void ssl_session_cache_t::attach(const string_t& key, stream_t& stream) {
+        if (not stream.is_ssl())
+            return;
+
+        ssl_session_ptr_t session {};
+        {
+            const lock_t lock(mutex);
+            const auto it = entries.find(key);
+            if (it == entries.end() or it->second.context != stream.get_context())
+                return;
+            session = it->second.session;
+        }
+
+        stream.set_session(session);
+    }
+
+    void ssl_session_cache_t::update(const string_t& key, stream_t& stream) {
+        if (not stream.is_ssl())
+            return;
+
+        if (stream.is_session_reused())
+            ++hits_count;
+        else
+            ++misses_count;
+
+        store(key, stream);
+    }
+
+    void ssl_session_cache_t::store(const string_t& key, stream_t& stream) {
+        if (not stream.is_ssl())
+            return;
+
+        const auto session = stream.get_session();
+        if (not is_resumable(session))
+            return;
+
+        const lock_t lock(mutex);
+
+        if (max_size.value() == 0)
+            return;
+
+        if (not entries.count(key) and entries.size() >= max_size.value())
+            evict_oldest();
+
+        entries.erase(key);
+        entries.emplace(key, entry_t{session, stream.get_context(), steady_clock_t::now()});
+    }
+
+    void ssl_session_cache_t::clear() {
+        const lock_t lock(mutex);
+        entries.clear();
+    }
+
+    size_t ssl_session_cache_t::size() const {
+        const lock_t lock(mutex);
+        return entries.size();
+    }
+
+    size_t ssl_session_cache_t::hits() const {
+        return hits_count;
+    }
+
+    size_t ssl_session_cache_t::misses() const {
+        return misses_count;
+    }
+
+    void ssl_session_cache_t::evict_oldest() {
+        auto oldest = entries.begin();
+        for (auto it = entries.begin(); it != entries.end(); ++it)
+            if (it->second.stored < oldest->second.stored)
+                oldest = it;
+
+        if (oldest != entries.end())
+            entries.erase(oldest);
+    }
+
+
+} /* namespace crequests */
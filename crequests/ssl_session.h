@@ -0,0 +1,85 @@
+#ifndef SSL_SESSION_H
+#define SSL_SESSION_H
+
+#include "boost_asio_fwd.h"
+#include "macros.h"
+#include "types.h"
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+struct ssl_session_st;
+
+namespace crequests {
+
+    declare_number(ssl_session_cache_size, size_t)
+
+    class stream_t;
+
+    using ssl_session_ptr_t = shared_ptr_t<ssl_session_st>;
+
+    /*
+      Service wide storage of TLS sessions (session ids or TLS 1.3
+      tickets) keyed by host and port. A session is offered to the server
+      on the next handshake to the same host, so a resumed handshake
+      skips a round trip and the certificate exchange. A session is only
+      offered to streams created with the same SSL context.
+     */
+    class ssl_session_cache_t {
+    public:
+        ssl_session_cache_t();
+        ssl_session_cache_t(const ssl_session_cache_t& cache) = delete;
+        ssl_session_cache_t& operator=(const ssl_session_cache_t& cache) = delete;
+        ~ssl_session_cache_t();
+
+    public:
+        void set_option(const ssl_session_cache_size_t& max_size);
+
+        /*
+          Sets the cached session of the key to the stream before
+          the handshake. Does nothing for plain tcp streams.
+         */
+        void attach(const string_t& key, stream_t& stream);
+
+        /*
+          Called after a successful handshake. Counts a hit if the
+          handshake resumed a session and a miss otherwise, then stores
+          the session of the stream.
+         */
+        void update(const string_t& key, stream_t& stream);
+
+        /*
+          Stores the current session of the stream. TLS 1.3 tickets
+          arrive after the handshake, so the session is stored again
+          when the exchange is over.
+         */
+        void store(const string_t& key, stream_t& stream);
+
+        void clear();
+        size_t size() const;
+        size_t hits() const;
+        size_t misses() const;
+
+    private:
+        using steady_clock_t = std::chrono::steady_clock;
+
+        struct entry_t {
+            ssl_session_ptr_t session;
+            ssl_context_ptr_t context;
+            steady_clock_t::time_point stored;
+        };
+
+        void evict_oldest();
+
+    private:
+        mutable std::mutex mutex {};
+        std::unordered_map<string_t, entry_t> entries {};
+        ssl_session_cache_size_t max_size {100};
+        std::atomic<size_t> hits_count {0};
+        std::atomic<size_t> misses_count {0};
+    };
+
+} /* namespace crequests */
+
+#endif /* SSL_SESSION_H */
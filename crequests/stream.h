@@ -3,11 +3,16 @@
 
 #include "boost_asio.h"
 #include "request.h"
+#include "ssl_context.h"
+#include "ssl_session.h"
 
 #include <openssl/bio.h>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <cerrno>
 #include <iostream>
 
 namespace crequests {
@@ -61,50 +66,65 @@ namespace crequests {
         SSL_CTX_set_cert_store(ctx, x509_store);
     }
 
-    template <class ServiceT>
-    static inline ssl_socket_ptr_t create_ssl_socket_client(
-        ServiceT&& service,
-        const shared_ptr_t<X509>& cert, const shared_ptr_t<EVP_PKEY>& key,
-        const vector_t<shared_ptr_t<X509> >& certs,
-        const always_verify_peer_t& always_verify_peer,
-        const verify_path_t& verify_path,
-        const verify_filename_t& verify_filename,
-        const certificate_file_t& certificate_file,
-        const private_key_file_t& private_key_file,
-        const domain_t& domain)
+    static inline ssl_context_ptr_t create_ssl_client_context(
+        const request_t& request)
     {
-        boost::asio::ssl::context ctx(boost::asio::ssl::context::sslv23_client);
-        ctx.set_verify_mode(boost::asio::ssl::verify_none);
-        ctx.set_default_verify_paths();
-        ctx.set_options(boost::asio::ssl::context::default_workarounds);
+        const ssl_auth_t& ssl_auth = request.ssl_auth();
+        const ssl_certs_t& ssl_certs = request.ssl_certs();
+        const auto ctx = std::make_shared<boost::asio::ssl::context>(
+            boost::asio::ssl::context::sslv23_client);
+
+        ctx->set_verify_mode(boost::asio::ssl::verify_none);
+        ctx->set_default_verify_paths();
+        ctx->set_options(boost::asio::ssl::context::default_workarounds);
+
+        const bool has_ssl_auth =
+            not ssl_auth.first.empty() and not ssl_auth.second.empty();
+
+        if (has_ssl_auth) {
+            const auto cert = NewX509(ssl_auth.first.value());
+            const auto key = NewEVP_PKEY(ssl_auth.second.value());
+            UseCertAndKey(ctx->impl(), cert.get(), key.get());
+        }
 
-        if (cert and key)
-            UseCertAndKey(ctx.impl(), cert.get(), key.get());
+        if (not ssl_certs.empty()) {
+            vector_t<shared_ptr_t<X509> > certs;
+            for (const auto& cert : ssl_certs)
+                certs.push_back(NewX509(cert.value()));
+            UseCACerts(ctx->impl(), certs);
+        }
 
-        if (not certs.empty())
-            UseCACerts(ctx.impl(), certs);
+        if (not request.verify_path().empty())
+            ctx->add_verify_path(request.verify_path().value());
 
-        if (not verify_path.empty())
-            ctx.add_verify_path(verify_path.value());
+        if (not request.verify_filename().empty())
+            ctx->load_verify_file(request.verify_filename().value());
 
-        if (not verify_filename.empty())
-            ctx.load_verify_file(verify_filename.value());
+        if (not request.certificate_file().empty())
+            ctx->use_certificate_file(request.certificate_file().value(),
+                                      boost::asio::ssl::context::pem);
 
-        if (not certificate_file.empty())
-            ctx.use_certificate_file(certificate_file.value(),
-                                     boost::asio::ssl::context::pem);
+        if (not request.private_key_file().empty())
+            ctx->use_private_key_file(request.private_key_file().value(),
+                                      boost::asio::ssl::context::pem);
 
-        if (not private_key_file.empty())
-            ctx.use_private_key_file(private_key_file.value(),
-                                     boost::asio::ssl::context::pem);
+        if (has_ssl_auth or
+            not ssl_certs.empty() or
+            request.always_verify_peer() or
+            not request.verify_path().empty() or
+            not request.verify_filename().empty())
+            ctx->set_verify_mode(boost::asio::ssl::verify_peer);
 
-        if ((cert and key) or
-            not certs.empty() or
-            always_verify_peer or
-            not verify_path.empty() or
-            not verify_filename.empty())
-            ctx.set_verify_mode(boost::asio::ssl::verify_peer);
+        return ctx;
+    }
 
+    template <class ServiceT>
+    static inline ssl_socket_ptr_t create_ssl_socket_client(
+        ServiceT&& service,
+        ssl_context_t& ctx,
+        const always_verify_peer_t& always_verify_peer,
+        const domain_t& domain)
+    {
         const auto socket = std::make_shared<ssl_socket_t>(service, ctx);
 
         if (not domain.empty() and always_verify_peer)
@@ -114,20 +134,27 @@ namespace crequests {
         return socket;
     }
 
-    template <class ServiceT>
-    static inline ssl_socket_ptr_t create_ssl_socket_server(ServiceT&& service)
+    static inline ssl_context_ptr_t create_ssl_server_context()
     {
         constexpr const char* SERVER_CERT_PATH = "cert/server.crt";
         constexpr const char* SERVER_PRIVATE_KEY_PATH = "cert/server.key";
         
-        boost::asio::ssl::context ctx(boost::asio::ssl::context::sslv23_server);
-        ctx.set_verify_mode(boost::asio::ssl::verify_none);
-        ctx.set_default_verify_paths();
-        ctx.set_options(boost::asio::ssl::context::default_workarounds);
+        const auto ctx = std::make_shared<boost::asio::ssl::context>(
+            boost::asio::ssl::context::sslv23_server);
+        ctx->set_verify_mode(boost::asio::ssl::verify_none);
+        ctx->set_default_verify_paths();
+        ctx->set_options(boost::asio::ssl::context::default_workarounds);
+
+        ctx->use_certificate_chain_file(SERVER_CERT_PATH);
+        ctx->use_private_key_file(SERVER_PRIVATE_KEY_PATH, boost::asio::ssl::context::pem);
 
-        ctx.use_certificate_chain_file(SERVER_CERT_PATH);
-        ctx.use_private_key_file(SERVER_PRIVATE_KEY_PATH, boost::asio::ssl::context::pem);
+        return ctx;
+    }
 
+    template <class ServiceT>
+    static inline ssl_socket_ptr_t create_ssl_socket_server(ServiceT&& service,
+                                                            ssl_context_t& ctx)
+    {
         return std::make_shared<ssl_socket_t>(service, ctx);
     }
 
@@ -138,29 +165,20 @@ namespace crequests {
 
     class stream_t {
     public:
+        /*
+          Client stream. The SSL context is taken from the service cache,
+          so connections with the same TLS settings share one context.
+         */
         template <class ServiceT>
-        stream_t(ServiceT&& service, const request_t& request) {
-            const ssl_auth_t& ssl_auth = request.ssl_auth();
-            const ssl_certs_t& ssl_certs = request.ssl_certs();
-            
-            if (not ssl_auth.first.empty() and not ssl_auth.second.empty()) {
-                cert = NewX509(ssl_auth.first.value());
-                key = NewEVP_PKEY(ssl_auth.second.value());
-            }
-
-            if (not ssl_certs.empty())
-                for (const auto& cert_ : ssl_certs)
-                    certs.push_back(NewX509(cert_.value()));
-
+        stream_t(ServiceT&& service,
+                 const request_t& request,
+                 ssl_context_cache_t& contexts)
+        {
             if (request.is_ssl()) {
+                context = contexts.get(request);
                 ssl_socket = create_ssl_socket_client(std::forward<ServiceT>(service),
-                                                      cert, key,
-                                                      certs,
+                                                      *context,
                                                       request.always_verify_peer(),
-                                                      request.verify_path(),
-                                                      request.verify_filename(),
-                                                      request.certificate_file(),
-                                                      request.private_key_file(),
                                                       request.uri().domain());
             } else {
                 tcp_socket = create_tcp_socket(std::forward<ServiceT>(service));
@@ -169,10 +187,17 @@ namespace crequests {
             type = boost::asio::ssl::stream_base::client;
         }
 
+        /*
+          Server stream. All streams of a server must share one context,
+          otherwise the server can not resume TLS sessions of its clients.
+          An empty context gives a plain tcp stream.
+         */
         template <class ServiceT>
-        stream_t(ServiceT&& service, const bool is_ssl) {
-            if (is_ssl)
-                ssl_socket = create_ssl_socket_server(std::forward<ServiceT>(service));
+        stream_t(ServiceT&& service, const ssl_context_ptr_t& server_context) {
+            context = server_context;
+            if (context)
+                ssl_socket = create_ssl_socket_server(std::forward<ServiceT>(service),
+                                                      *context);
             else
                 tcp_socket = create_tcp_socket(std::forward<ServiceT>(service));
             type = boost::asio::ssl::stream_base::server;
@@ -182,6 +207,7 @@ namespace crequests {
             ssl_socket = stream.ssl_socket;
             tcp_socket = stream.tcp_socket;
             type = stream.type;
+            context = std::move(stream.context);
             stream.ssl_socket = nullptr;
             stream.tcp_socket = nullptr;
         }
@@ -189,6 +215,24 @@ namespace crequests {
         stream_t(const stream_t& stream) = default;
         stream_t& operator = (const stream_t& stream) = default;
 
+        /*
+          Moving a stream into another one closes the previous sockets of
+          the destination and leaves the source empty, so an open socket
+          never ends up shared by two streams.
+         */
+        stream_t& operator = (stream_t&& stream) {
+            if (this != &stream) {
+                close();
+                ssl_socket = std::move(stream.ssl_socket);
+                tcp_socket = std::move(stream.tcp_socket);
+                type = stream.type;
+                context = std::move(stream.context);
+                stream.ssl_socket = nullptr;
+                stream.tcp_socket = nullptr;
+            }
+            return *this;
+        }
+
         ~stream_t() {
             close();
         }
@@ -283,6 +327,14 @@ namespace crequests {
                                               std::forward<Args>(args)...);
         }
 
+        template <class... Args>
+        void async_read_some(Args&& ...args) {
+            if (tcp_socket and tcp_socket->is_open())
+                tcp_socket->async_read_some(std::forward<Args>(args)...);
+            else if (ssl_socket and ssl_socket->lowest_layer().is_open())
+                ssl_socket->async_read_some(std::forward<Args>(args)...);
+        }
+
         template <class... Args>
         void async_read(Args&& ...args) {
             if (tcp_socket and tcp_socket->is_open())
@@ -293,6 +345,45 @@ namespace crequests {
                                         std::forward<Args>(args)...);
         }
 
+        /*
+          Sends up to count bytes of a file from offset with sendfile(2),
+          from the page cache to a plain tcp socket without a copy in
+          user space, and moves offset past them. The socket is made
+          non-blocking, so ec is would_block when its send buffer is full.
+         */
+        size_t sendfile_some(const int fd, off_t& offset, const size_t count, ec_t& ec) {
+            ec = ec_t();
+            if (not tcp_socket or not tcp_socket->is_open()) {
+                ec = boost::asio::error::bad_descriptor;
+                return 0;
+            }
+
+            tcp_socket->native_non_blocking(true, ec);
+            if (ec)
+                return 0;
+
+            while (true) {
+                const auto length =
+                    ::sendfile(tcp_socket->native_handle(), fd, &offset, count);
+                if (length >= 0)
+                    return static_cast<size_t>(length);
+                if (errno != EINTR) {
+                    ec = ec_t(errno, boost::asio::error::get_system_category());
+                    return 0;
+                }
+            }
+        }
+
+        /*
+          Calls the callback when the plain tcp socket can be written.
+         */
+        template <class CallbackT>
+        void async_wait_writable(CallbackT&& callback) {
+            if (tcp_socket and tcp_socket->is_open())
+                tcp_socket->async_write_some(boost::asio::null_buffers(),
+                                             std::forward<CallbackT>(callback));
+        }
+
         template <class OptionT>
         void set_option(OptionT&& option) {
             if (tcp_socket and tcp_socket->is_open())
@@ -311,6 +402,33 @@ namespace crequests {
             return option.value();
         }
 
+        bool is_ssl() const {
+            return ssl_socket != nullptr;
+        }
+
+        const ssl_context_ptr_t& get_context() const {
+            return context;
+        }
+
+        ssl_session_ptr_t get_session() {
+            if (not ssl_socket)
+                return nullptr;
+
+            SSL_SESSION* session = SSL_get1_session(ssl_socket->native_handle());
+            if (not session)
+                return nullptr;
+            return ssl_session_ptr_t(session, SSL_SESSION_free);
+        }
+
+        void set_session(const ssl_session_ptr_t& session) {
+            if (ssl_socket and session)
+                SSL_set_session(ssl_socket->native_handle(), session.get());
+        }
+
+        bool is_session_reused() {
+            return ssl_socket and SSL_session_reused(ssl_socket->native_handle());
+        }
+
         bool is_open() {
             if (tcp_socket and tcp_socket->is_open())
                 return true;
@@ -319,14 +437,28 @@ namespace crequests {
             return false;
         }
 
+        /*
+          An idle keep-alive socket must have nothing to read. If the peer
+          has closed it (or sent anything, like an SSL close_notify) it can
+          not be used for the next request anymore.
+         */
+        bool is_alive() {
+            if (not is_open())
+                return false;
+
+            char c {};
+            const auto fd =
+                socket<tcp_socket_t::lowest_layer_type>().native_handle();
+            const auto rv = ::recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+
+            return rv < 0 and (errno == EAGAIN or errno == EWOULDBLOCK);
+        }
+
     private:
         tcp_socket_ptr_t tcp_socket { nullptr };
         ssl_socket_ptr_t ssl_socket { nullptr };
         boost::asio::ssl::stream_base::handshake_type type{};
-
-        shared_ptr_t<X509> cert {};
-        shared_ptr_t<EVP_PKEY> key {};
-        vector_t<shared_ptr_t<X509> > certs {};
+        ssl_context_ptr_t context {};
     };
 
 } /* namespace crequests */
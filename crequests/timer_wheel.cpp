@@ -0,0 +1,335 @@
+#include "boost_asio.h"
+#include "timer_wheel.h"
+
+#include <list>
+#include <mutex>
+
+namespace crequests {
+
+
+    namespace {
+
+        using lock_t = std::lock_guard<std::mutex>;
+        using steady_clock_t = std::chrono::steady_clock;
+        using callback_t = wheel_timer_t::callback_t;
+
+        constexpr size_t SLOTS_COUNT = 512;
+
+    } /* anonymous namespace */
+
+
+    struct timer_entry_t {
+        using position_t = std::list<shared_ptr_t<timer_entry_t> >::iterator;
+
+        callback_t callback {};
+        size_t slot {0};
+        size_t rounds {0};
+        size_t generation {0};
+        bool armed {false};
+        bool due {false};
+        position_t position {};
+    };
+
+    using entry_ptr_t = shared_ptr_t<timer_entry_t>;
+
+
+    /************************************************************
+     * timer_wheel_impl_t section.
+     ************************************************************/
+
+
+    class timer_wheel_impl_t : public std::enable_shared_from_this<timer_wheel_impl_t> {
+    public:
+        timer_wheel_impl_t(ioservice_t& ioservice);
+        timer_wheel_impl_t(const timer_wheel_impl_t& impl) = delete;
+        timer_wheel_impl_t& operator=(const timer_wheel_impl_t& impl) = delete;
+
+    public:
+        void set_option(const timer_tick_t& tick);
+
+        void arm(const entry_ptr_t& entry,
+                 const milliseconds_t& delay,
+                 const callback_t& callback);
+        void cancel(const entry_ptr_t& entry);
+        size_t size() const;
+
+        /*
+          Drops the callbacks of all armed timers, which may own the
+          objects owning those timers, and refuses to arm new ones.
+         */
+        void close();
+
+    private:
+        /*
+          Takes the entry out of its slot. Returns its callback,
+          which must be destroyed without the lock held: it may own
+          the last reference to an object with another wheel timer.
+         */
+        callback_t unlink(const entry_ptr_t& entry);
+
+        void wait_tick();
+        void on_tick(const ec_t& ec);
+        void on_due(const entry_ptr_t& entry, const size_t generation);
+
+    private:
+        mutable std::mutex mutex {};
+        ioservice_t& ioservice;
+        timer__t timer;
+        vector_t<std::list<entry_ptr_t> > slots;
+        std::list<entry_ptr_t> posted {};
+        size_t current_tick {0};
+        size_t count {0};
+        bool running {false};
+        bool closed {false};
+        steady_clock_t::time_point next_tick_time {};
+        timer_tick_t tick {10};
+    };
+
+    timer_wheel_impl_t::timer_wheel_impl_t(ioservice_t& ioservice_)
+        : ioservice(ioservice_),
+          timer(ioservice_),
+          slots(SLOTS_COUNT)
+    {
+
+    }
+
+    void timer_wheel_impl_t::set_option(const timer_tick_t& tick_) {
+        const lock_t lock(mutex);
+        tick = timer_tick_t{std::max<size_t>(tick_.value(), 1)};
+    }
+
+    /*
+      The entry fires on the first tick not earlier than now + delay.
+      Ticks further than the wheel size go around it, counting rounds.
+      An entry without delay is already expired, like an asio timer,
+      and is posted to the service instead of waiting for a tick.
+     */
+    void timer_wheel_impl_t::arm(const entry_ptr_t& entry,
+                                 const milliseconds_t& delay,
+                                 const callback_t& callback)
+    {
+        callback_t previous;
+        const lock_t lock(mutex);
+
+        if (entry->armed)
+            previous = unlink(entry);
+
+        if (closed)
+            return;
+
+        entry->callback = callback;
+        entry->generation++;
+        entry->armed = true;
+
+        if (delay.count() <= 0) {
+            entry->due = true;
+            entry->position = posted.insert(posted.end(), entry);
+            const auto self = shared_from_this();
+            const auto generation = entry->generation;
+            ioservice.post([self, entry, generation]() {
+                self->on_due(entry, generation);
+            });
+            return;
+        }
+
+        const auto now = steady_clock_t::now();
+        const milliseconds_t tick_duration {tick.value()};
+
+        if (not running)
+            next_tick_time = now + tick_duration;
+
+        const auto until_first_tick =
+            std::chrono::duration_cast<milliseconds_t>(next_tick_time - now);
+        const auto rest = delay - until_first_tick;
+        const size_t ticks = rest.count() <= 0
+            ? 1
+            : 1 + static_cast<size_t>(
+                (rest.count() + tick_duration.count() - 1) / tick_duration.count());
+
+        entry->slot = (current_tick + ticks) % SLOTS_COUNT;
+        entry->rounds = (ticks - 1) / SLOTS_COUNT;
+
+        auto& slot = slots[entry->slot];
+        entry->position = slot.insert(slot.end(), entry);
+        count++;
+
+        if (not running) {
+            running = true;
+            wait_tick();
+        }
+    }
+
+    void timer_wheel_impl_t::cancel(const entry_ptr_t& entry) {
+        callback_t previous;
+        const lock_t lock(mutex);
+
+        if (entry->armed)
+            previous = unlink(entry);
+    }
+
+    size_t timer_wheel_impl_t::size() const {
+        const lock_t lock(mutex);
+        return count;
+    }
+
+    void timer_wheel_impl_t::close() {
+        vector_t<callback_t> dropped;
+
+        {
+            const lock_t lock(mutex);
+            closed = true;
+            running = false;
+
+            ec_t ignored;
+            timer.cancel(ignored);
+
+            while (not posted.empty())
+                dropped.push_back(unlink(posted.front()));
+            for (auto& slot : slots)
+                while (not slot.empty())
+                    dropped.push_back(unlink(slot.front()));
+        }
+    }
+
+    callback_t timer_wheel_impl_t::unlink(const entry_ptr_t& entry) {
+        if (entry->due) {
+            posted.erase(entry->position);
+            entry->due = false;
+        }
+        else {
+            slots[entry->slot].erase(entry->position);
+            count--;
+        }
+        entry->armed = false;
+        return std::move(entry->callback);
+    }
+
+    /*
+      A posted expired entry fires unless it was cancelled
+      or armed again in the meantime.
+     */
+    void timer_wheel_impl_t::on_due(const entry_ptr_t& entry, const size_t generation) {
+        callback_t callback;
+
+        {
+            const lock_t lock(mutex);
+            if (not entry->armed or not entry->due or entry->generation != generation)
+                return;
+            callback = unlink(entry);
+        }
+
+        callback(ec_t());
+    }
+
+    void timer_wheel_impl_t::wait_tick() {
+        const auto self = shared_from_this();
+        timer.expires_at(next_tick_time);
+        timer.async_wait([self](const ec_t& ec) {
+            self->on_tick(ec);
+        });
+    }
+
+    /*
+      A late tick processes every slot it has missed,
+      so a busy service delays timers but never loses them.
+     */
+    void timer_wheel_impl_t::on_tick(const ec_t& ec) {
+        if (ec)
+            return;
+
+        vector_t<callback_t> expired;
+
+        {
+            const lock_t lock(mutex);
+            const auto now = steady_clock_t::now();
+            const milliseconds_t tick_duration {tick.value()};
+
+            while (next_tick_time <= now and count > 0) {
+                current_tick++;
+                next_tick_time += tick_duration;
+
+                auto& slot = slots[current_tick % SLOTS_COUNT];
+                auto it = slot.begin();
+                while (it != slot.end()) {
+                    const auto entry = *it;
+                    ++it;
+                    if (entry->rounds > 0) {
+                        entry->rounds--;
+                    }
+                    else {
+                        expired.push_back(unlink(entry));
+                    }
+                }
+            }
+
+            if (count > 0)
+                wait_tick();
+            else
+                running = false;
+        }
+
+        for (const auto& callback : expired)
+            callback(ec_t());
+    }
+
+
+    /************************************************************
+     * timer_wheel_t section.
+     ************************************************************/
+
+
+    timer_wheel_t::timer_wheel_t(ioservice_t& ioservice)
+        : pimpl(std::make_shared<timer_wheel_impl_t>(ioservice))
+    {
+
+    }
+
+    /*
+      Armed callbacks usually own the object which owns their timer,
+      and the timer keeps the wheel alive, so they are dropped here.
+     */
+    timer_wheel_t::~timer_wheel_t()
+    {
+        pimpl->close();
+    }
+
+    void timer_wheel_t::set_option(const timer_tick_t& tick) {
+        pimpl->set_option(tick);
+    }
+
+    size_t timer_wheel_t::size() const {
+        return pimpl->size();
+    }
+
+
+    /************************************************************
+     * wheel_timer_t section.
+     ************************************************************/
+
+
+    wheel_timer_t::wheel_timer_t(timer_wheel_t& wheel_)
+        : wheel(wheel_.pimpl),
+          entry(std::make_shared<timer_entry_t>())
+    {
+
+    }
+
+    wheel_timer_t::~wheel_timer_t()
+    {
+        cancel();
+    }
+
+    void wheel_timer_t::async_wait(const callback_t& callback) {
+        wheel->arm(entry, delay, callback);
+    }
+
+    void wheel_timer_t::cancel() {
+        wheel->cancel(entry);
+    }
+
+    bool wheel_timer_t::is_armed() const {
+        return entry->armed;
+    }
+
+
+} /* namespace crequests */
@@ -0,0 +1,76 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include "boost_asio_fwd.h"
+#include "macros.h"
+#include "types.h"
+
+#include <functional>
+
+namespace crequests {
+
+    declare_number(timer_tick, size_t)
+
+    /*
+      Service wide hashed timing wheel. All wheel timers of a service
+      are driven by one asio timer which ticks every timer_tick
+      milliseconds (10 by default) while any of them is armed. Arming and cancelling a
+      timer is O(1), a timer fires not earlier than asked and at most
+      one tick later.
+     */
+    class timer_wheel_t {
+    public:
+        timer_wheel_t(ioservice_t& ioservice);
+        timer_wheel_t(const timer_wheel_t& wheel) = delete;
+        timer_wheel_t& operator=(const timer_wheel_t& wheel) = delete;
+        ~timer_wheel_t();
+
+    public:
+        void set_option(const timer_tick_t& tick);
+
+        /*
+          Number of armed timers.
+         */
+        size_t size() const;
+
+    private:
+        friend class wheel_timer_t;
+        shared_ptr_t<class timer_wheel_impl_t> pimpl;
+    };
+
+    /*
+      A timer on the service wheel with the interface of an asio timer.
+      The callback is called with an empty error code when the timer
+      expires. Unlike asio, a cancelled (or re-armed) wait is dropped
+      without calling its callback.
+     */
+    class wheel_timer_t {
+    public:
+        using callback_t = std::function<void(const ec_t& ec)>;
+
+    public:
+        wheel_timer_t(timer_wheel_t& wheel);
+        wheel_timer_t(const wheel_timer_t& timer) = delete;
+        wheel_timer_t& operator=(const wheel_timer_t& timer) = delete;
+        ~wheel_timer_t();
+
+    public:
+        template <class Rep, class Period>
+        void expires_from_now(const std::chrono::duration<Rep, Period>& duration) {
+            cancel();
+            delay = std::chrono::duration_cast<milliseconds_t>(duration);
+        }
+
+        void async_wait(const callback_t& callback);
+        void cancel();
+        bool is_armed() const;
+
+    private:
+        shared_ptr_t<class timer_wheel_impl_t> wheel;
+        shared_ptr_t<struct timer_entry_t> entry;
+        milliseconds_t delay {0};
+    };
+
+} /* namespace crequests */
+
+#endif /* TIMER_WHEEL_H */
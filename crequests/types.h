@@ -10,14 +10,17 @@
 #include <vector>
 
 #include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
 
 namespace crequests {
 
     using string_t = std::string;
+    using string_view_t = boost::string_ref;
     template <class T>
     using vector_t = std::vector<T>;
     template <class T> using optional_t = boost::optional<T>;
     using seconds_t = std::chrono::seconds;
+    using milliseconds_t = std::chrono::milliseconds;
     template <class... Args>
     using shared_ptr_t = std::shared_ptr<Args...>;
     template <class T>
@@ -47,6 +50,11 @@ namespace crequests {
     class service_t;
     
     using final_callback_t = std::function<void(const response_t& response)>;
+
+    /*
+      Takes the response of a connection instead of its promise.
+     */
+    using completion_handler_t = std::function<void(response_t&& response)>;
     class error_t;
     using body_callback_t = std::function<void(const char* at,
                                                const size_t length,
@@ -1,13 +1,11 @@
 #include "utils.h"
 #include "boost_asio.h"
+#include "decoder.h"
 
 #include <iomanip>
 #include <ctime>
 #include <iostream>
 #include <sstream>
-#include <boost/iostreams/filtering_streambuf.hpp>
-#include <boost/iostreams/copy.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
 #include <boost/archive/iterators/base64_from_binary.hpp>
 #include <boost/archive/iterators/binary_from_base64.hpp>
 #include <boost/archive/iterators/insert_linebreaks.hpp>
@@ -89,39 +87,26 @@ namespace crequests {
     }
 
     string_t compress(const string_t& value) {
-        using namespace boost::iostreams;
-
-        std::stringstream compressed;
-        std::stringstream origin(value);
-
         try {
-            filtering_streambuf<input> out;
-            out.push(gzip_compressor(gzip_params(gzip::best_compression)));
-            out.push(origin);
-            copy(out, compressed);
+            return encode_content("gzip", value, 9);
         } catch (const std::exception& e) {
             return "";
         }
-
-        return compressed.str();
     }
     
     string_t decompress(const string_t& value) {
-        using namespace boost::iostreams;
-
-        std::stringstream compressed(value);
-        std::stringstream origin;
+        string_t origin;
+        auto decoder = content_decoder_t::from_encoding("gzip");
 
         try {
-            filtering_streambuf<input> in;
-            in.push(gzip_decompressor());
-            in.push(compressed);
-            copy(in, origin);
+            decoder.decode(value.data(), value.size(), [&origin](const char* at, const size_t length) {
+                origin.append(at, length);
+            });
         } catch (const std::exception& e) {
             return value;
         }
 
-        return origin.str();
+        return decoder.finished() ? origin : value;
     }
 
     string_t b64encode(const string_t& value) {
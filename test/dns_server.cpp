@@ -0,0 +1,220 @@
+#include "dns_server.h"
+
+#include <functional>
+#include <memory>
+
+namespace crequests {
+
+    namespace {
+
+        using bytes_t = vector_t<unsigned char>;
+
+        void put16(bytes_t& data, const size_t value) {
+            data.push_back(static_cast<unsigned char>((value >> 8) & 0xFF));
+            data.push_back(static_cast<unsigned char>(value & 0xFF));
+        }
+
+        size_t get16(const bytes_t& data, const size_t pos) {
+            return (data[pos] << 8) | data[pos + 1];
+        }
+
+        class dns_tcp_session_t
+            : public std::enable_shared_from_this<dns_tcp_session_t> {
+        public:
+            using answer_fn_t = std::function<bytes_t(const bytes_t&, const size_t)>;
+
+            dns_tcp_session_t(ioservice_t& io_service, const answer_fn_t& answer_fn_)
+                : socket(io_service),
+                  answer_fn(answer_fn_)
+            {
+
+            }
+
+            void start() {
+                auto self(shared_from_this());
+                boost::asio::async_read(
+                    socket, boost::asio::buffer(length),
+                    [this, self](const ec_t& ec, const size_t) {
+                        if (ec)
+                            return;
+                        query.resize(get16(length, 0));
+                        read_query();
+                    });
+            }
+
+            void read_query() {
+                auto self(shared_from_this());
+                boost::asio::async_read(
+                    socket, boost::asio::buffer(query),
+                    [this, self](const ec_t& ec, const size_t size) {
+                        if (ec)
+                            return;
+                        const auto data = answer_fn(query, size);
+                        put16(answer, data.size());
+                        answer.insert(answer.end(), data.begin(), data.end());
+                        boost::asio::async_write(
+                            socket, boost::asio::buffer(answer),
+                            [self](const ec_t&, const size_t) {});
+                    });
+            }
+
+        public:
+            boost::asio::ip::tcp::socket socket;
+
+        private:
+            answer_fn_t answer_fn;
+            bytes_t length = bytes_t(2);
+            bytes_t query {};
+            bytes_t answer {};
+        };
+
+    } /* anonymous namespace */
+
+    dns_server_t::dns_server_t(const string_t& address, const unsigned short port)
+        : io_service{},
+          socket{io_service,
+                 {boost::asio::ip::address::from_string(address), port}},
+          acceptor{io_service}
+    {
+        const boost::asio::ip::tcp::endpoint endpoint {
+            boost::asio::ip::address::from_string(address), port
+        };
+        acceptor.open(endpoint.protocol());
+        acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+        acceptor.bind(endpoint);
+        acceptor.listen();
+
+        do_receive();
+        do_accept();
+    }
+
+    dns_server_t::~dns_server_t() {
+        stop();
+    }
+
+    void dns_server_t::run() {
+        io_service.run();
+    }
+
+    void dns_server_t::stop() {
+        ec_t ec;
+        socket.close(ec);
+        acceptor.close(ec);
+        io_service.stop();
+    }
+
+    void dns_server_t::add(const string_t& domain, const string_t& address) {
+        names[domain] = address;
+    }
+
+    void dns_server_t::drop(const size_t count) {
+        to_drop = count;
+    }
+
+    void dns_server_t::spoof(const size_t count) {
+        to_spoof = count;
+    }
+
+    void dns_server_t::truncate(const bool value) {
+        is_truncated = value;
+    }
+
+    size_t dns_server_t::udp_queries_count() const {
+        return udp_queries;
+    }
+
+    size_t dns_server_t::tcp_queries_count() const {
+        return tcp_queries;
+    }
+
+    void dns_server_t::do_receive() {
+        socket.async_receive_from(
+            boost::asio::buffer(buffer), sender,
+            [this](const ec_t& ec, const size_t size) {
+                if (ec)
+                    return;
+
+                ++udp_queries;
+                if (to_drop > 0) {
+                    --to_drop;
+                }
+                else {
+                    const auto answer = std::make_shared<bytes_t>(
+                        make_answer(buffer, size, is_truncated));
+                    if (to_spoof > 0 and answer->size() > 13) {
+                        --to_spoof;
+                        (*answer)[13] = (*answer)[13] == 'x' ? 'y' : 'x';
+                    }
+                    socket.async_send_to(boost::asio::buffer(*answer), sender,
+                                         [answer](const ec_t&, const size_t) {});
+                }
+
+                do_receive();
+            });
+    }
+
+    void dns_server_t::do_accept() {
+        const auto answer_fn = [this](const bytes_t& query, const size_t size) {
+            ++tcp_queries;
+            return make_answer(query, size, false);
+        };
+        const auto session = std::make_shared<dns_tcp_session_t>(io_service, answer_fn);
+
+        acceptor.async_accept(session->socket, [this, session](const ec_t& ec) {
+            if (not acceptor.is_open())
+                return;
+
+            if (not ec)
+                session->start();
+
+            do_accept();
+        });
+    }
+
+    dns_server_t::bytes_t dns_server_t::make_answer(const bytes_t& query,
+                                                    const size_t size,
+                                                    const bool truncated)
+    {
+        size_t pos = 12;
+        string_t domain;
+        while (pos < size and query[pos] != 0) {
+            const size_t length = query[pos];
+            if (not domain.empty())
+                domain += '.';
+            domain.append(query.begin() + pos + 1, query.begin() + pos + 1 + length);
+            pos += length + 1;
+        }
+        pos += 1;
+
+        const auto type = get16(query, pos);
+        const auto question_end = pos + 4;
+        const auto it = names.find(domain);
+        const bool has_answer = it != names.end() and type == 1 and not truncated;
+
+        bytes_t answer;
+        put16(answer, get16(query, 0));
+        put16(answer, 0x8180 |
+                      (truncated ? 0x0200 : 0) |
+                      (it == names.end() ? 3 : 0));
+        put16(answer, 1);
+        put16(answer, has_answer ? 1 : 0);
+        put16(answer, 0);
+        put16(answer, 0);
+        answer.insert(answer.end(), query.begin() + 12, query.begin() + question_end);
+
+        if (has_answer) {
+            put16(answer, 0xC00C);
+            put16(answer, 1);
+            put16(answer, 1);
+            put16(answer, 0);
+            put16(answer, 60);
+            put16(answer, 4);
+            const auto bytes =
+                boost::asio::ip::address_v4::from_string(it->second).to_bytes();
+            answer.insert(answer.end(), bytes.begin(), bytes.end());
+        }
+
+        return answer;
+    }
+
+} /* namespace crequests */
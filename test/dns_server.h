@@ -0,0 +1,69 @@
+#ifndef DNS_SERVER_H
+#define DNS_SERVER_H
+
+#include <boost/asio.hpp>
+#include <atomic>
+#include <map>
+#include "../crequests/boost_asio_fwd.h"
+#include "../crequests/types.h"
+
+namespace crequests {
+
+    /*
+      Stand-in DNS server for tests. Answers A queries of the added
+      names over UDP and TCP, NXDOMAIN for unknown names and an empty
+      answer for AAAA queries of known names.
+     */
+    class dns_server_t {
+    public:
+        dns_server_t(const string_t& address, const unsigned short port);
+        ~dns_server_t();
+
+    public:
+        void run();
+        void stop();
+        void add(const string_t& domain, const string_t& address);
+
+        /*
+          Ignores the next count UDP queries to test retries.
+         */
+        void drop(const size_t count);
+
+        /*
+          Answers the next count UDP queries for another name with
+          the id of the query, as a spoofed answer would be.
+         */
+        void spoof(const size_t count);
+
+        /*
+          Sends truncated UDP answers, so clients must repeat over TCP.
+         */
+        void truncate(const bool value);
+
+        size_t udp_queries_count() const;
+        size_t tcp_queries_count() const;
+
+    private:
+        using bytes_t = vector_t<unsigned char>;
+
+        void do_receive();
+        void do_accept();
+        bytes_t make_answer(const bytes_t& query, const size_t size, bool truncated);
+
+    private:
+        ioservice_t io_service;
+        boost::asio::ip::udp::socket socket;
+        boost::asio::ip::tcp::acceptor acceptor;
+        boost::asio::ip::udp::endpoint sender {};
+        bytes_t buffer = bytes_t(512);
+        std::map<string_t, string_t> names {};
+        std::atomic<size_t> to_drop {0};
+        std::atomic<size_t> to_spoof {0};
+        std::atomic<bool> is_truncated {false};
+        std::atomic<size_t> udp_queries {0};
+        std::atomic<size_t> tcp_queries {0};
+    };
+    
+} /* namespace crequests */
+
+#endif /* DNS_SERVER_H */
@@ -0,0 +1,22 @@
+#ifndef MAKE_REQUEST_H
+#define MAKE_REQUEST_H
+
+#include "../crequests/request.h"
+
+namespace crequests {
+
+    /*
+      A prepared request of the method for the url, for tests which
+      work on requests without sending them.
+     */
+    inline request_t make_request(const string_t& url, const string_t& method = "GET") {
+        request_t request;
+        request.url(url_t{url});
+        request.method(method_t{method});
+        request.prepare();
+        return request;
+    }
+
+} /* namespace crequests */
+
+#endif /* MAKE_REQUEST_H */
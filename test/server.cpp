@@ -5,6 +5,10 @@
 #include "../crequests/headers.h"
 #include "../crequests/request.h"
 
+#include <zlib.h>
+
+#include <thread>
+
 namespace crequests {
 
     namespace {
@@ -144,6 +148,20 @@ namespace crequests {
                 return out.str();
             }
 
+            string_t keep_alive() {
+                std::ostringstream out;
+
+                const string_t data = "keep_alive";
+                headers.insert("Connection", "keep-alive");
+                headers.insert("Content-Length", std::to_string(data.size()));
+
+                out << "HTTP/1.1 200 OK\r\n";
+                out << headers.to_string();
+                out << data;
+
+                return out.str();
+            }
+
             string_t get_big_content_length() {
                 std::ostringstream out;
 
@@ -244,6 +262,94 @@ namespace crequests {
                 return out.str();
             }
 
+            /*
+              200000 letters, a to z over and over, gzipped and sent
+              in chunks of 1000 bytes.
+             */
+            string_t gzip_chunks() {
+                std::ostringstream out;
+
+                string_t data(200000, 'a');
+                for (size_t i = 0; i < data.size(); ++i)
+                    data[i] = static_cast<char>('a' + i % 26);
+                data = compress(data);
+
+                headers.insert("Content-Encoding", "gzip");
+                headers.insert("Transfer-Encoding", "chunked");
+                out << "HTTP/1.1 200 OK\r\n";
+                out << headers.to_string();
+                for (size_t offset = 0; offset < data.size(); offset += 1000) {
+                    const auto chunk = data.substr(offset, 1000);
+                    out << std::hex << chunk.size() << "\r\n" << chunk << "\r\n";
+                }
+                out << "0\r\n\r\n";
+
+                return out.str();
+            }
+
+            /*
+              The letters of gzip_chunks() deflated with a zlib header.
+             */
+            string_t deflate() {
+                std::ostringstream out;
+
+                string_t data(200000, 'a');
+                for (size_t i = 0; i < data.size(); ++i)
+                    data[i] = static_cast<char>('a' + i % 26);
+
+                auto size = compressBound(data.size());
+                string_t compressed(size, '\0');
+                ::compress(reinterpret_cast<Bytef*>(&compressed[0]), &size,
+                           reinterpret_cast<const Bytef*>(data.data()), data.size());
+                compressed.resize(size);
+
+                headers.insert("Content-Encoding", "deflate");
+                headers.insert("Content-Length", std::to_string(compressed.size()));
+                out << "HTTP/1.1 200 OK\r\n";
+                out << headers.to_string();
+                out << compressed;
+
+                return out.str();
+            }
+
+            /*
+              A body with an ETag. A request which has the ETag in
+              If-None-Match is answered with 304 and X-Validated.
+             */
+            string_t cached(const string_t& cache_control) {
+                std::ostringstream out;
+
+                const string_t data = "cached body";
+                headers.insert("Cache-Control", cache_control);
+                headers.insert("ETag", "\"v1\"");
+                if (request.headers.at("If-None-Match") == "\"v1\"") {
+                    headers.insert("X-Validated", "yes");
+                    out << "HTTP/1.1 304 Not Modified\r\n";
+                    out << headers.to_string();
+                    return out.str();
+                }
+
+                headers.insert("Content-Length", std::to_string(data.size()));
+                out << "HTTP/1.1 200 OK\r\n";
+                out << headers.to_string();
+                out << data;
+
+                return out.str();
+            }
+
+            string_t gzip_broken() {
+                std::ostringstream out;
+
+                const string_t data = "this is not gzipped";
+                headers.insert("Content-Encoding", "gzip");
+                headers.insert("Content-Length", std::to_string(data.size()));
+                out << "HTTP/1.1 200 OK\r\n";
+                out << headers.to_string();
+                out << data;
+
+                return out.str();
+            }
+
             string_t redirect() {
                 std::ostringstream out;
 
@@ -339,6 +445,24 @@ namespace crequests {
                 return out.str();
             }
 
+            /*
+              Size and byte sum of the received body,
+              so tests can check that an upload arrived whole.
+             */
+            string_t upload() {
+                std::ostringstream out;
+
+                const auto data =
+                    std::to_string(upload_size) + " " + std::to_string(upload_sum);
+                headers.insert("Content-Length", std::to_string(data.size()));
+
+                out << "HTTP/1.1 200 OK\r\n";
+                out << headers.to_string();
+                out << data;
+
+                return out.str();
+            }
+
             string_t cookies() {
                 std::ostringstream out;
 
@@ -354,6 +478,8 @@ namespace crequests {
         public:
             headers_t headers {SERVER_DEFAULT_HEADERS};
             server_request_t request {};
+            size_t upload_size {0};
+            size_t upload_sum {0};
         };
 
         class server_session_t
@@ -441,7 +567,96 @@ namespace crequests {
                 request.headers = parse_headers(request_buf);
                 response.request = request;
 
-                write();
+                if (request.uri.path() == "/upload"_path) {
+                    if (request.headers.at("Transfer-Encoding") == "chunked") {
+                        upload_chunked = true;
+                        read_chunk_size();
+                        return;
+                    }
+                    const auto length = request.headers.at("Content-Length");
+                    upload_left = length.empty() ? 0 : std::stoull(length);
+                    take_upload(request_buf.size());
+                    read_upload();
+                }
+                else {
+                    write();
+                }
+            }
+
+            void read_upload() {
+                if (upload_left == 0) {
+                    if (upload_chunked)
+                        read_chunk_size();
+                    else
+                        write();
+                    return;
+                }
+
+                auto self(shared_from_this());
+                auto callback = [this, self](const ec_t& ec, const std::size_t length) {
+                    if (ec)
+                        return;
+                    request_buf.commit(length);
+                    take_upload(length);
+                    read_upload();
+                };
+                stream.async_read_some(request_buf.prepare(65536), callback);
+            }
+
+            /*
+              Reads the line with the size of the next chunk. The line
+              ending the data of the previous chunk is empty and skipped.
+             */
+            void read_chunk_size() {
+                auto self(shared_from_this());
+                auto callback = [this, self](const ec_t& ec, const std::size_t) {
+                    if (ec)
+                        return;
+                    on_read_chunk_size();
+                };
+                stream.async_read_until(request_buf, "\r\n", callback);
+            }
+
+            void on_read_chunk_size() {
+                std::istream request_stream(&request_buf);
+                string_t line;
+                std::getline(request_stream, line);
+                line = trim(line);
+
+                if (line.empty()) {
+                    read_chunk_size();
+                    return;
+                }
+
+                upload_left = std::stoull(line, nullptr, 16);
+                if (upload_left == 0) {
+                    read_last_chunk_end();
+                    return;
+                }
+
+                take_upload(request_buf.size());
+                read_upload();
+            }
+
+            void read_last_chunk_end() {
+                auto self(shared_from_this());
+                auto callback = [this, self](const ec_t& ec, const std::size_t length) {
+                    if (ec)
+                        return;
+                    request_buf.consume(length);
+                    write();
+                };
+                stream.async_read_until(request_buf, "\r\n", callback);
+            }
+
+            void take_upload(const size_t available) {
+                const auto size = std::min<size_t>(available, upload_left);
+                const auto data = boost::asio::buffer_cast<const unsigned char*>(request_buf.data());
+                for (size_t i = 0; i < size; ++i)
+                    response.upload_sum += data[i];
+                response.upload_size += size;
+                upload_left -= size;
+                request_buf.consume(size);
             }
 
             void write() {
@@ -463,6 +678,12 @@ namespace crequests {
                 if (ec) {
                     return;
                 }
+
+                if (request.uri.path() == "/keep_alive"_path) {
+                    request = server_request_t{};
+                    response = server_response_t{};
+                    read_method();
+                }
             }
 
             bool predefined_behaviour(std::ostream& response_stream) {
@@ -502,6 +723,10 @@ namespace crequests {
                     response_stream << response.get_big_content_length();
                     return true;
                 }
+                else if (request.uri.path() == "/keep_alive"_path) {
+                    response_stream << response.keep_alive();
+                    return true;
+                }
                 else if (request.uri.path() == "/get_big_chunks"_path) {
                     response_stream << response.get_big_chunks();
                     return true;
@@ -526,6 +751,26 @@ namespace crequests {
                     response_stream << response.gzip();
                     return true;
                 }
+                else if (request.uri.path() == "/gzip_chunks"_path) {
+                    response_stream << response.gzip_chunks();
+                    return true;
+                }
+                else if (request.uri.path() == "/deflate"_path) {
+                    response_stream << response.deflate();
+                    return true;
+                }
+                else if (request.uri.path() == "/cached"_path) {
+                    response_stream << response.cached("max-age=60");
+                    return true;
+                }
+                else if (request.uri.path() == "/revalidated"_path) {
+                    response_stream << response.cached("no-cache");
+                    return true;
+                }
+                else if (request.uri.path() == "/gzip_broken"_path) {
+                    response_stream << response.gzip_broken();
+                    return true;
+                }
                 else if (request.uri.path().value().find("/redirect") != string_t::npos) {
                     response_stream << response.redirect();
                     return true;
@@ -546,6 +791,10 @@ namespace crequests {
                     response_stream << response.cookies();
                     return true;
                 }
+                else if (request.uri.path() == "/upload"_path) {
+                    response_stream << response.upload();
+                    return true;
+                }
                 else {
                     response_stream << response._404();
                     return true;
@@ -567,6 +816,8 @@ namespace crequests {
             streambuf_t response_buf {};
             server_request_t request {};
             server_response_t response {};
+            size_t upload_left {0};
+            bool upload_chunked {false};
         };
 
     } /* anonymous namespace */
@@ -576,7 +827,7 @@ namespace crequests {
                        bool is_ssl_)
         : io_service{},
           acceptor{io_service},
-          is_ssl{is_ssl_}
+          context{is_ssl_ ? create_ssl_server_context() : nullptr}
     {
         resolver_t resolver{io_service};
         boost::asio::ip::tcp::endpoint endpoint = *resolver.resolve({address, port});
@@ -596,19 +847,30 @@ namespace crequests {
         io_service.run();
     }
 
+    /*
+      The acceptor is closed on the server thread, as an accept
+      handler running there may start the next accept meanwhile.
+     */
     void server_t::stop() {
-        acceptor.close();
-        io_service.stop();
+        io_service.post([this]() {
+            acceptor.close();
+            io_service.stop();
+        });
+    }
+
+    size_t server_t::connections_count() const {
+        return accepted;
     }
 
     void server_t::do_accept() {
-        const auto stream = std::make_shared<stream_t>(io_service, is_ssl);
+        const auto stream = std::make_shared<stream_t>(io_service, context);
         
         const auto callback = [this, stream](ec_t ec) {
             if (not acceptor.is_open())
                 return;
             
             if (not ec) {
+                ++accepted;
                 std::make_shared<server_session_t>(*stream)->start();
             }
             
@@ -2,6 +2,7 @@
 #define SERVER_H
 
 #include <boost/asio.hpp>
+#include <atomic>
 #include "../crequests/boost_asio_fwd.h"
 #include "../crequests/types.h"
 
@@ -18,11 +19,13 @@ namespace crequests {
         void run();
         void stop();
         void do_accept();
+        size_t connections_count() const;
 
     private:
         ioservice_t io_service;
         boost::asio::ip::tcp::acceptor acceptor;
-        bool is_ssl;
+        ssl_context_ptr_t context;
+        std::atomic<size_t> accepted {0};
     };
     
 } /* namespace crequests */
@@ -2,6 +2,15 @@
 #include "server.h"
 #include "gtest/gtest.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <thread>
+
+#include <unistd.h>
+
 using namespace testing;
 using namespace crequests;
 
@@ -98,8 +107,348 @@ TEST(Api, GzipData) {
 
     EXPECT_EQ(response.status_code().value(), 200);
     EXPECT_FALSE(response.error());
-    EXPECT_EQ(response.raw().value().substr(0, 3), "\x1F\x8B\b");
-    EXPECT_EQ(decompress(response.raw().value()), "hello world");
+    EXPECT_EQ(response.raw().value(), "");
+    EXPECT_EQ(response.content(), "hello world");
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Api, GzipContent) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    string_t expected(200000, 'a');
+    for (size_t i = 0; i < expected.size(); ++i)
+        expected[i] = static_cast<char>('a' + i % 26);
+
+    service_t service;
+    const auto response = Get(service, "127.0.0.1:8080/gzip_chunks");
+
+    EXPECT_FALSE(response.error());
+    EXPECT_EQ(response.raw().value(), "");
+    EXPECT_EQ(response.content(), expected);
+
+    string_t decoded;
+    const body_callback_t callback = [&decoded](const char* at, size_t length,
+                                                const crequests::error_t&) {
+        decoded.append(at, length);
+    };
+    const auto streamed = Get(service, "127.0.0.1:8080/gzip_chunks", callback);
+
+    EXPECT_FALSE(streamed.error());
+    EXPECT_EQ(streamed.raw().value(), "");
+    EXPECT_EQ(decoded, expected);
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Api, DeflateContent) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    string_t expected(200000, 'a');
+    for (size_t i = 0; i < expected.size(); ++i)
+        expected[i] = static_cast<char>('a' + i % 26);
+
+    service_t service;
+    const auto response = Get(service, "127.0.0.1:8080/deflate");
+
+    EXPECT_FALSE(response.error());
+    EXPECT_EQ(response.content(), expected);
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Api, GzipBroken) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    service_t service;
+    const auto response = Get(service, "127.0.0.1:8080/gzip_broken");
+
+    EXPECT_EQ(response.error().code(), error_code_t::READ_CONTENT_LENGTH_ERROR);
+    EXPECT_EQ(response.error().message().substr(0, 8), "inflate:");
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Api, HttpCache) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    service_t service{http_cache_size_t{1 << 20}};
+    auto& cache = service.get_http_cache();
+
+    const auto first = Get(service, "127.0.0.1:8080/cached");
+    EXPECT_FALSE(first.error());
+    EXPECT_EQ(first.content(), "cached body");
+    EXPECT_EQ(cache.misses(), 1);
+    EXPECT_EQ(cache.count(), 1);
+
+    server.stop();
+    thread.join();
+
+    /* Fresh for a minute, so the server is not needed. */
+    size_t callbacks = 0;
+    const auto second = Get(service, "127.0.0.1:8080/cached",
+                            final_callback_t{[&callbacks](const response_t&) { ++callbacks; }});
+    EXPECT_FALSE(second.error());
+    EXPECT_EQ(second.status_code().value(), 200);
+    EXPECT_EQ(second.content(), "cached body");
+    EXPECT_EQ(second.header("ETag"), "\"v1\"");
+    EXPECT_EQ(cache.hits(), 1);
+
+    const auto no_store = Get(service, "127.0.0.1:8080/cached",
+                              "Cache-Control: no-store\r\n"_headers, timeout_t{1});
+    EXPECT_TRUE(no_store.error());
+    EXPECT_EQ(cache.hits(), 1);
+
+    std::promise<string_t> handled;
+    CallbackGet(service, [&handled](response_t&& response) {
+        handled.set_value(response.content());
+    }, "127.0.0.1:8080/cached", final_callback_t{});
+    EXPECT_EQ(handled.get_future().get(), "cached body");
+
+    service.get_http_cache().clear();
+    EXPECT_EQ(cache.size(), 0);
+    EXPECT_EQ(callbacks, 1);
+}
+
+TEST(Api, HttpCacheRevalidate) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    service_t service{http_cache_size_t{1 << 20}};
+    auto& cache = service.get_http_cache();
+
+    const auto first = Get(service, "127.0.0.1:8080/revalidated");
+    EXPECT_EQ(first.content(), "cached body");
+    EXPECT_FALSE(first.has_header("X-Validated"));
+
+    const auto second = Get(service, "127.0.0.1:8080/revalidated");
+    EXPECT_FALSE(second.error());
+    EXPECT_EQ(second.status_code().value(), 200);
+    EXPECT_EQ(second.content(), "cached body");
+    EXPECT_EQ(second.header("X-Validated"), "yes");
+    EXPECT_EQ(cache.revalidations(), 1);
+    EXPECT_EQ(cache.hits(), 0);
+
+    /* A conditional request of the caller gets the 304 itself. */
+    const auto own = Get(service, "127.0.0.1:8080/revalidated",
+                         "If-None-Match: \"v1\"\r\n"_headers);
+    EXPECT_EQ(own.status_code().value(), 304);
+    EXPECT_EQ(cache.revalidations(), 1);
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Api, Coalesce) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    service_t service{coalesce_t{true}};
+    std::atomic<size_t> callbacks {0};
+    const final_callback_t callback {[&callbacks](const response_t&) { ++callbacks; }};
+
+    /* The server answers one request at a time, each in a second. */
+    vector_t<asyncresponse_t> responses;
+    for (size_t i = 0; i < 5; ++i)
+        responses.push_back(AsyncGet(service, "127.0.0.1:8080/delay/1", callback));
+
+    for (const auto& response : responses) {
+        EXPECT_FALSE(response.get().error());
+        EXPECT_EQ(response.get().status_code().value(), 200);
+    }
+    EXPECT_EQ(service.get_single_flight().joined(), 4);
+    EXPECT_EQ(service.get_single_flight().size(), 0);
+    EXPECT_EQ(callbacks, 5);
+
+    const auto post = Post(service, "127.0.0.1:8080/upload", "data"_data);
+    EXPECT_EQ(service.get_single_flight().joined(), 4);
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Api, CompletionHandler) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    service_t service;
+    std::atomic<size_t> callbacks {0};
+    const final_callback_t callback {[&callbacks](const response_t&) { ++callbacks; }};
+
+    const size_t count = 10;
+    std::promise<void> done;
+    std::atomic<size_t> handled {0};
+    const auto main_thread = std::this_thread::get_id();
+    for (size_t i = 0; i < count; ++i)
+        CallbackGet(service, [&](response_t&& response) {
+            EXPECT_NE(std::this_thread::get_id(), main_thread);
+            EXPECT_FALSE(response.error());
+            EXPECT_EQ(response.raw().value(), "127.0.0.1");
+            if (++handled == count)
+                done.set_value();
+        }, "127.0.0.1:8080/ip", callback);
+
+    done.get_future().get();
+    EXPECT_EQ(callbacks, count);
+
+    std::promise<string_t> error;
+    auto& session = service.new_session("127.0.0.1:8081/"_url,
+                                        connect_timeout_t{milliseconds_t{500}},
+                                        throw_on_error_t{true});
+    session.AsyncHead([&error](response_t&& response) {
+        error.set_value(response.error().code_to_string());
+    });
+    EXPECT_EQ(error.get_future().get(), "CONNECT_ERROR");
+
+    EXPECT_THROW(session.AsyncGet(completion_handler_t{}), std::invalid_argument);
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Api, PostLargeData) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    string_t data(3 * 1024 * 1024 + 7, 'a');
+    size_t sum = 0;
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<char>('a' + i % 26);
+        sum += static_cast<unsigned char>(data[i]);
+    }
+
+    service_t service;
+    const auto response = Post(service, "127.0.0.1:8080/upload",
+                               data_t{data}, gzip_t{false});
+
+    EXPECT_FALSE(response.error());
+    EXPECT_EQ(response.status_code().value(), 200);
+    EXPECT_EQ(response.raw().value(),
+              std::to_string(data.size()) + " " + std::to_string(sum));
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Api, PostFileBody) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    string_t path = "/tmp/crequests_upload_XXXXXX";
+    const int fd = ::mkstemp(&path[0]);
+    ASSERT_GE(fd, 0);
+
+    const string_t data(1024 * 1024 + 3, 'f');
+    ASSERT_EQ(::write(fd, data.data(), data.size()), static_cast<ssize_t>(data.size()));
+    ::close(fd);
+
+    service_t service;
+    const auto response = Post(service, "127.0.0.1:8080/upload",
+                               body_source_t::from_file(path));
+    std::remove(path.c_str());
+
+    EXPECT_FALSE(response.error());
+    EXPECT_EQ(response.request().headers().at("Content-Length"), std::to_string(data.size()));
+    EXPECT_EQ(response.request().headers().count("Content-Encoding"), 0);
+    EXPECT_EQ(response.raw().value(),
+              std::to_string(data.size()) + " " + std::to_string(data.size() * 'f'));
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Api, PostFileBodySsl) {
+    server_t server{"127.0.0.1", "4433", true};
+    std::thread thread([&server](){server.run();});
+
+    string_t path = "/tmp/crequests_upload_XXXXXX";
+    const int fd = ::mkstemp(&path[0]);
+    ASSERT_GE(fd, 0);
+
+    const string_t data(3 * 1024 * 1024 + 5, 'm');
+    ASSERT_EQ(::write(fd, "skipped", 7), 7);
+    ASSERT_EQ(::write(fd, data.data(), data.size()), static_cast<ssize_t>(data.size()));
+    ::lseek(fd, 7, SEEK_SET);
+
+    service_t service;
+    const auto response = Post(service, "https://127.0.0.1:4433/upload",
+                               body_source_t::from_fd(fd));
+    ::close(fd);
+    std::remove(path.c_str());
+
+    EXPECT_FALSE(response.error());
+    EXPECT_EQ(response.raw().value(),
+              std::to_string(data.size()) + " " + std::to_string(data.size() * 'm'));
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Api, PostChunkedBody) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    const size_t total = 5 * 100000 + 11;
+    size_t sent = 0;
+    size_t sum = 0;
+    const auto reader = [&](char* buffer, const size_t size) {
+        const auto length = std::min<size_t>({size, 100000, total - sent});
+        for (size_t i = 0; i < length; ++i, ++sent) {
+            buffer[i] = static_cast<char>('a' + sent % 26);
+            sum += static_cast<unsigned char>(buffer[i]);
+        }
+        return length;
+    };
+
+    service_t service;
+    const auto response = Post(service, "127.0.0.1:8080/upload",
+                               body_source_t::from_reader(reader));
+
+    EXPECT_FALSE(response.error());
+    EXPECT_EQ(response.request().headers().at("Transfer-Encoding"), "chunked");
+    EXPECT_EQ(response.raw().value(), std::to_string(total) + " " + std::to_string(sum));
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Api, PostBodyErrors) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    service_t service;
+    const auto missing = Post(service, "127.0.0.1:8080/upload",
+                              body_source_t::from_file("/nonexistent/crequests/body"));
+
+    EXPECT_EQ(missing.error().code_to_string(), "WRITE_ERROR");
+
+    const auto short_body = Post(service, "127.0.0.1:8080/upload",
+                                 body_source_t::from_reader(
+                                     [](char*, const size_t) { return size_t(0); }, 10));
+
+    EXPECT_EQ(short_body.error().code_to_string(), "WRITE_ERROR");
+    EXPECT_EQ(short_body.error().message(), "body is shorter than its size");
+
+    bool read = false;
+    const auto redirected = Post(service, "127.0.0.1:8080/redirect/1",
+                                 body_source_t::from_reader(
+                                     [&](char* buffer, const size_t size) {
+                                         const auto length = read ? 0 : std::min<size_t>(size, 4);
+                                         std::fill_n(buffer, length, 'r');
+                                         read = true;
+                                         return length;
+                                     }));
+
+    EXPECT_EQ(redirected.error().code_to_string(), "WRITE_ERROR");
+    EXPECT_EQ(redirected.error().message(), "body cannot be sent again");
 
     server.stop();
     thread.join();
@@ -155,6 +504,102 @@ TEST(Api, Timeout) {
     thread.join();
 }
 
+TEST(Api, TotalTimeout) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    service_t service{timer_tick_t{10}};
+    const auto response = Get(service, "127.0.0.1:8080/delay/1",
+                              total_timeout_t{milliseconds_t{100}});
+
+    EXPECT_EQ(response.error().code_to_string(), "TIMEOUT");
+    EXPECT_EQ(response.error().message(), "timeout");
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Api, FirstByteTimeout) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    service_t service{timer_tick_t{10}};
+    const auto start = std::chrono::steady_clock::now();
+    const auto response = Get(service, "127.0.0.1:8080/delay/1",
+                              connect_timeout_t{milliseconds_t{500}},
+                              first_byte_timeout_t{milliseconds_t{100}});
+
+    EXPECT_EQ(response.error().code_to_string(), "TIMEOUT");
+    EXPECT_EQ(response.error().message(), "first byte timeout");
+    EXPECT_LT(std::chrono::steady_clock::now() - start, milliseconds_t{900});
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Api, PhaseTimeoutDefaultTick) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    service_t service;
+    const auto start = std::chrono::steady_clock::now();
+    const auto response = Get(service, "127.0.0.1:8080/delay/1",
+                              first_byte_timeout_t{milliseconds_t{50}});
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(response.error().message(), "first byte timeout");
+    EXPECT_GE(elapsed, milliseconds_t{50});
+    EXPECT_LT(elapsed, milliseconds_t{90});
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Api, ReadTimeout) {
+    boost::asio::io_service io_service;
+    boost::asio::ip::tcp::acceptor acceptor{
+        io_service, {boost::asio::ip::address::from_string("127.0.0.1"), 8081}};
+    std::thread thread([&acceptor, &io_service](){
+        boost::asio::ip::tcp::socket socket{io_service};
+        acceptor.accept(socket);
+        boost::asio::streambuf request;
+        boost::asio::read_until(socket, request, "\r\n\r\n");
+        boost::asio::write(socket, boost::asio::buffer(
+            string_t{"HTTP/1.1 200 OK\r\nContent-Length: 100\r\n\r\nhead"}));
+        std::this_thread::sleep_for(milliseconds_t{500});
+    });
+
+    service_t service{timer_tick_t{10}};
+    const auto response = Get(service, "127.0.0.1:8081/",
+                              first_byte_timeout_t{milliseconds_t{200}},
+                              read_timeout_t{milliseconds_t{100}});
+
+    EXPECT_EQ(response.error().code_to_string(), "TIMEOUT");
+    EXPECT_EQ(response.error().message(), "read timeout");
+    EXPECT_EQ(response.status_code().value(), 200);
+
+    thread.join();
+}
+
+TEST(Api, PhaseTimeoutsInTime) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    service_t service;
+    const auto response = Get(service, "127.0.0.1:8080/get_content_length",
+                              connect_timeout_t{std::chrono::seconds{1}},
+                              handshake_timeout_t{std::chrono::seconds{1}},
+                              first_byte_timeout_t{std::chrono::seconds{1}},
+                              read_timeout_t{std::chrono::seconds{1}},
+                              total_timeout_t{std::chrono::seconds{2}});
+
+    EXPECT_EQ(response.error().code_to_string(), "SUCCESS");
+    EXPECT_EQ(response.raw().value().size(), 100);
+
+    server.stop();
+    thread.join();
+}
+
 TEST(Api, Query) {
     server_t server{"127.0.0.1", "8080"};
     std::thread thread([&server](){server.run();});
@@ -197,6 +642,35 @@ TEST(Api, Cookies) {
     thread.join();
 }
 
+TEST(Api, LazyHeaders) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    service_t service;
+    const auto response = Get(service, "127.0.0.1:8080/cookies", lazy_headers_t{true});
+
+    EXPECT_FALSE(response.error());
+    EXPECT_EQ(response.header_block().size(), 5);
+    EXPECT_EQ(response.header_block().at("set-cookie"), "cookie2");
+    EXPECT_EQ(response.header("Content-Type"), "text/html; charset=UTF-8");
+    EXPECT_TRUE(response.header_contains("Connection", "close"));
+    EXPECT_EQ(response.header_block().count("Set-Cookie"), 2);
+    EXPECT_EQ(response.headers().count("Set-Cookie"), 2);
+    EXPECT_EQ(response.headers(),
+              "Server: requests-server\r\n"
+              "Content-Type: text/html; charset=UTF-8\r\n"
+              "Connection: close\r\n"
+              "Set-Cookie: cookie1; Expires=Wed, 09 Jun 2021 10:18:14 GMT; HttpOnly\r\n"
+              "Set-Cookie: cookie2\r\n\r\n"_headers);
+
+    const auto redirected = Get(service, "127.0.0.1:8080/redirect/2", lazy_headers_t{true});
+    EXPECT_FALSE(redirected.error());
+    EXPECT_EQ(redirected.redirect_count().value(), 2);
+
+    server.stop();
+    thread.join();
+}
+
 TEST(Api, Session) {
     server_t server{"127.0.0.1", "8080"};
     std::thread thread([&server](){server.run();});
@@ -219,12 +693,13 @@ TEST(Api, Session) {
         EXPECT_EQ(response.request().make_request(),
                   "GET /cookies HTTP/1.1\r\n"
                   "Accept: */*\r\n"
-                  "Accept-Encoding: gzip, deflate\r\n"
+                  "Accept-Encoding: " + DEFAULT_HEADERS.at("Accept-Encoding") + "\r\n"
                   "Connection: keep-alive\r\n"
-                  "Host: 127.0.0.1\r\n"                  
                   "User-Agent: Mozilla/5.0 (X11; Linux x86_64) "
                               "AppleWebKit/537.36 (KHTML, like Gecko) "
-                              "Chrome/47.0.2526.106 Safari/537.36\r\n\r\n");
+                              "Chrome/47.0.2526.106 Safari/537.36\r\n"
+                  "Host: 127.0.0.1\r\n"
+                  "\r\n");
         EXPECT_EQ(response.request().cookies().to_string(), "");
         EXPECT_EQ(response.cookies().to_string(),
                   "cookie1; Expires=Wed, 09 Jun 2021 10:18:14 GMT; HttpOnly\n"
@@ -246,13 +721,14 @@ TEST(Api, Session) {
         EXPECT_EQ(response.request().make_request(),
                   "GET /cookies HTTP/1.1\r\n"
                   "Accept: */*\r\n"
-                  "Accept-Encoding: gzip, deflate\r\n"
+                  "Accept-Encoding: " + DEFAULT_HEADERS.at("Accept-Encoding") + "\r\n"
                   "Connection: keep-alive\r\n"
-                  "Cookies: cookie1; cookie2; \r\n"
-                  "Host: 127.0.0.1\r\n"
                   "User-Agent: Mozilla/5.0 (X11; Linux x86_64) "
                               "AppleWebKit/537.36 (KHTML, like Gecko) "
-                              "Chrome/47.0.2526.106 Safari/537.36\r\n\r\n");
+                              "Chrome/47.0.2526.106 Safari/537.36\r\n"
+                  "Host: 127.0.0.1\r\n"
+                  "Cookies: cookie1; cookie2; \r\n"
+                  "\r\n");
         EXPECT_EQ(response.request().cookies().to_string(),
                   "cookie1; Expires=Wed, 09 Jun 2021 10:18:14 GMT; HttpOnly\n"
                   "cookie2\n\n");
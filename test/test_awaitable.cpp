@@ -0,0 +1,83 @@
+#include "api.h"
+#include "server.h"
+#include "gtest/gtest.h"
+
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <thread>
+
+using namespace testing;
+using namespace crequests;
+
+namespace {
+
+    /*
+      A coroutine which starts at once and is never awaited.
+     */
+    struct task_t {
+        struct promise_type {
+            task_t get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+
+    task_t get_twice(service_t& service, std::promise<vector_t<string_t> >& done) {
+        auto& session = service.new_session();
+        session.set_option("127.0.0.1:8080/ip");
+
+        vector_t<string_t> bodies;
+        const auto first = co_await session.AwaitGet();
+        bodies.push_back(first.raw().value());
+        const auto second = co_await AwaitHead(service, "127.0.0.1:8080/");
+        bodies.push_back(std::to_string(second.status_code().value()));
+        done.set_value(bodies);
+    }
+
+    task_t get_throwing(service_t& service, std::promise<string_t>& done) {
+        try {
+            co_await AwaitGet(service, "127.0.0.1:8080/delay/1",
+                              first_byte_timeout_t{milliseconds_t{100}},
+                              throw_on_error_t{true});
+            done.set_value("no error");
+        }
+        catch (const crequests::error_t& error) {
+            done.set_value(error.code_to_string());
+        }
+    }
+
+} /* anonymous namespace */
+
+TEST(Awaitable, Get) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    service_t service;
+    std::promise<vector_t<string_t> > done;
+    get_twice(service, done);
+
+    const auto bodies = done.get_future().get();
+    ASSERT_EQ(bodies.size(), 2);
+    EXPECT_EQ(bodies[0], "127.0.0.1");
+    EXPECT_EQ(bodies[1], "200");
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Awaitable, ThrowOnError) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    service_t service{timer_tick_t{10}};
+    std::promise<string_t> done;
+    get_throwing(service, done);
+
+    EXPECT_EQ(done.get_future().get(), "TIMEOUT");
+
+    server.stop();
+    thread.join();
+}
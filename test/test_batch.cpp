@@ -0,0 +1,168 @@
+#include "api.h"
+#include "server.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using namespace testing;
+using namespace crequests;
+
+namespace {
+
+    /*
+      Accepts connections on 8081 but never answers them.
+     */
+    class silent_server_t {
+    public:
+        silent_server_t()
+            : io_service(),
+              acceptor{io_service, {boost::asio::ip::address::from_string("127.0.0.1"), 8081}}
+        {
+
+        }
+
+    private:
+        boost::asio::io_service io_service;
+        boost::asio::ip::tcp::acceptor acceptor;
+    };
+
+} /* anonymous namespace */
+
+TEST(Batch, FinishOrderAndDeadline) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+    silent_server_t silent;
+
+    service_t service{timer_tick_t{10}};
+    auto batch = service.new_batch(batch_deadline_t{milliseconds_t{500}});
+    EXPECT_EQ(batch.Get("127.0.0.1:8081/"), 0);
+    for (size_t i = 1; i <= 3; ++i)
+        EXPECT_EQ(batch.Get("127.0.0.1:8080/ip"), i);
+    EXPECT_EQ(batch.size(), 4);
+
+    const auto start = std::chrono::steady_clock::now();
+    vector_t<size_t> order;
+    for (auto& result : batch) {
+        order.push_back(result.index);
+        if (result.index == 0) {
+            EXPECT_EQ(result.response.error().code_to_string(), "CANCELED");
+            EXPECT_EQ(result.response.error().message(), "batch deadline");
+            EXPECT_GE(std::chrono::steady_clock::now() - start, milliseconds_t{400});
+        }
+        else {
+            EXPECT_FALSE(result.response.error());
+            EXPECT_EQ(result.response.raw().value(), "127.0.0.1");
+        }
+    }
+
+    ASSERT_EQ(order.size(), 4);
+    EXPECT_EQ(order.back(), 0);
+    EXPECT_EQ(batch.pending(), 0);
+    EXPECT_FALSE(batch.wait_any());
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Batch, Cancel) {
+    silent_server_t silent;
+
+    service_t service;
+    batch_t batch(service);
+    batch.Head("127.0.0.1:8081/");
+    batch.Post("127.0.0.1:8081/", "data"_data);
+
+    std::this_thread::sleep_for(milliseconds_t{100});
+    EXPECT_FALSE(batch.try_pop());
+    EXPECT_EQ(batch.pending(), 2);
+
+    batch.cancel();
+    for (size_t i = 0; i < 2; ++i) {
+        const auto result = batch.wait_any();
+        ASSERT_TRUE(result);
+        EXPECT_EQ(result->response.error().code_to_string(), "CANCELED");
+        EXPECT_EQ(result->response.error().message(), "canceled");
+    }
+    EXPECT_FALSE(batch.wait_any());
+    EXPECT_FALSE(batch.try_pop());
+}
+
+TEST(Batch, CancelJoined) {
+    silent_server_t silent;
+
+    service_t service{coalesce_t{true}};
+    const auto leader = AsyncGet(service, "127.0.0.1:8081/", timeout_t{1});
+    std::this_thread::sleep_for(milliseconds_t{100});
+
+    batch_t batch(service);
+    batch.Get("127.0.0.1:8081/");
+    EXPECT_EQ(service.get_single_flight().joined(), 1);
+
+    batch.cancel();
+    const auto result = batch.try_pop();
+    ASSERT_TRUE(result);
+    EXPECT_EQ(result->response.error().code_to_string(), "CANCELED");
+    EXPECT_EQ(result->response.request().uri().path().value(), "/");
+    EXPECT_EQ(batch.pending(), 0);
+
+    EXPECT_EQ(leader.get().error().code_to_string(), "TIMEOUT");
+    EXPECT_FALSE(batch.try_pop());
+}
+
+TEST(Batch, MovedFrom) {
+    service_t service;
+    batch_t batch(service);
+    batch_t moved(std::move(batch));
+
+    EXPECT_EQ(batch.size(), 0);
+    EXPECT_EQ(batch.pending(), 0);
+    EXPECT_FALSE(batch.wait_any());
+    EXPECT_FALSE(batch.try_pop());
+    EXPECT_TRUE(batch.begin() == batch.end());
+    EXPECT_THROW(batch.Get("127.0.0.1:8081/"), std::logic_error);
+    batch.cancel();
+}
+
+TEST(Batch, AddThrows) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    service_t service;
+    batch_t batch(service);
+    EXPECT_ANY_THROW(batch.Get("https://127.0.0.1:4433/",
+                               verify_filename_t{"/nonexistent/crequests/ca.pem"}));
+    EXPECT_EQ(batch.size(), 0);
+    EXPECT_FALSE(batch.wait_any());
+
+    EXPECT_EQ(batch.Get("127.0.0.1:8080/ip"), 0);
+    size_t count = 0;
+    for (auto& result : batch) {
+        EXPECT_FALSE(result.response.error());
+        ++count;
+    }
+    EXPECT_EQ(count, 1);
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Batch, CancelDoesNotReachOtherSessions) {
+    silent_server_t silent;
+
+    service_t service{coalesce_t{true}};
+    batch_t batch(service);
+    batch.Get("127.0.0.1:8081/");
+    EXPECT_EQ(service.get_single_flight().size(), 0);
+
+    const auto other = AsyncGet(service, "127.0.0.1:8081/", timeout_t{1});
+    std::this_thread::sleep_for(milliseconds_t{100});
+    EXPECT_EQ(service.get_single_flight().joined(), 0);
+
+    batch.cancel();
+    const auto result = batch.wait_any();
+    ASSERT_TRUE(result);
+    EXPECT_EQ(result->response.error().code_to_string(), "CANCELED");
+    EXPECT_EQ(other.get().error().code_to_string(), "TIMEOUT");
+}
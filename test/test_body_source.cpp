@@ -0,0 +1,149 @@
+#include "body_source.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <system_error>
+
+#include <unistd.h>
+
+using namespace testing;
+using namespace crequests;
+
+namespace {
+
+    /*
+      A temporary file with the given content, removed with the object.
+     */
+    class temp_file_t {
+    public:
+        explicit temp_file_t(const string_t& content)
+            : path("/tmp/crequests_body_XXXXXX"),
+              fd(::mkstemp(&path[0]))
+        {
+            EXPECT_GE(fd, 0);
+            EXPECT_EQ(::write(fd, content.data(), content.size()),
+                      static_cast<ssize_t>(content.size()));
+        }
+
+        temp_file_t(const temp_file_t&) = delete;
+        temp_file_t& operator=(const temp_file_t&) = delete;
+
+        ~temp_file_t() {
+            ::close(fd);
+            std::remove(path.c_str());
+        }
+
+    public:
+        string_t path;
+        int fd;
+    };
+
+    string_t read_all(const body_source_t& body, const size_t part_size = 7) {
+        auto reader = body.open();
+        string_t result;
+        string_t buffer(part_size, '\0');
+        size_t length;
+        while ((length = reader(&buffer[0], buffer.size())) > 0)
+            result.append(buffer, 0, length);
+        return result;
+    }
+
+} /* anonymous namespace */
+
+TEST(BodySource, Empty) {
+    const body_source_t body;
+
+    EXPECT_TRUE(body.empty());
+    EXPECT_FALSE(body.size());
+}
+
+TEST(BodySource, FromFile) {
+    const temp_file_t file("hello, body source");
+    const auto body = body_source_t::from_file(file.path);
+
+    EXPECT_FALSE(body.empty());
+    ASSERT_TRUE(body.size());
+    EXPECT_EQ(*body.size(), 18);
+    EXPECT_EQ(read_all(body), "hello, body source");
+    EXPECT_EQ(read_all(body, 1), "hello, body source");
+}
+
+TEST(BodySource, FromMissingFile) {
+    const auto body = body_source_t::from_file("/nonexistent/crequests/body");
+
+    EXPECT_FALSE(body.empty());
+    EXPECT_FALSE(body.size());
+    EXPECT_THROW(body.open(), std::system_error);
+}
+
+TEST(BodySource, FromFdStartsAtOffset) {
+    const temp_file_t file("skipped|sent");
+    ::lseek(file.fd, 8, SEEK_SET);
+    const auto body = body_source_t::from_fd(file.fd);
+
+    ASSERT_TRUE(body.size());
+    EXPECT_EQ(*body.size(), 4);
+    EXPECT_EQ(read_all(body), "sent");
+    EXPECT_EQ(read_all(body), "sent");
+}
+
+TEST(BodySource, OpenFile) {
+    const temp_file_t file("skipped|sent");
+    ::lseek(file.fd, 8, SEEK_SET);
+
+    const auto from_fd = body_source_t::from_fd(file.fd);
+    ASSERT_TRUE(from_fd.is_file());
+    const auto opened = from_fd.open_file();
+    EXPECT_EQ(*opened.fd, file.fd);
+    EXPECT_EQ(opened.offset, 8);
+    EXPECT_EQ(opened.size, 4);
+
+    const auto from_file = body_source_t::from_file(file.path);
+    ASSERT_TRUE(from_file.is_file());
+    EXPECT_EQ(from_file.open_file().offset, 0);
+    EXPECT_EQ(from_file.open_file().size, 12);
+
+    EXPECT_FALSE(body_source_t().is_file());
+    EXPECT_FALSE(body_source_t::from_file("/nonexistent/crequests/body").is_file());
+    EXPECT_FALSE(body_source_t::from_reader([](char*, const size_t) { return size_t(0); }).is_file());
+}
+
+TEST(BodySource, FromPipe) {
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+    ASSERT_EQ(::write(fds[1], "piped", 5), 5);
+    ::close(fds[1]);
+
+    const auto body = body_source_t::from_fd(fds[0]);
+
+    EXPECT_FALSE(body.size());
+    EXPECT_EQ(read_all(body), "piped");
+    ::close(fds[0]);
+}
+
+TEST(BodySource, FromReader) {
+    size_t left = 10;
+    const auto reader = [&left](char* buffer, const size_t size) {
+        const auto length = std::min(size, left);
+        for (size_t i = 0; i < length; ++i)
+            buffer[i] = 'r';
+        left -= length;
+        return length;
+    };
+
+    EXPECT_FALSE(body_source_t::from_reader(reader).size());
+    EXPECT_EQ(*body_source_t::from_reader(reader, 10).size(), 10);
+    EXPECT_EQ(read_all(body_source_t::from_reader(reader), 3), string_t(10, 'r'));
+}
+
+TEST(BodySource, Output) {
+    std::ostringstream out;
+    out << body_source_t() << " "
+        << body_source_t::from_reader([](char*, const size_t) { return size_t(0); }) << " "
+        << body_source_t::from_reader([](char*, const size_t) { return size_t(0); }, 5);
+
+    EXPECT_EQ(out.str(), "body_source_t(empty) body_source_t(chunked) body_source_t(5)");
+}
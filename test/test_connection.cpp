@@ -264,3 +264,67 @@ TEST(ConnectionBad, ErrorThroughBodyCallback) {
     server.stop();
     thread.join();
 }
+
+TEST(ConnectionGood, ResponseInPieces) {
+    boost::asio::io_service io_service;
+    boost::asio::ip::tcp::acceptor acceptor{
+        io_service, {boost::asio::ip::address::from_string("127.0.0.1"), 8081}};
+    std::thread thread([&acceptor, &io_service](){
+        boost::asio::ip::tcp::socket socket{io_service};
+        acceptor.accept(socket);
+        boost::asio::streambuf request;
+        boost::asio::read_until(socket, request, "\r\n\r\n");
+
+        const string_t data =
+            "HTTP/1.1 200 Very OK\r\n"
+            "Content-Type: text/plain\r\n"
+            "Transfer-Encoding: chunked\r\n"
+            "Connection: close\r\n\r\n"
+            "4\r\nbody\r\n"
+            "5\r\n data\r\n"
+            "0\r\n\r\n";
+        for (size_t i = 0; i < data.size(); i += 3) {
+            boost::asio::write(socket, boost::asio::buffer(data.substr(i, 3)));
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    service_t service;
+    const auto response = Get(service, "127.0.0.1:8081/");
+
+    EXPECT_EQ(response.error().code(), error_code_t::SUCCESS);
+    EXPECT_EQ(response.status_message().value(), "Very OK");
+    EXPECT_EQ(
+        response.headers(),
+        "Content-Type: text/plain\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "Connection: close\r\n\r\n"_headers);
+    EXPECT_EQ(response.raw().value(), "body data");
+
+    thread.join();
+}
+
+TEST(ConnectionBad, HugeContentLength) {
+    boost::asio::io_service io_service;
+    boost::asio::ip::tcp::acceptor acceptor{
+        io_service, {boost::asio::ip::address::from_string("127.0.0.1"), 8081}};
+    std::thread thread([&acceptor, &io_service](){
+        boost::asio::ip::tcp::socket socket{io_service};
+        acceptor.accept(socket);
+        boost::asio::streambuf request;
+        boost::asio::read_until(socket, request, "\r\n\r\n");
+        boost::asio::write(socket, boost::asio::buffer(string_t{
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Length: 4611686018427387904\r\n"
+            "Connection: close\r\n\r\n"
+            "body"}));
+    });
+
+    service_t service;
+    const auto response = Get(service, "127.0.0.1:8081/");
+
+    EXPECT_EQ(response.error().code(), error_code_t::READ_CONTENT_LENGTH_ERROR);
+    EXPECT_EQ(response.raw().value(), "body");
+
+    thread.join();
+}
@@ -0,0 +1,216 @@
+#include "decoder.h"
+#include "utils.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <zlib.h>
+
+using namespace testing;
+using namespace crequests;
+
+namespace {
+
+    string_t letters(const size_t size) {
+        string_t result(size, 'a');
+        for (size_t i = 0; i < size; ++i)
+            result[i] = static_cast<char>('a' + i % 26);
+        return result;
+    }
+
+    /*
+      Decodes data fed in parts of part_size bytes.
+     */
+    string_t decode(content_decoder_t& decoder, const string_t& data, const size_t part_size) {
+        string_t result;
+        for (size_t offset = 0; offset < data.size(); offset += part_size) {
+            const auto length = std::min(part_size, data.size() - offset);
+            decoder.decode(data.data() + offset, length, [&result](const char* at, const size_t size) {
+                EXPECT_LE(size, 16384);
+                result.append(at, size);
+            });
+        }
+        return result;
+    }
+
+    /*
+      zlib framed data with window_bits 15, raw deflate data with -15.
+     */
+    string_t deflate(const string_t& data, const int window_bits) {
+        z_stream stream {};
+        EXPECT_EQ(deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED,
+                               window_bits, 8, Z_DEFAULT_STRATEGY), Z_OK);
+
+        string_t result(deflateBound(&stream, data.size()), '\0');
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        stream.avail_in = static_cast<uInt>(data.size());
+        stream.next_out = reinterpret_cast<Bytef*>(&result[0]);
+        stream.avail_out = static_cast<uInt>(result.size());
+        EXPECT_EQ(::deflate(&stream, Z_FINISH), Z_STREAM_END);
+        result.resize(stream.total_out);
+        deflateEnd(&stream);
+
+        return result;
+    }
+
+    bool is_accepted(const string_t& coding) {
+        for (const auto& accepted : split(accept_encoding(), ','))
+            if (trim(accepted) == coding)
+                return true;
+        return false;
+    }
+
+    /*
+      "hello world, hello world, hello world" in br and zstd.
+     */
+    const string_t HELLO = "hello world, hello world, hello world";
+    const string_t HELLO_BR {
+        "\x1b\x24\x00\x00\xa4\x40\x58\x72\x90\x45\xa8\xc9\x66\xf2\x3c\x9d\x5a\x01", 18};
+    const string_t HELLO_ZSTD {
+        "\x28\xb5\x2f\xfd\x20\x25\x9d\x00\x00\x68\x68\x65\x6c\x6c\x6f\x20"
+        "\x77\x6f\x72\x6c\x64\x2c\x20\x01\x00\x00\xce\x2f", 28};
+
+} /* anonymous namespace */
+
+TEST(Decoder, Identity) {
+    auto decoder = content_decoder_t::from_encoding("identity");
+
+    EXPECT_TRUE(decoder.empty());
+    EXPECT_TRUE(decoder.finished());
+    EXPECT_EQ(decode(decoder, "as it is", 3), "as it is");
+}
+
+TEST(Decoder, Gzip) {
+    const auto data = letters(100000);
+    const auto compressed = compress(data);
+
+    for (const size_t part_size : {size_t(1), size_t(7), size_t(4096), compressed.size()}) {
+        auto decoder = content_decoder_t::from_encoding(" GZip ");
+        ASSERT_FALSE(decoder.empty());
+        EXPECT_TRUE(decoder.finished());
+        EXPECT_EQ(decode(decoder, compressed, part_size), data);
+        EXPECT_TRUE(decoder.finished());
+    }
+}
+
+TEST(Decoder, GzipMembers) {
+    auto decoder = content_decoder_t::from_encoding("x-gzip");
+
+    EXPECT_EQ(decode(decoder, compress("first ") + compress("second"), 5), "first second");
+    EXPECT_TRUE(decoder.finished());
+}
+
+TEST(Decoder, Deflate) {
+    const auto data = letters(50000);
+
+    for (const int window_bits : {15, -15}) {
+        for (const size_t part_size : {size_t(1), size_t(3), size_t(1000)}) {
+            auto decoder = content_decoder_t::from_encoding("deflate");
+            ASSERT_FALSE(decoder.empty());
+            EXPECT_EQ(decode(decoder, deflate(data, window_bits), part_size), data);
+            EXPECT_TRUE(decoder.finished());
+        }
+    }
+}
+
+TEST(Decoder, Brotli) {
+    if (not is_accepted("br"))
+        return; /* built without brotli */
+
+    for (const size_t part_size : {size_t(1), HELLO_BR.size()}) {
+        auto decoder = content_decoder_t::from_encoding("br");
+        ASSERT_FALSE(decoder.empty());
+        EXPECT_EQ(decode(decoder, HELLO_BR, part_size), HELLO);
+        EXPECT_TRUE(decoder.finished());
+    }
+
+    auto truncated = content_decoder_t::from_encoding("br");
+    decode(truncated, HELLO_BR.substr(0, 10), 4);
+    EXPECT_FALSE(truncated.finished());
+
+    auto trailing = content_decoder_t::from_encoding("br");
+    EXPECT_THROW(decode(trailing, HELLO_BR + "x", 100), std::runtime_error);
+}
+
+TEST(Decoder, Zstd) {
+    if (not is_accepted("zstd"))
+        return; /* built without zstd */
+
+    for (const size_t part_size : {size_t(1), HELLO_ZSTD.size()}) {
+        auto decoder = content_decoder_t::from_encoding("zstd");
+        ASSERT_FALSE(decoder.empty());
+        EXPECT_EQ(decode(decoder, HELLO_ZSTD, part_size), HELLO);
+        EXPECT_TRUE(decoder.finished());
+    }
+
+    auto frames = content_decoder_t::from_encoding("zstd");
+    EXPECT_EQ(decode(frames, HELLO_ZSTD + HELLO_ZSTD, 5), HELLO + HELLO);
+
+    auto truncated = content_decoder_t::from_encoding("zstd");
+    decode(truncated, HELLO_ZSTD.substr(0, 20), 4);
+    EXPECT_FALSE(truncated.finished());
+
+    auto invalid = content_decoder_t::from_encoding("zstd");
+    EXPECT_THROW(decode(invalid, "not zstd data", 100), std::runtime_error);
+}
+
+TEST(Decoder, Chain) {
+    const auto data = letters(10000);
+    auto decoder = content_decoder_t::from_encoding("deflate, gzip");
+
+    EXPECT_EQ(decode(decoder, compress(deflate(data, 15)), 100), data);
+    EXPECT_TRUE(decoder.finished());
+}
+
+TEST(Decoder, Unknown) {
+    EXPECT_TRUE(content_decoder_t::from_encoding("compress").empty());
+    EXPECT_TRUE(content_decoder_t::from_encoding("gzip, compress").empty());
+}
+
+TEST(Decoder, Register) {
+    class upper_decoder_t : public decoder_t {
+    public:
+        void decode(const char* at, const size_t length,
+                    const decoder_output_t& output) override
+        {
+            string_t upper(at, length);
+            std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+            output(upper.data(), upper.size());
+        }
+
+        bool finished() const override {
+            return true;
+        }
+    };
+
+    register_content_decoder("x-test-upper", []() {
+        return std::make_shared<upper_decoder_t>();
+    });
+
+    EXPECT_TRUE(is_accepted("x-test-upper"));
+    EXPECT_EQ(accept_encoding().substr(0, 13), "gzip, deflate");
+    EXPECT_FALSE(is_accepted("x-gzip"));
+
+    auto decoder = content_decoder_t::from_encoding("identity, X-Test-Upper");
+    EXPECT_EQ(decode(decoder, "hello", 2), "HELLO");
+}
+
+TEST(Decoder, Truncated) {
+    const auto compressed = compress(letters(1000));
+    auto decoder = content_decoder_t::from_encoding("gzip");
+
+    decode(decoder, compressed.substr(0, compressed.size() / 2), 16);
+    EXPECT_FALSE(decoder.finished());
+}
+
+TEST(Decoder, Invalid) {
+    auto decoder = content_decoder_t::from_encoding("gzip");
+
+    EXPECT_THROW(decode(decoder, "this is not gzipped", 4), std::runtime_error);
+}
+
+TEST(Decoder, Decompress) {
+    EXPECT_EQ(decompress(compress("hello world")), "hello world");
+    EXPECT_EQ(decompress("plain"), "plain");
+}
@@ -0,0 +1,154 @@
+#include "api.h"
+#include "dns_server.h"
+#include "server.h"
+#include "gtest/gtest.h"
+
+#include <fstream>
+#include <thread>
+
+using namespace testing;
+using namespace crequests;
+
+namespace {
+
+    const char* RESOLV_CONF_PATH = "test_resolv.conf";
+    const char* HOSTS_PATH = "test_hosts";
+
+    void write_file(const string_t& path, const string_t& content) {
+        std::ofstream out(path);
+        out << content;
+    }
+
+    service_t make_service() {
+        write_file(RESOLV_CONF_PATH,
+                   "nameserver 127.0.0.2 # replaced by dns_nameservers_t\n"
+                   "options timeout:1 attempts:2\n");
+        write_file(HOSTS_PATH,
+                   "# static hosts\n"
+                   "127.0.0.1 hosts.test.host alias.test.host\n");
+
+        return service_t{dns_builtin_t{true},
+                         dns_resolv_conf_t{RESOLV_CONF_PATH},
+                         dns_hosts_file_t{HOSTS_PATH},
+                         dns_nameservers_t{"127.0.0.1:5353"}};
+    }
+
+} /* anonymous namespace */
+
+TEST(DnsBuiltin, Resolve) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+    dns_server_t dns_server{"127.0.0.1", 5353};
+    dns_server.add("test.host", "127.0.0.1");
+    std::thread dns_thread([&dns_server](){dns_server.run();});
+
+    auto service = make_service();
+    const auto response = Get(service, "test.host:8080/get_content_length");
+
+    EXPECT_EQ(response.error().code(), error_code_t::SUCCESS);
+    EXPECT_EQ(response.raw().value().size(), 100);
+    EXPECT_EQ(dns_server.udp_queries_count(), 2);
+
+    dns_server.stop();
+    dns_thread.join();
+    server.stop();
+    thread.join();
+}
+
+TEST(DnsBuiltin, Retry) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+    dns_server_t dns_server{"127.0.0.1", 5353};
+    dns_server.add("test.host", "127.0.0.1");
+    dns_server.drop(2);
+    std::thread dns_thread([&dns_server](){dns_server.run();});
+
+    auto service = make_service();
+    const auto response = Get(service, "test.host:8080/get_content_length");
+
+    EXPECT_EQ(response.error().code(), error_code_t::SUCCESS);
+    EXPECT_EQ(dns_server.udp_queries_count(), 4);
+
+    dns_server.stop();
+    dns_thread.join();
+    server.stop();
+    thread.join();
+}
+
+TEST(DnsBuiltin, SpoofedAnswerIgnored) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+    dns_server_t dns_server{"127.0.0.1", 5353};
+    dns_server.add("test.host", "127.0.0.1");
+    dns_server.spoof(2);
+    std::thread dns_thread([&dns_server](){dns_server.run();});
+
+    auto service = make_service();
+    const auto response = Get(service, "test.host:8080/get_content_length");
+
+    EXPECT_EQ(response.error().code(), error_code_t::SUCCESS);
+    EXPECT_EQ(dns_server.udp_queries_count(), 4);
+
+    dns_server.stop();
+    dns_thread.join();
+    server.stop();
+    thread.join();
+}
+
+TEST(DnsBuiltin, TruncatedOverTcp) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+    dns_server_t dns_server{"127.0.0.1", 5353};
+    dns_server.add("test.host", "127.0.0.1");
+    dns_server.truncate(true);
+    std::thread dns_thread([&dns_server](){dns_server.run();});
+
+    auto service = make_service();
+    const auto response = Get(service, "test.host:8080/get_content_length");
+
+    EXPECT_EQ(response.error().code(), error_code_t::SUCCESS);
+    EXPECT_EQ(dns_server.tcp_queries_count(), 2);
+
+    dns_server.stop();
+    dns_thread.join();
+    server.stop();
+    thread.join();
+}
+
+TEST(DnsBuiltin, UnknownHost) {
+    dns_server_t dns_server{"127.0.0.1", 5353};
+    std::thread dns_thread([&dns_server](){dns_server.run();});
+
+    auto service = make_service();
+    const auto response = Get(service, "unknown.test.host:8080/");
+
+    EXPECT_EQ(response.error().code(), error_code_t::RESOLVE_ERROR);
+
+    dns_server.stop();
+    dns_thread.join();
+}
+
+TEST(DnsBuiltin, HostsFile) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+    dns_server_t dns_server{"127.0.0.1", 5353};
+    std::thread dns_thread([&dns_server](){dns_server.run();});
+
+    auto service = make_service();
+    const auto response = Get(service, "alias.test.host:8080/get_content_length");
+
+    EXPECT_EQ(response.error().code(), error_code_t::SUCCESS);
+    EXPECT_EQ(dns_server.udp_queries_count(), 0);
+
+    dns_server.stop();
+    dns_thread.join();
+    server.stop();
+    thread.join();
+}
+
+TEST(DnsBuiltin, NoNameServer) {
+    auto service = make_service();
+    const auto response = Get(service, "test.host:8080/");
+
+    EXPECT_EQ(response.error().code(), error_code_t::RESOLVE_ERROR);
+}
@@ -12,6 +12,14 @@ TEST(Headers, FromString) {
               (headers_t {{"a", "1"}, {"b", "2"}, {"c", "3"}, {"d", "4"}}));
 }
 
+TEST(Headers, FromStringStopsAtEmptyLine) {
+    const auto headers =
+        headers_t::from_string("a: 1\r\nno colon\r\nb:2:3\r\n\r\nc: 3\r\n");
+
+    EXPECT_EQ(headers, (headers_t {{"a", "1"}, {"b", "2:3"}}));
+    EXPECT_EQ(headers_t::from_string("a: 1"), (headers_t {{"a", "1"}}));
+}
+
 TEST(Headers, FromStringUsingUserDefinedLiteral) {
     const auto headers =
         "a: 1\r\nb: 2\r\nc:3\r\nd:  4 \r\n\r\n"_headers;
@@ -24,7 +32,7 @@ TEST(Headers, ToString) {
     const auto headers =
         headers_t {{"a", "1"}, {"d", "4"}, {"b", "2"}, {"c", "3"}};
 
-    EXPECT_EQ(headers.to_string(), "a: 1\r\nb: 2\r\nc: 3\r\nd: 4\r\n\r\n");
+    EXPECT_EQ(headers.to_string(), "a: 1\r\nd: 4\r\nb: 2\r\nc: 3\r\n\r\n");
 }
 
 TEST(Headers, Update) {
@@ -36,3 +44,81 @@ TEST(Headers, Update) {
 
     EXPECT_EQ(headers1, result);
 }
+
+TEST(Headers, CaseInsensitiveNames) {
+    const auto headers = headers_t {{"content-length", "9"}, {"X-Custom", "a"}};
+
+    EXPECT_EQ(headers.at("Content-Length"), "9");
+    EXPECT_EQ(headers.at("CONTENT-LENGTH"), "9");
+    EXPECT_EQ(headers.at("x-custom"), "a");
+    EXPECT_EQ(headers.at("X-Other"), "");
+    EXPECT_EQ(headers.count("x-CUSTOM"), 1);
+    EXPECT_TRUE(headers.contains("X-CUSTOM", "a"));
+    EXPECT_FALSE(headers.contains("X-Custom", "A"));
+    EXPECT_EQ(headers.find("Transfer-Encoding"), headers.end());
+}
+
+TEST(Headers, Insert) {
+    auto headers = headers_t {{"Connection", "close"}, {"Host", "a"}};
+    headers.insert("connection", "keep-alive");
+    headers.insert("Set-Cookie", "cookie1");
+    headers.insert("set-cookie", "cookie2");
+
+    EXPECT_EQ(headers.size(), 4);
+    EXPECT_EQ(headers.at("Connection"), "keep-alive");
+    EXPECT_EQ(headers.count("Set-Cookie"), 2);
+    EXPECT_EQ(headers.to_string(),
+              "Connection: keep-alive\r\n"
+              "Host: a\r\n"
+              "Set-Cookie: cookie1\r\n"
+              "set-cookie: cookie2\r\n\r\n");
+}
+
+TEST(Headers, KnownNames) {
+    EXPECT_EQ(header_name_of("content-length"), header_name_t::CONTENT_LENGTH);
+    EXPECT_EQ(header_name_of("Transfer-Encoding"), header_name_t::TRANSFER_ENCODING);
+    EXPECT_EQ(header_name_of("Set-Cookie"), header_name_t::SET_COOKIE);
+    EXPECT_EQ(header_name_of("Content-Type"), header_name_t::OTHER);
+    EXPECT_EQ(header_name_of("Locations"), header_name_t::OTHER);
+}
+
+TEST(Headers, Equality) {
+    const auto headers = headers_t {{"A", "1"}, {"b", "2"}, {"b", "3"}};
+
+    EXPECT_EQ(headers, (headers_t {{"B", "3"}, {"a", "1"}, {"b", "2"}}));
+    EXPECT_NE(headers, (headers_t {{"A", "1"}, {"b", "2"}, {"b", "2"}}));
+    EXPECT_NE(headers, (headers_t {{"A", "1"}, {"b", "2"}}));
+}
+
+TEST(Headers, Block) {
+    header_block_t block;
+    block.append_name("Content-", 8);
+    block.append_name("Type", 4);
+    block.append_value("text/", 5);
+    block.append_value("html", 4);
+    block.append_name("Set-Cookie", 10);
+    block.append_value("a", 1);
+    block.append_name("set-cookie", 10);
+    block.append_value("b", 1);
+    block.append_name("X-Empty", 7);
+    block.append_value("", 0);
+
+    ASSERT_EQ(block.size(), 4);
+    EXPECT_EQ(block[0].first, "Content-Type");
+    EXPECT_EQ(block[0].second, "text/html");
+    EXPECT_EQ(block.at("content-type"), "text/html");
+    EXPECT_EQ(block.at("Set-Cookie"), "b");
+    EXPECT_EQ(block.at("X-Empty"), "");
+    EXPECT_EQ(block.at("X-Missing"), "");
+    EXPECT_EQ(block.count("SET-COOKIE"), 2);
+    EXPECT_TRUE(block.contains("Set-Cookie", "a"));
+    EXPECT_FALSE(block.contains("Content-Type", "text"));
+    EXPECT_EQ(block.to_headers(),
+              (headers_t {{"Content-Type", "text/html"},
+                          {"Set-Cookie", "a"},
+                          {"set-cookie", "b"},
+                          {"X-Empty", ""}}));
+
+    block.clear();
+    EXPECT_TRUE(block.empty());
+}
@@ -0,0 +1,224 @@
+#include "http_cache.h"
+#include "make_request.h"
+#include "utils.h"
+#include "gtest/gtest.h"
+
+using namespace testing;
+using namespace crequests;
+
+namespace {
+
+    response_t make_response(const request_t& request,
+                             const headers_t& headers,
+                             const string_t& body = "body",
+                             const unsigned int status_code = 200)
+    {
+        response_t response(request);
+        response.status_code(status_code_t{status_code});
+        response.headers(headers);
+        response.raw(raw_t{body});
+        response.error(crequests::error_t(error_code_t::SUCCESS, "success"));
+        return response;
+    }
+
+    string_t http_date(const std::time_t time) {
+        return time_to_string(time, "%a, %d %b %Y %H:%M:%S GMT");
+    }
+
+    /*
+      Stores the response as if it came from the network.
+     */
+    void store(http_cache_t& cache, response_t response) {
+        cache.complete(response, boost::none);
+    }
+
+} /* anonymous namespace */
+
+TEST(HttpCache, DisabledByDefault) {
+    http_cache_t cache;
+    const auto request = make_request("http://example.com/a");
+
+    EXPECT_FALSE(cache.enabled());
+    store(cache, make_response(request, {{"Cache-Control", "max-age=60"}}));
+    EXPECT_EQ(cache.count(), 0);
+    EXPECT_FALSE(cache.lookup(request).fresh);
+    EXPECT_EQ(cache.misses(), 0);
+}
+
+TEST(HttpCache, MaxAge) {
+    http_cache_t cache;
+    cache.set_option(http_cache_size_t{1 << 20});
+    const auto request = make_request("http://example.com/a?x=1");
+
+    EXPECT_FALSE(cache.lookup(request).fresh);
+    EXPECT_EQ(cache.misses(), 1);
+
+    store(cache, make_response(request, {{"Cache-Control", "public, max-age=60"}}));
+    const auto found = cache.lookup(request);
+    ASSERT_TRUE(found.fresh);
+    EXPECT_EQ(found.fresh->content(), "body");
+    EXPECT_EQ(cache.hits(), 1);
+
+    EXPECT_FALSE(cache.lookup(make_request("http://example.com/a?x=2")).fresh);
+    EXPECT_FALSE(cache.lookup(make_request("http://example.com/a?x=1", "HEAD")).fresh);
+}
+
+TEST(HttpCache, Age) {
+    http_cache_t cache;
+    cache.set_option(http_cache_size_t{1 << 20});
+    const auto request = make_request("http://example.com/");
+
+    store(cache, make_response(request, {{"Cache-Control", "max-age=60"}, {"Age", "100"}}));
+    EXPECT_FALSE(cache.lookup(request).fresh);
+    EXPECT_EQ(cache.misses(), 1);
+
+    const auto now = std::time(nullptr);
+    store(cache, make_response(request, {{"Date", http_date(now - 30)},
+                                         {"Expires", http_date(now + 30)}}));
+    EXPECT_TRUE(cache.lookup(request).fresh);
+
+    store(cache, make_response(request, {{"Date", http_date(now - 120)},
+                                         {"Expires", http_date(now - 60)},
+                                         {"ETag", "\"e\""}}));
+    const auto found = cache.lookup(request);
+    EXPECT_FALSE(found.fresh);
+    EXPECT_TRUE(found.stale);
+    EXPECT_EQ(cache.revalidations(), 1);
+}
+
+TEST(HttpCache, Heuristic) {
+    http_cache_t cache;
+    cache.set_option(http_cache_size_t{1 << 20});
+    const auto request = make_request("http://example.com/");
+    const auto now = std::time(nullptr);
+
+    store(cache, make_response(request, {{"Last-Modified", http_date(now - 36000)}}));
+    EXPECT_TRUE(cache.lookup(request).fresh);
+
+    store(cache, make_response(request, {{"Last-Modified", http_date(now - 36000)}},
+                               "moved", 302));
+    EXPECT_EQ(cache.count(), 0);
+}
+
+TEST(HttpCache, NoStoreAndNoCache) {
+    http_cache_t cache;
+    cache.set_option(http_cache_size_t{1 << 20});
+    const auto request = make_request("http://example.com/");
+
+    store(cache, make_response(request, {{"Cache-Control", "no-store, max-age=60"}}));
+    EXPECT_EQ(cache.count(), 0);
+
+    store(cache, make_response(request, {{"Cache-Control", "no-cache, max-age=60"},
+                                         {"ETag", "\"e\""}}));
+    EXPECT_TRUE(cache.lookup(request).stale);
+
+    store(cache, make_response(request, {{"Cache-Control", "max-age=60"}}));
+    auto no_cache = request;
+    no_cache.headers(headers_t{{"Cache-Control", "no-cache"}});
+    EXPECT_FALSE(cache.lookup(no_cache).fresh);
+
+    auto max_age = request;
+    max_age.headers(headers_t{{"Cache-Control", "max-age=0"}});
+    EXPECT_TRUE(cache.lookup(max_age).fresh);
+}
+
+TEST(HttpCache, Revalidate) {
+    http_cache_t cache;
+    cache.set_option(http_cache_size_t{1 << 20});
+    const auto request = make_request("http://example.com/");
+    store(cache, make_response(request, {{"Cache-Control", "max-age=0"},
+                                         {"ETag", "\"e\""},
+                                         {"Content-Length", "4"}}));
+
+    const auto found = cache.lookup(request);
+    ASSERT_TRUE(found.stale);
+
+    const auto conditional = http_cache_t::conditional(request, *found.stale);
+    EXPECT_EQ(conditional.headers().at("If-None-Match"), "\"e\"");
+    EXPECT_EQ(conditional.headers().count("If-Modified-Since"), 0);
+
+    auto response = make_response(conditional, {{"Cache-Control", "max-age=60"},
+                                                {"Content-Length", "0"}}, "", 304);
+    cache.complete(response, found.stale);
+
+    EXPECT_EQ(response.status_code().value(), 200);
+    EXPECT_EQ(response.content(), "body");
+    EXPECT_EQ(response.header("Content-Length"), "4");
+    EXPECT_EQ(response.header("Cache-Control"), "max-age=60");
+    EXPECT_TRUE(cache.lookup(request).fresh);
+}
+
+TEST(HttpCache, Vary) {
+    http_cache_t cache;
+    cache.set_option(http_cache_size_t{1 << 20});
+    auto request = make_request("http://example.com/");
+    request.headers(headers_t{{"Accept-Language", "en"}});
+    store(cache, make_response(request, {{"Cache-Control", "max-age=60"},
+                                         {"Vary", "Accept-Language"}}));
+
+    EXPECT_TRUE(cache.lookup(request).fresh);
+    request.headers(headers_t{{"Accept-Language", "de"}});
+    EXPECT_FALSE(cache.lookup(request).fresh);
+
+    store(cache, make_response(request, {{"Cache-Control", "max-age=60"}, {"Vary", "*"}}));
+    EXPECT_EQ(cache.count(), 0);
+}
+
+TEST(HttpCache, Bypass) {
+    http_cache_t cache;
+    cache.set_option(http_cache_size_t{1 << 20});
+    auto request = make_request("http://example.com/");
+    store(cache, make_response(request, {{"Cache-Control", "max-age=60"}}));
+
+    request.headers(headers_t{{"Range", "bytes=0-1"}});
+    EXPECT_FALSE(cache.lookup(request).fresh);
+    request.headers(headers_t{{"Cache-Control", "no-store"}});
+    EXPECT_FALSE(cache.lookup(request).fresh);
+    EXPECT_EQ(cache.misses(), 0);
+}
+
+TEST(HttpCache, UnsafeMethodInvalidates) {
+    http_cache_t cache;
+    cache.set_option(http_cache_size_t{1 << 20});
+    const auto request = make_request("http://example.com/item");
+    store(cache, make_response(request, {{"Cache-Control", "max-age=60"}}));
+    store(cache, make_response(make_request("http://example.com/item", "HEAD"),
+                               {{"Cache-Control", "max-age=60"}}, ""));
+    EXPECT_EQ(cache.count(), 2);
+
+    store(cache, make_response(make_request("http://example.com/item", "POST"), {}, "", 500));
+    EXPECT_EQ(cache.count(), 2);
+
+    store(cache, make_response(make_request("http://example.com/item", "POST"), {}, "", 204));
+    EXPECT_EQ(cache.count(), 0);
+}
+
+TEST(HttpCache, LeastRecentlyUsedEviction) {
+    const string_t body(1000, 'b');
+    const headers_t headers {{"Cache-Control", "max-age=60"}};
+    const auto first = make_request("http://example.com/1");
+    const auto second = make_request("http://example.com/2");
+    const auto third = make_request("http://example.com/3");
+
+    http_cache_t cache;
+    cache.set_option(http_cache_size_t{2500});
+    store(cache, make_response(first, headers, body));
+    store(cache, make_response(second, headers, body));
+    EXPECT_EQ(cache.count(), 2);
+    EXPECT_GT(cache.size(), 2000);
+
+    EXPECT_TRUE(cache.lookup(first).fresh);
+    store(cache, make_response(third, headers, body));
+    EXPECT_EQ(cache.count(), 2);
+    EXPECT_TRUE(cache.lookup(first).fresh);
+    EXPECT_FALSE(cache.lookup(second).fresh);
+    EXPECT_TRUE(cache.lookup(third).fresh);
+    EXPECT_LE(cache.size(), 2500);
+
+    store(cache, make_response(second, headers, string_t(3000, 'b')));
+    EXPECT_FALSE(cache.lookup(second).fresh);
+
+    cache.set_option(http_cache_size_t{1500});
+    EXPECT_EQ(cache.count(), 1);
+    EXPECT_TRUE(cache.lookup(third).fresh);
+}
@@ -11,6 +11,13 @@ TEST(Params, FromString) {
     EXPECT_EQ(params, (params_t {{"a", "1"}, {"b", "2"}, {"c", "3"}, {"d", "4"}}));
 }
 
+TEST(Params, FromStringSkipsBadPairs) {
+    const auto params =
+        params_t::from_string("a=1&&flag&b=&c=x=y");
+
+    EXPECT_EQ(params, (params_t {{"a", "1"}, {"b", ""}, {"c", "x=y"}}));
+}
+
 TEST(Params, FromStringUsingUserDefinedLiteral) {
     const auto params =
         "a=1&b=2&c=3&d=4"_params;
@@ -301,3 +301,128 @@ TEST(Parser, ChunkDataAcquire) {
     EXPECT_EQ(second_body, "jjj");
     EXPECT_EQ(count, 2);
 }
+
+namespace {
+
+    struct recording_handler_t : public parser_handler_t {
+        void on_status(const char* at,
+                       const size_t length,
+                       const unsigned short major,
+                       const unsigned short minor,
+                       const unsigned int code) {
+            status_message.assign(at, length);
+            http_major = major;
+            http_minor = minor;
+            status_code = code;
+        }
+
+        void on_header_field(const char* at, const size_t length) {
+            fields.emplace_back(at, length);
+        }
+
+        void on_body(const char* at, const size_t length) {
+            body.append(at, length);
+        }
+
+        void on_chunk_header(const size_t length) {
+            chunks.push_back(length);
+        }
+
+        void on_message_complete() {
+            complete = true;
+        }
+
+        string_t status_message {};
+        unsigned short http_major {};
+        unsigned short http_minor {};
+        unsigned int status_code {};
+        vector_t<string_t> fields {};
+        string_t body {};
+        vector_t<size_t> chunks {};
+        bool complete {false};
+    };
+
+} /* anonymous namespace */
+
+TEST(BasicParser, StatusAndHeaders) {
+    recording_handler_t handler;
+    basic_parser_t<recording_handler_t> parser(parser_t::parser_type_t::RESPONSE,
+                                               handler);
+
+    const char* data =
+        "HTTP/1.1 200 OK\r\n"
+        "Connection: close\r\n"
+        "Accept: */*\r\n"
+        "Accept-Encoding: gzip, deflate\r\n\r\n";
+
+    EXPECT_EQ(parser.execute(data, strlen(data)), strlen(data));
+    EXPECT_EQ(handler.http_major, 1);
+    EXPECT_EQ(handler.http_minor, 1);
+    EXPECT_EQ(handler.status_code, 200);
+    EXPECT_EQ(handler.status_message, "OK");
+    EXPECT_EQ(handler.fields,
+              (vector_t<string_t>{"Connection", "Accept", "Accept-Encoding"}));
+}
+
+TEST(BasicParser, Chunks) {
+    recording_handler_t handler;
+    basic_parser_t<recording_handler_t> parser(parser_t::parser_type_t::RESPONSE,
+                                               handler);
+
+    const char* data =
+        "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n\r\n"
+        "2\r\n"
+        "qq\r\n"
+        "3\r\n"
+        "jjj\r\n"
+        "0\r\n\r\n";
+
+    EXPECT_EQ(parser.execute(data, strlen(data)), strlen(data));
+    EXPECT_EQ(handler.body, "qqjjj");
+    EXPECT_EQ(handler.chunks, (vector_t<size_t>{2, 3, 0}));
+    EXPECT_TRUE(handler.complete);
+}
+
+TEST(BasicParser, PauseAndReset) {
+    struct pausing_handler_t : public parser_handler_t {
+        void on_headers_complete(const size_t length) {
+            content_length = length;
+            parser->pause();
+        }
+
+        basic_parser_t<pausing_handler_t>* parser {nullptr};
+        size_t content_length {0};
+    };
+
+    pausing_handler_t handler;
+    basic_parser_t<pausing_handler_t> parser(parser_t::parser_type_t::RESPONSE,
+                                             handler);
+    handler.parser = &parser;
+
+    const string_t data =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 4\r\n\r\n"
+        "body";
+
+    const auto nparsed = parser.execute(data.c_str(), data.size());
+    EXPECT_LT(nparsed, data.size());
+    EXPECT_EQ(handler.content_length, 4);
+
+    parser.unpause();
+    EXPECT_EQ(parser.execute(data.c_str() + nparsed, data.size() - nparsed),
+              data.size() - nparsed);
+
+    parser.reset();
+    EXPECT_EQ(parser.execute(data.c_str(), data.size()), nparsed);
+}
+
+TEST(BasicParser, BadStatus) {
+    parser_handler_t handler;
+    basic_parser_t<parser_handler_t> parser(parser_t::parser_type_t::RESPONSE,
+                                            handler);
+
+    const char* data = "HTT/1.1 200 OK\r\n";
+
+    EXPECT_EQ(parser.execute(data, strlen(data)), 0);
+}
@@ -24,15 +24,15 @@ TEST(Redirects, PrepareDefaultAndFindRequest) {
     redirects.add(response_t{request});
     EXPECT_EQ(redirects.get().size(), 2);
 
-    EXPECT_NE(redirects.find(request), boost::none);
+    EXPECT_TRUE(redirects.find(request));
 
     request.url("google.com"_url);
     request.prepare();
 
-    EXPECT_NE(redirects.find(request), boost::none);
+    EXPECT_TRUE(redirects.find(request));
 
     request.url("goooogle.com"_url);
     request.prepare();
 
-    EXPECT_EQ(redirects.find(request), boost::none);
+    EXPECT_FALSE(redirects.find(request));
 }
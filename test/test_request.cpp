@@ -1,4 +1,6 @@
 #include "request.h"
+#include "decoder.h"
+#include "utils.h"
 #include "gtest/gtest.h"
 
 using namespace testing;
@@ -16,12 +18,13 @@ TEST(Request, PrepareDefault) {
     EXPECT_EQ(out.str(),
               "GET / HTTP/1.1\r\n"
               "Accept: */*\r\n"
-              "Accept-Encoding: gzip, deflate\r\n"
+              "Accept-Encoding: " + DEFAULT_HEADERS.at("Accept-Encoding") + "\r\n"
               "Connection: keep-alive\r\n"
-              "Host: google.com\r\n"
               "User-Agent: Mozilla/5.0 (X11; Linux x86_64) "
                           "AppleWebKit/537.36 (KHTML, like Gecko) "
-                          "Chrome/47.0.2526.106 Safari/537.36\r\n\r\n");
+                          "Chrome/47.0.2526.106 Safari/537.36\r\n"
+              "Host: google.com\r\n"
+              "\r\n");
 }
 
 TEST(Request, PreparePost) {
@@ -37,12 +40,13 @@ TEST(Request, PreparePost) {
     EXPECT_EQ(out.str(),
               "POST / HTTP/1.1\r\n"
               "Accept: */*\r\n"
-              "Accept-Encoding: gzip, deflate\r\n"
+              "Accept-Encoding: " + DEFAULT_HEADERS.at("Accept-Encoding") + "\r\n"
               "Connection: keep-alive\r\n"
-              "Host: google.com\r\n"
               "User-Agent: Mozilla/5.0 (X11; Linux x86_64) "
                           "AppleWebKit/537.36 (KHTML, like Gecko) "
-                          "Chrome/47.0.2526.106 Safari/537.36\r\n\r\n");
+                          "Chrome/47.0.2526.106 Safari/537.36\r\n"
+              "Host: google.com\r\n"
+              "\r\n");
 }
 
 TEST(Request, PrepareGzip) {
@@ -58,13 +62,13 @@ TEST(Request, PrepareGzip) {
     EXPECT_EQ(out.str(),
               "POST / HTTP/1.1\r\n"
               "Accept: */*\r\n"
-              "Accept-Encoding: gzip, deflate\r\n"
+              "Accept-Encoding: " + DEFAULT_HEADERS.at("Accept-Encoding") + "\r\n"
               "Connection: keep-alive\r\n"
-              "Content-Encoding: gzip\r\n"
-              "Host: google.com\r\n"
               "User-Agent: Mozilla/5.0 (X11; Linux x86_64) "
                           "AppleWebKit/537.36 (KHTML, like Gecko) "
-                          "Chrome/47.0.2526.106 Safari/537.36\r\n\r\n");
+                          "Chrome/47.0.2526.106 Safari/537.36\r\n"
+              "Host: google.com\r\n"
+              "\r\n");
 }
 
 TEST(Request, PrepareKeepAlive) {
@@ -81,12 +85,13 @@ TEST(Request, PrepareKeepAlive) {
     EXPECT_EQ(out.str(),
               "POST / HTTP/1.1\r\n"
               "Accept: */*\r\n"
-              "Accept-Encoding: gzip, deflate\r\n"
+              "Accept-Encoding: " + DEFAULT_HEADERS.at("Accept-Encoding") + "\r\n"
               "Connection: close\r\n"
-              "Host: google.com\r\n"
               "User-Agent: Mozilla/5.0 (X11; Linux x86_64) "
                           "AppleWebKit/537.36 (KHTML, like Gecko) "
-                          "Chrome/47.0.2526.106 Safari/537.36\r\n\r\n");
+                          "Chrome/47.0.2526.106 Safari/537.36\r\n"
+              "Host: google.com\r\n"
+              "\r\n");
 }
 
 TEST(Request, PrepareBasicAuthorization) {
@@ -103,13 +108,14 @@ TEST(Request, PrepareBasicAuthorization) {
     EXPECT_EQ(out.str(),
               "POST / HTTP/1.1\r\n"
               "Accept: */*\r\n"
-              "Accept-Encoding: gzip, deflate\r\n"
-              "Authorization: Basic dXNlcjpwYXNzd2Q=\r\n"
+              "Accept-Encoding: " + DEFAULT_HEADERS.at("Accept-Encoding") + "\r\n"
               "Connection: keep-alive\r\n"
-              "Host: google.com\r\n"
               "User-Agent: Mozilla/5.0 (X11; Linux x86_64) "
                           "AppleWebKit/537.36 (KHTML, like Gecko) "
-                          "Chrome/47.0.2526.106 Safari/537.36\r\n\r\n"
+                          "Chrome/47.0.2526.106 Safari/537.36\r\n"
+              "Authorization: Basic dXNlcjpwYXNzd2Q=\r\n"
+              "Host: google.com\r\n"
+              "\r\n"
               );
 }
 
@@ -127,13 +133,14 @@ TEST(Request, PrepareWithData) {
     EXPECT_EQ(out.str(),
               "POST / HTTP/1.1\r\n"
               "Accept: */*\r\n"
-              "Accept-Encoding: gzip, deflate\r\n"
+              "Accept-Encoding: " + DEFAULT_HEADERS.at("Accept-Encoding") + "\r\n"
               "Connection: keep-alive\r\n"
-              "Content-Length: 6\r\n"
-              "Host: google.com\r\n"
               "User-Agent: Mozilla/5.0 (X11; Linux x86_64) "
                           "AppleWebKit/537.36 (KHTML, like Gecko) "
-                          "Chrome/47.0.2526.106 Safari/537.36\r\n\r\n"
+                          "Chrome/47.0.2526.106 Safari/537.36\r\n"
+              "Content-Length: 6\r\n"
+              "Host: google.com\r\n"
+              "\r\n"
               "hellow");
     
     EXPECT_FALSE(request.is_ssl());
@@ -145,26 +152,105 @@ TEST(Request, PrepareWithGzippedData) {
     request.method("POST"_method);
     request.data("hellow"_data);
     request.gzip(gzip_t{true});
+    request.compress_min_size(compress_min_size_t{0});
     request.prepare();
     std::ostringstream out;
     out << request.make_request();
     
-    EXPECT_EQ(out.str().substr(0, 271),
+    const string_t expected =
               "POST / HTTP/1.1\r\n"
               "Accept: */*\r\n"
-              "Accept-Encoding: gzip, deflate\r\n"
+              "Accept-Encoding: " + DEFAULT_HEADERS.at("Accept-Encoding") + "\r\n"
               "Connection: keep-alive\r\n"
-              "Content-Encoding: gzip\r\n"
-              "Content-Length: 6\r\n"
-              "Host: google.com\r\n"
               "User-Agent: Mozilla/5.0 (X11; Linux x86_64) "
                           "AppleWebKit/537.36 (KHTML, like Gecko) "
-                          "Chrome/47.0.2526.106 Safari/537.36\r\n\r\n"
-              "\x1F\x8B\b");
+                          "Chrome/47.0.2526.106 Safari/537.36\r\n"
+              "Content-Encoding: gzip\r\n"
+              "Content-Length: " + std::to_string(request.body().size()) + "\r\n"
+              "Host: google.com\r\n"
+              "\r\n"
+              "\x1F\x8B\b";
+    EXPECT_EQ(out.str().substr(0, expected.size()), expected);
+    EXPECT_EQ(decompress(request.body()), "hellow");
 
     EXPECT_TRUE(request.is_ssl());
 }
 
+TEST(Request, CompressMinSize) {
+    request_t request;
+    request.url("http://google.com"_url);
+    request.method("POST"_method);
+    request.data(data_t{string_t(1023, 'd')});
+    request.prepare();
+
+    EXPECT_EQ(request.headers().count("Content-Encoding"), 0);
+    EXPECT_EQ(request.headers().at("Content-Length"), "1023");
+    EXPECT_EQ(&request.body(), &request.data().value());
+
+    request.data(data_t{string_t(1024, 'd')});
+    request.prepare();
+
+    EXPECT_EQ(request.headers().at("Content-Encoding"), "gzip");
+    EXPECT_LT(request.body().size(), 100);
+    EXPECT_EQ(request.headers().at("Content-Length"), std::to_string(request.body().size()));
+    EXPECT_EQ(decompress(request.body()), request.data().value());
+
+    request.gzip(gzip_t{false});
+    request.prepare();
+
+    EXPECT_EQ(request.headers().count("Content-Encoding"), 0);
+    EXPECT_EQ(request.headers().at("Content-Length"), "1024");
+}
+
+TEST(Request, CompressedBodyIsKept) {
+    request_t request;
+    request.url("http://google.com"_url);
+    request.method("POST"_method);
+    request.data(data_t{string_t(4096, 'k')});
+    request.prepare();
+
+    const auto* body = &request.body();
+    request.prepare();
+    EXPECT_EQ(&request.body(), body);
+
+    const request_t copy = request;
+    EXPECT_EQ(&copy.body(), body);
+
+    request.data(data_t{string_t(4096, 'l')});
+    request.prepare();
+    EXPECT_EQ(decompress(request.body()), string_t(4096, 'l'));
+    EXPECT_EQ(decompress(copy.body()), string_t(4096, 'k'));
+}
+
+TEST(Request, CompressLevelAndEncoding) {
+    const string_t data(4096, 'c');
+
+    request_t request;
+    request.url("http://google.com"_url);
+    request.method("POST"_method);
+    request.data(data_t{data});
+    request.compress_level(compress_level_t{0});
+    request.prepare();
+    EXPECT_GT(request.body().size(), data.size());
+
+    request.compress_level(compress_level_t{9});
+    request.prepare();
+    EXPECT_LT(request.body().size(), 100);
+
+    request.compress_encoding(compress_encoding_t{"zstd"});
+    request.prepare();
+
+    const auto coding = can_encode_content("zstd") ? "zstd" : "gzip";
+    EXPECT_EQ(request.headers().at("Content-Encoding"), coding);
+
+    string_t decoded;
+    auto decoder = content_decoder_t::from_encoding(coding);
+    decoder.decode(request.body().data(), request.body().size(), [&decoded](const char* at, const size_t length) {
+        decoded.append(at, length);
+    });
+    EXPECT_EQ(decoded, data);
+}
+
 TEST(Request, UsingUserDefinedLiteral) {
     request_t request;
     request.uri("https://google.com/"_uri);
@@ -173,12 +259,11 @@ TEST(Request, UsingUserDefinedLiteral) {
     EXPECT_EQ(request.make_request(),
               "GET / HTTP/1.1\r\n"
               "Accept: */*\r\n"
-              "Accept-Encoding: gzip, deflate\r\n"
+              "Accept-Encoding: " + DEFAULT_HEADERS.at("Accept-Encoding") + "\r\n"
               "Connection: keep-alive\r\n"
-              "Content-Encoding: gzip\r\n"
-              "Host: google.com\r\n"
               "User-Agent: Mozilla/5.0 (X11; Linux x86_64) "
                           "AppleWebKit/537.36 (KHTML, like Gecko) "
                           "Chrome/47.0.2526.106 Safari/537.36\r\n"
+              "Host: google.com\r\n"
               "\r\n");
 }
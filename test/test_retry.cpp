@@ -0,0 +1,178 @@
+#include "api.h"
+#include "boost_asio.h"
+#include "retry.h"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace testing;
+using namespace crequests;
+
+namespace {
+
+    const string_t UNAVAILABLE =
+        "HTTP/1.1 503 Service Unavailable\r\n"
+        "Retry-After: 0\r\n"
+        "Content-Length: 0\r\n"
+        "Connection: close\r\n\r\n";
+
+    const string_t OK =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 2\r\n"
+        "Connection: close\r\n\r\n"
+        "ok";
+
+    /*
+      Answers one connection on 8082 with each of the responses in
+      turn and counts the requests it has read.
+     */
+    class scripted_server_t {
+    public:
+        scripted_server_t(const vector_t<string_t>& responses_)
+            : io_service(),
+              acceptor{io_service, {boost::asio::ip::address::from_string("127.0.0.1"), 8082}},
+              responses(responses_),
+              thread()
+        {
+            thread = std::thread([this]() {
+                for (const auto& response : responses) {
+                    tcp_socket_t socket(io_service);
+                    acceptor.accept(socket);
+                    streambuf_t request;
+                    boost::asio::read_until(socket, request, "\r\n\r\n");
+                    ++requests;
+                    boost::asio::write(socket, boost::asio::buffer(response));
+                }
+            });
+        }
+
+        ~scripted_server_t() {
+            thread.join();
+        }
+
+        std::atomic<size_t> requests {0};
+
+    private:
+        boost::asio::io_service io_service;
+        boost::asio::ip::tcp::acceptor acceptor;
+        vector_t<string_t> responses;
+        std::thread thread;
+    };
+
+    retry_policy_t make_policy(const size_t max_attempts) {
+        retry_policy_t policy;
+        policy.max_attempts = max_attempts;
+        policy.base_delay = milliseconds_t{10};
+        policy.max_delay = milliseconds_t{100};
+        return policy;
+    }
+
+} /* anonymous namespace */
+
+TEST(Retry, Policy) {
+    retry_policy_t policy;
+    EXPECT_FALSE(policy.enabled());
+    EXPECT_TRUE(make_policy(2).enabled());
+
+    EXPECT_TRUE(policy.is_retryable(error_code_t::CONNECT_ERROR));
+    EXPECT_TRUE(policy.is_retryable(error_code_t::TIMEOUT));
+    EXPECT_FALSE(policy.is_retryable(error_code_t::REDIRECT_ERROR));
+    EXPECT_TRUE(policy.is_retryable(503));
+    EXPECT_FALSE(policy.is_retryable(500));
+
+    EXPECT_TRUE(policy.is_idempotent("GET"));
+    EXPECT_TRUE(policy.is_idempotent("PUT"));
+    EXPECT_FALSE(policy.is_idempotent("POST"));
+    EXPECT_FALSE(policy.is_idempotent("PATCH"));
+
+    policy.base_delay = milliseconds_t{100};
+    policy.max_delay = milliseconds_t{300};
+    for (size_t i = 0; i < 100; ++i) {
+        EXPECT_LE(policy.backoff(1), milliseconds_t{100});
+        EXPECT_LE(policy.backoff(2), milliseconds_t{200});
+        EXPECT_LE(policy.backoff(10), milliseconds_t{300});
+        EXPECT_LE(policy.backoff(100), milliseconds_t{300});
+    }
+}
+
+TEST(Retry, RetryAfter) {
+    response_t response{request_t{}};
+    EXPECT_FALSE(retry_after_of(response));
+
+    response.headers(headers_t{{"Retry-After", "3"}});
+    ASSERT_TRUE(retry_after_of(response));
+    EXPECT_EQ(*retry_after_of(response), milliseconds_t{3000});
+
+    response.headers(headers_t{{"Retry-After", "Wed, 21 Oct 2015 07:28:00 GMT"}});
+    ASSERT_TRUE(retry_after_of(response));
+    EXPECT_EQ(*retry_after_of(response), milliseconds_t{0});
+
+    response.headers(headers_t{{"Retry-After", "soon"}});
+    EXPECT_FALSE(retry_after_of(response));
+
+    response.headers(headers_t{{"Retry-After", "12345678901234"}});
+    ASSERT_TRUE(retry_after_of(response));
+    EXPECT_EQ(*retry_after_of(response), milliseconds_t{seconds_t{999999999}});
+}
+
+TEST(Retry, Budget) {
+    retry_budget_t budget;
+    budget.set_option(retry_budget_tokens_t{4});
+    budget.set_option(retry_budget_ratio_t{0.5});
+
+    EXPECT_TRUE(budget.withdraw("a"));
+    EXPECT_TRUE(budget.withdraw("a"));
+    EXPECT_FALSE(budget.withdraw("a"));
+    EXPECT_TRUE(budget.withdraw("b"));
+
+    budget.deposit("a");
+    EXPECT_TRUE(budget.withdraw("a"));
+    EXPECT_FALSE(budget.withdraw("a"));
+    EXPECT_EQ(budget.retries(), 4);
+    EXPECT_EQ(budget.refused(), 2);
+
+    budget.set_option(retry_budget_tokens_t{0});
+    for (size_t i = 0; i < 10; ++i)
+        EXPECT_TRUE(budget.withdraw("a"));
+}
+
+TEST(Retry, Status) {
+    scripted_server_t server({UNAVAILABLE, UNAVAILABLE, OK});
+    service_t service;
+
+    const auto response = Get(service, "127.0.0.1:8082/", make_policy(3));
+    EXPECT_FALSE(response.error());
+    EXPECT_EQ(response.status_code().value(), 200);
+    EXPECT_EQ(response.raw().value(), "ok");
+    EXPECT_EQ(server.requests, 3);
+    EXPECT_EQ(service.get_retry_budget().retries(), 2);
+}
+
+TEST(Retry, Exhausted) {
+    scripted_server_t server({UNAVAILABLE, UNAVAILABLE});
+    service_t service;
+
+    const auto response = Get(service, "127.0.0.1:8082/", make_policy(2));
+    EXPECT_FALSE(response.error());
+    EXPECT_EQ(response.status_code().value(), 503);
+    EXPECT_EQ(server.requests, 2);
+}
+
+TEST(Retry, NonIdempotent) {
+    scripted_server_t server({UNAVAILABLE});
+    service_t service;
+
+    const auto response = Post(service, "127.0.0.1:8082/", "data"_data, make_policy(3));
+    EXPECT_EQ(response.status_code().value(), 503);
+    EXPECT_EQ(server.requests, 1);
+}
+
+TEST(Retry, ConnectError) {
+    service_t service{retry_budget_tokens_t{4}};
+
+    const auto response = Post(service, "127.0.0.1:8083/", "data"_data, make_policy(5));
+    EXPECT_EQ(response.error().code_to_string(), "CONNECT_ERROR");
+    EXPECT_EQ(service.get_retry_budget().retries(), 2);
+    EXPECT_EQ(service.get_retry_budget().refused(), 1);
+}
@@ -0,0 +1,49 @@
+#include "scan.h"
+#include "gtest/gtest.h"
+
+#include <cstring>
+
+using namespace testing;
+using namespace crequests;
+
+TEST(Scan, Kernel) {
+    const string_t kernel = scan_kernel();
+
+    EXPECT_TRUE(kernel == "avx2" or kernel == "sse2" or kernel == "scalar");
+}
+
+TEST(Scan, FindFirst) {
+    const delimiters_t delimiters("&=");
+    const string_t str = "name=value&other=1";
+    const char* begin = str.data();
+    const char* end = begin + str.size();
+
+    EXPECT_EQ(delimiters.find(begin, end), begin + 4);
+    EXPECT_EQ(delimiters.find(begin + 5, end), begin + 10);
+    EXPECT_EQ(delimiters.find(begin + 17, end), end);
+    EXPECT_EQ(delimiters.find(begin, begin), begin);
+}
+
+TEST(Scan, SameAsScalar) {
+    const delimiters_t delimiters("\r\n:");
+    string_t str(200, 'x');
+
+    for (size_t pos = 0; pos < str.size(); ++pos) {
+        str[pos] = ':';
+        for (size_t offset = 0; offset < 40; ++offset) {
+            const char* begin = str.data() + offset;
+            const char* end = str.data() + str.size();
+            EXPECT_EQ(delimiters.find(begin, end), delimiters.find_scalar(begin, end))
+                << "pos " << pos << ", offset " << offset;
+        }
+        str[pos] = 'x';
+    }
+}
+
+TEST(Scan, HighBytes) {
+    const delimiters_t delimiters("\n");
+    string_t str(100, '\xFF');
+    str[70] = '\n';
+
+    EXPECT_EQ(delimiters.find(str.data(), str.data() + str.size()), str.data() + 70);
+}
@@ -0,0 +1,219 @@
+#include "api.h"
+#include "server.h"
+#include "gtest/gtest.h"
+
+#include <thread>
+
+using namespace testing;
+using namespace crequests;
+
+TEST(Service, SeveralThreads) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    service_t service{threads_count_t{4}};
+
+    std::vector<asyncresponse_t> responses;
+    for (size_t i = 0; i < 50; ++i)
+        responses.push_back(
+            AsyncGet(service, "127.0.0.1:8080/get_big_content_length"));
+
+    for (const auto& response : responses) {
+        const auto r = response.get();
+        EXPECT_EQ(r.error().code(), error_code_t::SUCCESS);
+        EXPECT_EQ(r.raw().value().size(), 10000);
+    }
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Service, SeveralOptions) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    service_t service{dispose_timeout_t{2}, threads_count_t{2}};
+    const auto response = Get(service, "127.0.0.1:8080/get_content_length");
+
+    EXPECT_EQ(response.error().code(), error_code_t::SUCCESS);
+    EXPECT_EQ(response.raw().value().size(), 100);
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Service, PoolSharedBetweenSessions) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    service_t service;
+    for (size_t i = 0; i < 3; ++i) {
+        const auto response = Get(service, "127.0.0.1:8080/keep_alive");
+        EXPECT_EQ(response.error().code(), error_code_t::SUCCESS);
+        EXPECT_EQ(response.raw().value(), "keep_alive");
+    }
+
+    EXPECT_EQ(server.connections_count(), 1);
+    EXPECT_EQ(service.get_pool().size(), 1);
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Service, PoolDisabled) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    service_t service{pool_max_idle_per_host_t{0}};
+    for (size_t i = 0; i < 2; ++i) {
+        const auto response = Get(service, "127.0.0.1:8080/keep_alive");
+        EXPECT_EQ(response.error().code(), error_code_t::SUCCESS);
+    }
+
+    EXPECT_EQ(server.connections_count(), 2);
+    EXPECT_EQ(service.get_pool().size(), 0);
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Service, PoolClosedByServer) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    service_t service;
+    for (size_t i = 0; i < 2; ++i) {
+        const auto response = Get(service, "127.0.0.1:8080/get_content_length");
+        EXPECT_EQ(response.error().code(), error_code_t::SUCCESS);
+    }
+
+    EXPECT_EQ(server.connections_count(), 2);
+    EXPECT_EQ(service.get_pool().size(), 0);
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Service, PoolKeepsTlsSettingsApart) {
+    server_t server{"127.0.0.1", "4433", true};
+    std::thread thread([&server](){server.run();});
+
+    service_t service;
+    const auto response = Get(service, "https://127.0.0.1:4433/keep_alive");
+    EXPECT_EQ(response.error().code(), error_code_t::SUCCESS);
+    EXPECT_EQ(service.get_pool().size(), 1);
+
+    const auto verified =
+        Get(service, "https://127.0.0.1:4433/keep_alive", always_verify_peer_t{true});
+    EXPECT_NE(verified.error().code(), error_code_t::SUCCESS);
+    EXPECT_EQ(server.connections_count(), 2);
+    EXPECT_EQ(service.get_pool().size(), 1);
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Service, SslContextShared) {
+    server_t server{"127.0.0.1", "4433", true};
+    std::thread thread([&server](){server.run();});
+
+    service_t service;
+    for (size_t i = 0; i < 2; ++i) {
+        const auto response =
+            Get(service, "https://127.0.0.1:4433/get_content_length", keep_alive_t{false});
+        EXPECT_EQ(response.error().code(), error_code_t::SUCCESS);
+    }
+
+    EXPECT_EQ(service.get_ssl_contexts().size(), 1);
+
+    Get(service, "https://127.0.0.1:4433/get_content_length", always_verify_peer_t{true});
+    Get(service, "127.0.0.1:8080/get_content_length");
+
+    EXPECT_EQ(service.get_ssl_contexts().size(), 2);
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Service, SslSessionResumed) {
+    server_t server{"127.0.0.1", "4433", true};
+    std::thread thread([&server](){server.run();});
+
+    service_t service;
+    for (size_t i = 0; i < 3; ++i) {
+        const auto response =
+            Get(service, "https://127.0.0.1:4433/get_content_length", keep_alive_t{false});
+        EXPECT_EQ(response.error().code(), error_code_t::SUCCESS);
+    }
+
+    EXPECT_EQ(service.get_ssl_sessions().misses(), 1);
+    EXPECT_EQ(service.get_ssl_sessions().hits(), 2);
+    EXPECT_EQ(service.get_ssl_sessions().size(), 1);
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Service, SslSessionCacheDisabled) {
+    server_t server{"127.0.0.1", "4433", true};
+    std::thread thread([&server](){server.run();});
+
+    service_t service{ssl_session_cache_size_t{0}};
+    for (size_t i = 0; i < 2; ++i) {
+        const auto response =
+            Get(service, "https://127.0.0.1:4433/get_content_length", keep_alive_t{false});
+        EXPECT_EQ(response.error().code(), error_code_t::SUCCESS);
+    }
+
+    EXPECT_EQ(service.get_ssl_sessions().misses(), 2);
+    EXPECT_EQ(service.get_ssl_sessions().hits(), 0);
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Service, DnsCached) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    service_t service{pool_max_idle_per_host_t{0}};
+    for (size_t i = 0; i < 3; ++i) {
+        const auto response = Get(service, "localhost:8080/get_content_length");
+        EXPECT_EQ(response.error().code(), error_code_t::SUCCESS);
+    }
+
+    EXPECT_EQ(service.get_dns().misses(), 1);
+    EXPECT_EQ(service.get_dns().hits(), 2);
+    EXPECT_EQ(service.get_dns().size(), 1);
+
+    server.stop();
+    thread.join();
+}
+
+TEST(Service, DnsNegativeCached) {
+    service_t service;
+    for (size_t i = 0; i < 2; ++i) {
+        const auto response = Get(service, "unknown.host.invalid/");
+        EXPECT_EQ(response.error().code(), error_code_t::RESOLVE_ERROR);
+    }
+
+    EXPECT_EQ(service.get_dns().misses(), 1);
+    EXPECT_EQ(service.get_dns().hits(), 1);
+}
+
+TEST(Service, DnsOverrides) {
+    server_t server{"127.0.0.1", "8080"};
+    std::thread thread([&server](){server.run();});
+
+    dns_overrides_t overrides;
+    overrides.add("some.test.host", "8080", "127.0.0.1");
+    service_t service{overrides};
+
+    const auto response = Get(service, "some.test.host:8080/get_content_length");
+    EXPECT_EQ(response.error().code(), error_code_t::SUCCESS);
+    EXPECT_EQ(service.get_dns().misses(), 0);
+    EXPECT_EQ(service.get_dns().size(), 0);
+
+    server.stop();
+    thread.join();
+}
@@ -0,0 +1,167 @@
+#include "api.h"
+#include "make_request.h"
+#include "single_flight.h"
+#include "gtest/gtest.h"
+
+#include <stdexcept>
+
+using namespace testing;
+using namespace crequests;
+
+TEST(SingleFlight, DisabledByDefault) {
+    single_flight_t flights;
+
+    EXPECT_FALSE(flights.enabled());
+    flights.set_option(coalesce_t{true});
+    EXPECT_TRUE(flights.enabled());
+}
+
+TEST(SingleFlight, Key) {
+    single_flight_t flights;
+    const auto request = make_request("http://example.com/a?x=1");
+
+    EXPECT_FALSE(flights.key(request).empty());
+    EXPECT_EQ(flights.key(request), flights.key(make_request("http://example.com/a?x=1")));
+    EXPECT_NE(flights.key(request), flights.key(make_request("http://example.com/a?x=2")));
+    EXPECT_NE(flights.key(request), flights.key(make_request("https://example.com/a?x=1")));
+    EXPECT_NE(flights.key(request), flights.key(make_request("http://example.com/a?x=1", "HEAD")));
+    EXPECT_TRUE(flights.key(make_request("http://example.com/a?x=1", "POST")).empty());
+
+    auto with_accept = request;
+    with_accept.headers(headers_t{{"Accept", "text/plain"}});
+    EXPECT_NE(flights.key(request), flights.key(with_accept));
+
+    auto with_trace = request;
+    with_trace.headers(headers_t{{"X-Trace", "1"}});
+    auto with_other_trace = request;
+    with_other_trace.headers(headers_t{{"X-Trace", "2"}});
+    EXPECT_EQ(flights.key(with_trace), flights.key(with_other_trace));
+
+    flights.set_option(coalesce_headers_t{"X-Trace"});
+    EXPECT_NE(flights.key(with_trace), flights.key(with_other_trace));
+
+    auto cookie = "id=1"_cookie;
+    cookie.origin_domain("example.com");
+    cookie.origin_path("/");
+    cookies_t cookies;
+    cookies.add(cookie);
+    auto with_cookie = request;
+    with_cookie.cookies(cookies);
+    EXPECT_NE(flights.key(request), flights.key(with_cookie));
+
+    auto with_callback = request;
+    with_callback.body_callback([](const char*, const size_t, const crequests::error_t&) {});
+    EXPECT_TRUE(flights.key(with_callback).empty());
+}
+
+TEST(SingleFlight, CustomKey) {
+    single_flight_t flights;
+    flights.set_option(coalesce_key_t{[](const request_t& request) {
+        return request.uri().path().value();
+    }});
+
+    EXPECT_EQ(flights.key(make_request("http://example.com/a", "POST")), "/a");
+    EXPECT_EQ(flights.key(make_request("http://example.org/a")), "/a");
+}
+
+TEST(SingleFlight, JoinAndFinish) {
+    single_flight_t flights;
+    const auto request = make_request("http://example.com/");
+    const auto key = flights.key(request);
+
+    EXPECT_FALSE(flights.join(key, nullptr));
+    EXPECT_EQ(flights.size(), 1);
+
+    size_t callbacks = 0;
+    const auto callback = [&callbacks](const response_t& response) {
+        EXPECT_EQ(response.status_code().value(), 200);
+        ++callbacks;
+    };
+    const auto first = flights.join(key, callback);
+    const auto second = flights.join(key, callback);
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+    EXPECT_EQ(flights.joined(), 2);
+
+    response_t response(request);
+    response.status_code(status_code_t{200});
+    response.raw(raw_t{"shared"});
+    flights.finish(key, response);
+
+    EXPECT_EQ(callbacks, 2);
+    EXPECT_EQ(first->get().content(), "shared");
+    EXPECT_EQ(second->get().content(), "shared");
+    EXPECT_EQ(flights.size(), 0);
+
+    EXPECT_FALSE(flights.join(key, nullptr));
+    flights.finish(key, response);
+    EXPECT_EQ(flights.size(), 0);
+}
+
+TEST(SingleFlight, ThrowOnError) {
+    single_flight_t flights;
+    auto request = make_request("http://example.com/");
+    request.throw_on_error(throw_on_error_t{true});
+    const auto key = flights.key(request);
+
+    EXPECT_FALSE(flights.join(key, nullptr));
+    const auto joined = flights.join(key, nullptr);
+    ASSERT_TRUE(joined);
+
+    response_t response(request);
+    response.error(crequests::error_t(error_code_t::TIMEOUT, "timeout"));
+    flights.finish(key, response);
+
+    EXPECT_THROW(joined->get(), crequests::error_t);
+}
+
+TEST(SingleFlight, Abandon) {
+    single_flight_t flights;
+    const auto request = make_request("http://example.com/");
+    const auto key = flights.key(request);
+
+    EXPECT_FALSE(flights.join(key, nullptr));
+    const auto joined = flights.join(key, nullptr);
+    ASSERT_TRUE(joined);
+
+    flights.abandon(key, request);
+    EXPECT_EQ(joined->get().error().code(), error_code_t::CONNECT_ERROR);
+    EXPECT_EQ(flights.size(), 0);
+}
+
+TEST(SingleFlight, LeaderNotSent) {
+    service_t service{coalesce_t{true}};
+    const verify_filename_t missing {"/nonexistent/crequests/ca.pem"};
+
+    for (size_t i = 0; i < 2; ++i)
+        EXPECT_ANY_THROW(AsyncGet(service, "https://127.0.0.1:4433/", missing));
+
+    EXPECT_EQ(service.get_single_flight().size(), 0);
+    EXPECT_EQ(service.get_single_flight().joined(), 0);
+
+    bool handled = false;
+    session_t session(service);
+    set_option(session, "https://127.0.0.1:4433/"_url, missing);
+    EXPECT_ANY_THROW(session.AsyncGet([&handled](response_t&&) { handled = true; }));
+    EXPECT_EQ(service.get_single_flight().size(), 0);
+    EXPECT_FALSE(handled);
+}
+
+TEST(SingleFlight, Follow) {
+    single_flight_t flights;
+    const auto request = make_request("http://example.com/");
+    const auto key = flights.key(request);
+
+    EXPECT_FALSE(flights.follow(key, nullptr));
+    EXPECT_EQ(flights.size(), 0);
+
+    EXPECT_FALSE(flights.join(key, nullptr));
+    const auto followed = flights.follow(key, nullptr);
+    ASSERT_TRUE(followed);
+    EXPECT_EQ(flights.joined(), 1);
+
+    response_t response(request);
+    response.raw(raw_t{"shared"});
+    flights.finish(key, response);
+    EXPECT_EQ(followed->get().content(), "shared");
+}
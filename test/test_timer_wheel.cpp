@@ -0,0 +1,150 @@
+#include "api.h"
+#include "gtest/gtest.h"
+
+#include <boost/system/error_code.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+using namespace testing;
+using namespace crequests;
+
+namespace {
+
+    using steady_clock_t = std::chrono::steady_clock;
+
+    void sleep_ms(const size_t ms) {
+        std::this_thread::sleep_for(milliseconds_t(ms));
+    }
+
+} /* anonymous namespace */
+
+TEST(TimerWheel, Expires) {
+    service_t service{timer_tick_t{10}};
+    wheel_timer_t timer{service.get_timers()};
+    std::atomic<bool> fired{false};
+    std::atomic<long> elapsed{0};
+
+    const auto start = steady_clock_t::now();
+    timer.expires_from_now(milliseconds_t(50));
+    timer.async_wait([&](const ec_t& ec) {
+        elapsed = std::chrono::duration_cast<milliseconds_t>(
+            steady_clock_t::now() - start).count();
+        fired = not ec;
+    });
+    EXPECT_TRUE(timer.is_armed());
+    EXPECT_EQ(service.get_timers().size(), 1);
+
+    sleep_ms(300);
+    EXPECT_TRUE(fired);
+    EXPECT_GE(elapsed, 50);
+    EXPECT_FALSE(timer.is_armed());
+    EXPECT_EQ(service.get_timers().size(), 0);
+}
+
+TEST(TimerWheel, Cancel) {
+    service_t service{timer_tick_t{10}};
+    wheel_timer_t timer{service.get_timers()};
+    std::atomic<bool> fired{false};
+
+    timer.expires_from_now(milliseconds_t(50));
+    timer.async_wait([&](const ec_t&) { fired = true; });
+    timer.cancel();
+
+    sleep_ms(200);
+    EXPECT_FALSE(fired);
+    EXPECT_EQ(service.get_timers().size(), 0);
+}
+
+TEST(TimerWheel, Rearm) {
+    service_t service{timer_tick_t{10}};
+    wheel_timer_t timer{service.get_timers()};
+    std::atomic<size_t> first{0};
+    std::atomic<size_t> second{0};
+
+    timer.expires_from_now(milliseconds_t(30));
+    timer.async_wait([&](const ec_t&) { first++; });
+    timer.expires_from_now(milliseconds_t(60));
+    timer.async_wait([&](const ec_t&) { second++; });
+
+    sleep_ms(300);
+    EXPECT_EQ(first, 0);
+    EXPECT_EQ(second, 1);
+}
+
+TEST(TimerWheel, BeyondOneTurn) {
+    service_t service{timer_tick_t{1}};
+    wheel_timer_t timer{service.get_timers()};
+    std::atomic<bool> fired{false};
+
+    const auto start = steady_clock_t::now();
+    timer.expires_from_now(milliseconds_t(700));
+    timer.async_wait([&](const ec_t&) { fired = true; });
+
+    while (not fired and steady_clock_t::now() - start < std::chrono::seconds(3))
+        sleep_ms(10);
+    EXPECT_TRUE(fired);
+    EXPECT_GE(steady_clock_t::now() - start, milliseconds_t(700));
+}
+
+TEST(TimerWheel, ManyTimers) {
+    service_t service{timer_tick_t{5}, threads_count_t{4}};
+    const size_t count = 10000;
+    std::atomic<size_t> fired{0};
+    vector_t<std::unique_ptr<wheel_timer_t> > timers;
+
+    for (size_t i = 0; i < count; ++i) {
+        timers.emplace_back(new wheel_timer_t(service.get_timers()));
+        timers.back()->expires_from_now(milliseconds_t(10 + i % 100));
+        timers.back()->async_wait([&](const ec_t&) { fired++; });
+    }
+    for (size_t i = 0; i < count; i += 2)
+        timers[i]->cancel();
+
+    sleep_ms(500);
+    EXPECT_EQ(fired, count / 2);
+    EXPECT_EQ(service.get_timers().size(), 0);
+}
+
+TEST(TimerWheel, AlreadyExpired) {
+    service_t service{timer_tick_t{1000}};
+    wheel_timer_t timer{service.get_timers()};
+    wheel_timer_t cancelled{service.get_timers()};
+    std::atomic<bool> fired{false};
+    std::atomic<bool> cancelled_fired{false};
+
+    timer.expires_from_now(milliseconds_t(0));
+    timer.async_wait([&](const ec_t& ec) { fired = not ec; });
+    cancelled.expires_from_now(milliseconds_t(0));
+    cancelled.async_wait([&](const ec_t&) { cancelled_fired = true; });
+    cancelled.cancel();
+
+    sleep_ms(100);
+    EXPECT_TRUE(fired);
+    EXPECT_FALSE(cancelled_fired);
+    EXPECT_FALSE(timer.is_armed());
+    EXPECT_EQ(service.get_timers().size(), 0);
+}
+
+TEST(TimerWheel, DestroyedWithArmedTimers) {
+    struct owner_t {
+        owner_t(timer_wheel_t& wheel) : timer{wheel}, posted{wheel} {}
+        wheel_timer_t timer;
+        wheel_timer_t posted;
+    };
+
+    std::weak_ptr<owner_t> weak;
+    {
+        service_t service;
+        const auto owner = std::make_shared<owner_t>(service.get_timers());
+        owner->timer.expires_from_now(seconds_t(60));
+        owner->timer.async_wait([owner](const ec_t&) {});
+        owner->posted.expires_from_now(milliseconds_t(0));
+        owner->posted.async_wait([owner](const ec_t&) {});
+        weak = owner;
+    }
+
+    EXPECT_TRUE(weak.expired());
+}